@@ -36,8 +36,13 @@ DEALINGS IN THE SOFTWARE.
 #include <gtk/gtk.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 #include <synchapi.h>
 #include "il_interpreter.h"
+#include "il_debug.h"
+#include "il_trend.h"
+#include "il_listing.h"
+#include "il_const.h"
 
 
 /***************************************************************
@@ -56,8 +61,10 @@ struct{
 	{"LOAD", FALSE},
 		{"LOAD_N", TRUE}, {"LOAD_I", TRUE}, 
 		{"LOAD_{", TRUE}, {"LOAD_N{", TRUE},
+		{"LOAD_F", TRUE}, {"LOAD_FW", TRUE}, {"LOAD_IF", TRUE},
 	{"STOR", FALSE},
 		{"STOR_N", TRUE}, {"STOR_{", TRUE}, {"STOR_N{", TRUE},
+		{"STOR_F", TRUE}, {"STOR_FW", TRUE},
 	{"SET",FALSE},
 	{"RST",FALSE},
 	{"AND",FALSE},	
@@ -70,31 +77,53 @@ struct{
 		{"XOR_I",TRUE}, {"XOR_{", TRUE},
 	{"ADD", FALSE},	
 		{"ADD_I", TRUE},{"ADD_{", TRUE},
+		{"ADD_F", TRUE}, {"ADD_IF", TRUE},
 	{"SUB", FALSE},	
 		{"SUB_I", TRUE},{"SUB_{", TRUE},
+		{"SUB_F", TRUE}, {"SUB_IF", TRUE},
 	{"MUL", FALSE},	
 		{"MUL_I", TRUE},{"MUL_{", TRUE},
+		{"MUL_F", TRUE}, {"MUL_IF", TRUE},
 	{"DIV", FALSE},	
 		{"DIV_I", TRUE},{"DIV_{", TRUE},
+		{"DIV_F", TRUE}, {"DIV_IF", TRUE},
 	{"GT", FALSE},	
 		{"GT_I", TRUE}, {"GT_{", TRUE},
+		{"GT_F", TRUE}, {"GT_IF", TRUE},
 	{"GE", FALSE},	
 		{"GE_I", TRUE}, {"GE_{", TRUE},
+		{"GE_F", TRUE}, {"GE_IF", TRUE},
 	{"EQ", FALSE},	
 		{"EQ_I", TRUE},	{"EQ_{", TRUE},
+		{"EQ_F", TRUE}, {"EQ_IF", TRUE},
 	{"NE", FALSE},	
 		{"NE_I", TRUE},	{"NE_{", TRUE},
+		{"NE_F", TRUE}, {"NE_IF", TRUE},
 	{"LE", FALSE},  
 		{"LE_I", TRUE},	{"LE_{", TRUE},
+		{"LE_F", TRUE}, {"LE_IF", TRUE},
 	{"LT", FALSE},	
 		{"LT_I", TRUE},	{"LT_{", TRUE},
+		{"LT_F", TRUE}, {"LT_IF", TRUE},
 	{"JUMP", FALSE},
 		{"JUMP_C", TRUE}, {"JUMP_CN", TRUE},
 	{"CALL", FALSE},
 		{"CALL_C", TRUE}, {"CALL_CN", TRUE},
 	{"RET", FALSE},	
 		{"RET_C", TRUE},  {"RET_CN", TRUE},
-	{"}",FALSE}
+	{"}",FALSE},
+	{"SEQ",FALSE},
+	{"ALARM",FALSE},
+	{"ALARMB",FALSE},
+	{"PUSH",FALSE},
+	{"POP",FALSE},
+	{"PEEK",FALSE},
+	{"SUM",FALSE},
+	{"MIN",FALSE},
+	{"MAX",FALSE},
+	{"MEAN",FALSE},
+	{"ITOF",FALSE},
+	{"FTOI",FALSE}
 };
 
 /* CreateCommands() 
@@ -105,6 +134,12 @@ struct{
  * @return - The menu tree in GtkTreeModel format
  */
 
+#define MENU_SIZE (sizeof(menudata)/sizeof(menudata[0]))
+
+/* The menu item of each menudata[] entry, for selecting
+ * commands by name (tree store iters persist) */
+static GtkTreeIter menu_iter[MENU_SIZE];
+
 static GtkTreeModel* CreateCommands(void){
 
 	GtkTreeStore * store;
@@ -113,13 +148,15 @@ static GtkTreeModel* CreateCommands(void){
 
 	store = gtk_tree_store_new(1,G_TYPE_STRING);
 
-	for(i = 0; i < sizeof(menudata)/sizeof(menudata[0]); i++){
+	for(i = 0; i < MENU_SIZE; i++){
 		if(!(menudata[i].sub) || (i == 0)){
 			gtk_tree_store_append(store, &iter, NULL);
 			gtk_tree_store_set(store, &iter, 0, menudata[i].text,-1);
+			menu_iter[i] = iter;
 		} else {
 			gtk_tree_store_append(store, &subitem, & iter);
 			gtk_tree_store_set(store, &subitem, 0, menudata[i].text, -1);
+			menu_iter[i] = subitem;
 		}
 	}
 	return GTK_TREE_MODEL(store);
@@ -157,11 +194,12 @@ GtkSpinButton * accum;
 
 /* addr_decode
  * Turn a Modbus type address into a row and column to access
- * the bit_memory and word_memory arrays
- * @param [in ] addr - The modbus style address 0xxxx, 1xxxx, 3xxxx, 4xxxx
+ * the bit_memory and word_memory arrays, or the constant bank
+ * @param [in ] addr - The modbus style address 0xxxx, 1xxxx, 3xxxx, 4xxxx, 5xxxx
  * @param [out] col  - The "column" 
  *                       0 -> bit_memory[0], 1->bit_memory[1]
  *                       2 -> word_memory[0], 3->word_memory[1]
+ *                       4 -> constant bank (read-only)
  * @param [out] row  - the row number in memory array
  *
  * @return - true if valid address else false
@@ -169,11 +207,11 @@ GtkSpinButton * accum;
 bool addr_decode(uint16_t addr, int * col, int * row){
 	int tcol = addr / 10000;
 	int trow = (addr % 10000);
-	if(trow == 0 || (trow > MEM_SIZE)) return false;
+	if(trow == 0 || (trow > (tcol == 5 ? IL_CONST_BANK_SIZE : MEM_SIZE))) return false;
 	trow -= 1;
 	switch(tcol){
 	case 0: case 1: break;
-	case 3: case 4: tcol--; break;
+	case 3: case 4: case 5: tcol--; break;
 	default: return false;
 	}
 	*col = tcol;
@@ -198,7 +236,7 @@ void mem_set(uint16_t addr, uint16_t val, bool invert){
 		if(col < 2){
 			if(invert) val = !val;
 			gtk_toggle_button_set_active(bit_memory[col][row], (val ? true : false));
-		} else {
+		} else if(col < 4){ // constants are read-only
 			if(invert) val = ~val;
 			gtk_spin_button_set_value(word_memory[col-2][row],val);
 		}
@@ -221,7 +259,8 @@ uint16_t mem_get(uint16_t addr, bool invert){
 			val = (gtk_toggle_button_get_active(bit_memory[col][row]))? 1 : 0;
 			if(invert) val = !val;
 		} else {
-			val = gtk_spin_button_get_value_as_int(word_memory[col-2][row]);
+			if(col < 4) val = gtk_spin_button_get_value_as_int(word_memory[col-2][row]);
+			else        val = il_const_get(row);
 			if(invert) val = ~val;
 		}
 	}
@@ -249,27 +288,57 @@ il_memory_callbacks mc = {
  * - Halt continuous execution of the program
  ********************************************************/
 
-/* Global holding the current execution line of the IL program */
-uint16_t current_line;
+/* Debugger holding the pre-parsed program. It runs the program
+ * in ctx, whose memory is the display above. */
+static il_context ctx;
+static il_debugger dbg;
+static int stop_reason = IL_DBG_STEP; // why execution last stopped
+
+/* History for the back buttons. Snapshots are taken every
+ * HISTORY_INTERVAL lines, so going back replays at most that many. */
+#define HISTORY_SNAPSHOTS 1024
+#define HISTORY_WRITES    16384
+#define HISTORY_INTERVAL  16
+static il_history history;
+
+/* Debug controls */
+GtkLabel * status;               // shows why execution stopped
+GtkComboBox * break_cond;        // condition for new breakpoints
+GtkSpinButton * break_value;     // value for the condition
+GtkSpinButton * watch_addr;      // address for the watch button
 
 /* Update the display to show the current state 
  * - Highlight the current program line
  * - Update the current accumulator with the value from il_interpreter
+ * - Show why execution stopped
  */
 void show_state(void){
-	if(current_line < NUM_LINES){
-		gtk_widget_grab_focus(program[current_line].command);
+	gchar text[48];
+
+	if(dbg.line < NUM_LINES){
+		gtk_widget_grab_focus(program[dbg.line].command);
 	}
 	// retreive the current accumulator value and display
-	gtk_spin_button_set_value(accum, il_interp_get_accum());
+	gtk_spin_button_set_value(accum, il_interp_ctx_get_accum(&ctx));
+
+	switch(stop_reason){
+	case IL_DBG_BREAK:
+		sprintf(text, "break at line %d", dbg.line);
+		break;
+	case IL_DBG_WATCH:
+		sprintf(text, "%05d: %u -> %u", dbg.watch_addr, dbg.watch_old, dbg.watch_new);
+		break;
+	default:
+		text[0] = 0;
+	}
+	gtk_label_set_text(status, text);
 }
 
-/* Execute one line of the global program[] array
+/* Copy one line of the global program[] array to the debugger
  * 
- * @param - line_no - The program line to execute.
- * @return - the new program counter / line number after executing the command
+ * @param - line_no - The program line to copy.
  */
-uint16_t execute_line(line_no){
+void load_line(uint16_t line_no){
 	gchar * command = NULL;
 	GtkTreeIter iter;
 	GtkTreeStore *cmds;
@@ -281,19 +350,24 @@ uint16_t execute_line(line_no){
 		cmds = GTK_TREE_STORE(gtk_combo_box_get_model(GTK_COMBO_BOX(program[line_no].command)));
 		// And pull the text from the tree model
 		gtk_tree_model_get(GTK_TREE_MODEL(cmds), & iter, 0, &command, -1);
-		//gtk_combo_box_get_active_text(program[line_no].command, & command);
-		//command = gtk_entry_get_text(GTK_ENTRY(gtk_bin_get_child(GTK_BIN(program[line_no].command))));
 		value = gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON(program[line_no].value));
 #ifdef DEBUG
 		g_print("%s : %d\n", command, value);
 #endif
-		// Execute the command to update state and get the new program counter value
-		line_no = il_interp_execute(il_interp_parse(command), value, line_no);
+		il_debug_set_line(&dbg, line_no, il_interp_parse(command), value);
+		g_free(command);
 	} else {
-                // Empty command then just move to the next line. No change to state
-		line_no = line_no +1;
+		// Empty command is a NOP
+		il_debug_set_line(&dbg, line_no, il_interp_parse(""), 0);
+	}
+}
+
+/* Copy the whole program to the debugger, picking up any edits */
+void load_program(void){
+	uint16_t i;
+	for(i = 0; i < NUM_LINES; i++){
+		load_line(i);
 	}
-	return line_no;
 }
 
 /* Program execution status variables */
@@ -305,14 +379,15 @@ static bool running=false; // Flag indicates already running
  * - If already running or not initialised then ignore
  */
 void prog_step(void){
-	if(!running && init && (current_line < NUM_LINES)){
-		current_line = execute_line(current_line);
+	if(!running && init){
+		load_program();
+		il_trend_clock(&trend, g_get_monotonic_time());
+		stop_reason = il_debug_step(&dbg);
 		show_state();
 	}
 }
 
 /* Initialise the program state
- * - Only initialise il_interp if not already initialised
  * - If already running then ignore
  */
 void prog_init(void){
@@ -320,12 +395,11 @@ void prog_init(void){
 #ifdef DEBUG
 	g_print("init\n");
 #endif
-	current_line = 0;
+	il_debug_restart(&dbg);
+	il_profile_clear(&profile);
+	stop_reason = IL_DBG_STEP;
 	show_state();
-	if(!init){
-		il_interp_init(&mc);
-		init = true;
-	}
+	init = true;
 }
 
 /* Flag "halt" requested when program is running */
@@ -333,18 +407,354 @@ void prog_halt(void){
 	halt = true;
 }
 
-/* Run to the end of the current instruction list execution */
+/* Step back one line, or to the start of the scan
+ * - If running or not initialised then ignore
+ */
+static void step_back(bool scan){
+	if(running || !init) return;
+	load_program();
+	if(scan ? il_debug_back_scan(&dbg) : il_debug_back(&dbg, 1)){
+		stop_reason = IL_DBG_STEP;
+		show_state();
+	} else {
+		gtk_label_set_text(status, "no history");
+	}
+}
+
+void prog_back(void){
+	step_back(false);
+}
+
+void prog_back_scan(void){
+	step_back(true);
+}
+
+/* Trend display of registers picked with the trend button. Samples
+ * are taken by the interpreter on every write, time stamped in
+ * microseconds, and drawn at display rate. */
+#define TREND_SAMPLES   (1UL << 20)     // samples kept per trace
+#define TREND_WINDOW_US 10000000ULL     // time span shown
+#define TREND_FRAME_MS  16              // redraw period
+static il_trend trend;
+GtkWidget * trend_area;
+
+/* Add a trace for the address in the watch spin-edit */
+void prog_trend(void){
+	uint16_t addr = gtk_spin_button_get_value_as_int(watch_addr);
+	gchar text[32];
+
+	il_trend_clock(&trend, g_get_monotonic_time());
+	if(il_trend_add(&trend, addr, TREND_SAMPLES, il_interp_ctx_peek(&ctx, addr)) < 0){
+		gtk_label_set_text(status, "no more traces");
+		return;
+	}
+	il_debug_set_observer(&dbg, trend.map, il_trend_observer, &trend);
+	sprintf(text, "trend %05d", addr);
+	gtk_label_set_text(status, text);
+}
+
+/* Draw the traces - one min/max line per pixel column, each trace
+ * scaled to its own range in the window */
+static gboolean draw_trend(GtkWidget *widget, cairo_t *cr, gpointer data){
+	static const double colour[IL_TREND_MAX_TRACES][3] = {
+		{0.8, 0.0, 0.0}, {0.0, 0.5, 0.0}, {0.0, 0.0, 0.8}, {0.6, 0.4, 0.0},
+		{0.6, 0.0, 0.6}, {0.0, 0.5, 0.5}, {0.3, 0.3, 0.3}, {0.0, 0.0, 0.0}
+	};
+	int width = gtk_widget_get_allocated_width(widget);
+	int height = gtk_widget_get_allocated_height(widget);
+	uint64_t now = g_get_monotonic_time();
+	il_trend_column * col;
+	int i, c;
+
+	cairo_set_source_rgb(cr, 1.0, 1.0, 1.0);
+	cairo_paint(cr);
+	if(width <= 0 || height <= 1) return FALSE;
+
+	col = g_new(il_trend_column, width);
+	cairo_set_line_width(cr, 1.0);
+	for(i = 0; i < trend.traces; i++){
+		int lo = 65535, hi = 0;    // int, so hi = lo + 1 cannot wrap
+		il_trend_decimate(&trend.trace[i], now - TREND_WINDOW_US, now, width, col);
+		for(c = 0; c < width; c++){
+			if(!col[c].valid) continue;
+			if(col[c].min < lo) lo = col[c].min;
+			if(col[c].max > hi) hi = col[c].max;
+		}
+		if(hi <= lo) hi = lo + 1;
+		cairo_set_source_rgb(cr, colour[i][0], colour[i][1], colour[i][2]);
+		for(c = 0; c < width; c++){
+			double ymin, ymax;
+			if(!col[c].valid) continue;
+			ymin = (height - 1) - (double)(col[c].min - lo) * (height - 1) / (hi - lo);
+			ymax = (height - 1) - (double)(col[c].max - lo) * (height - 1) / (hi - lo);
+			cairo_move_to(cr, c + 0.5, ymin + 0.5);
+			cairo_line_to(cr, c + 0.5, ymax - 0.5);
+		}
+		cairo_stroke(cr);
+	}
+	g_free(col);
+	return FALSE;
+}
+
+/* Redraw timer for the trend display */
+static gboolean redraw_trend(gpointer data){
+	if(trend.traces) gtk_widget_queue_draw(trend_area);
+	return TRUE;
+}
+
+/* Execution heat map on the line numbers. The labels are coloured
+ * from a snapshot of the profile counters a few times a second:
+ * grey never executed, blue (cold) to red (hot) on a log scale. */
+#define HEAT_PERIOD_MS 100
+static il_profile profile;
+static il_profile profile_shown;
+
+static gboolean update_heat(gpointer data){
+	uint32_t max = 0;
+	gchar markup[64], tip[64];
+	int i;
+
+	il_profile_snapshot(&profile, &profile_shown);
+	for(i = 0; i < NUM_LINES; i++){
+		if(profile_shown.exec[i] > max) max = profile_shown.exec[i];
+	}
+	for(i = 0; i < NUM_LINES; i++){
+		uint32_t n = profile_shown.exec[i];
+		GtkWidget * text = gtk_bin_get_child(GTK_BIN(program[i].label));
+		if(n == 0){
+			sprintf(markup, "<span background=\"#C0C0C0\">%d</span>", i);
+			sprintf(tip, "never executed");
+		} else {
+			guint heat = 255 * g_bit_storage(n) / g_bit_storage(max);
+			sprintf(markup, "<span background=\"#%02X60%02X\">%d</span>", heat, 255 - heat, i);
+			sprintf(tip, "executed %u, taken %u%%", n,
+					(unsigned)((uint64_t)profile_shown.taken[i] * 100 / n));
+		}
+		gtk_label_set_markup(GTK_LABEL(text), markup);
+		gtk_widget_set_tooltip_text(program[i].label, tip);
+	}
+	return TRUE;
+}
+
+/* Program and memory files. Programs are saved as listings
+ * (il_listing.h), memory as a list of the non-zero registers. */
+GtkWidget * main_window;
+GtkWidget * program_list;   // the grid holding the program[] widgets
+
+/* Ask for a file name
+ *
+ * @param action - open or save
+ * @param title  - dialog title
+ * @return - the file name (g_free() it) or NULL if cancelled
+ */
+static gchar * choose_file(GtkFileChooserAction action, const gchar *title){
+	GtkWidget * dialog;
+	gchar * file = NULL;
+
+	dialog = gtk_file_chooser_dialog_new(title, GTK_WINDOW(main_window), action,
+			"_Cancel", GTK_RESPONSE_CANCEL,
+			(action == GTK_FILE_CHOOSER_ACTION_SAVE) ? "_Save" : "_Open", GTK_RESPONSE_ACCEPT,
+			NULL);
+	gtk_file_chooser_set_do_overwrite_confirmation(GTK_FILE_CHOOSER(dialog), TRUE);
+	if(gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_ACCEPT){
+		file = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(dialog));
+	}
+	gtk_widget_destroy(dialog);
+	return file;
+}
+
+/* Find the menudata[] entry of a mnemonic
+ *
+ * @return - the index, or -1 if not in the menu
+ */
+static int menu_index(const gchar *text){
+	int i;
+	for(i = 0; i < MENU_SIZE; i++){
+		if(!strcmp(menudata[i].text, text)) return i;
+	}
+	return -1;
+}
+
+/* Load a program listing into the editor and the debugger */
+void prog_load(void){
+	gchar * file, * text;
+	gsize len;
+	il_line lines[NUM_LINES];
+	size_t err;
+	long n;
+	int i, k;
+	gchar msg[48], name[16];
+
+	if(running || !(file = choose_file(GTK_FILE_CHOOSER_ACTION_OPEN, "Load program"))) return;
+	if(!g_file_get_contents(file, &text, &len, NULL)){
+		gtk_label_set_text(status, "cannot read file");
+		g_free(file);
+		return;
+	}
+	// Parse the whole listing first, so a bad file changes nothing
+	n = il_listing_parse(text, len, lines, NUM_LINES, &err);
+	// The editor can only hold commands in its menu - anything else
+	// would turn into NOP when the program is next read back
+	for(i = 0; i < n; i++){
+		if(menu_index(il_interp_mnemonic(lines[i].cmd, name, sizeof(name))) < 0) break;
+	}
+	if(n < 0){
+		sprintf(msg, "error in line %u", (unsigned)err);
+		gtk_label_set_text(status, msg);
+	} else if(i < n){
+		snprintf(msg, sizeof(msg), "line %d: %s is not in the menu", i, name);
+		gtk_label_set_text(status, msg);
+	} else {
+		// Fill every row with the editor hidden, so it is laid out once
+		gtk_widget_hide(program_list);
+		for(i = 0; i < NUM_LINES; i++){
+			if(i >= n){
+				lines[i].cmd = il_interp_parse("");
+				lines[i].value = 0;
+			}
+			k = menu_index(il_interp_mnemonic(lines[i].cmd, name, sizeof(name)));
+			if(k > 0) gtk_combo_box_set_active_iter(GTK_COMBO_BOX(program[i].command), &menu_iter[k]);
+			else      gtk_combo_box_set_active(GTK_COMBO_BOX(program[i].command), -1);
+			gtk_spin_button_set_value(GTK_SPIN_BUTTON(program[i].value), lines[i].value);
+			il_debug_set_line(&dbg, i, lines[i].cmd, lines[i].value);
+		}
+		gtk_widget_show(program_list);
+		gtk_label_set_text(status, "program loaded");
+	}
+	g_free(text);
+	g_free(file);
+}
+
+/* Save the program as a listing, without trailing empty lines */
+void prog_save(void){
+	gchar * file, * text;
+	size_t len;
+	int n;
+
+	if(running || !(file = choose_file(GTK_FILE_CHOOSER_ACTION_SAVE, "Save program"))) return;
+	load_program();
+	for(n = NUM_LINES; n > 0; n--){
+		if(dbg.orig[n-1].cmd != il_interp_parse("") || dbg.orig[n-1].value) break;
+	}
+	len = il_listing_format(dbg.orig, n, NULL, 0);
+	text = g_malloc(len + 1);
+	il_listing_format(dbg.orig, n, text, len + 1);
+	if(!g_file_set_contents(file, text, len, NULL)){
+		gtk_label_set_text(status, "cannot write file");
+	}
+	g_free(text);
+	g_free(file);
+}
+
+/* Load memory from a file. Registers not listed are unchanged. */
+void memory_load(void){
+	gchar * file, * text;
+	gsize len;
+	uint16_t addr[4 * MEM_SIZE], value[4 * MEM_SIZE];
+	size_t err;
+	long i, n;
+	gchar msg[48];
+
+	if(running || !(file = choose_file(GTK_FILE_CHOOSER_ACTION_OPEN, "Load memory"))) return;
+	if(!g_file_get_contents(file, &text, &len, NULL)){
+		gtk_label_set_text(status, "cannot read file");
+		g_free(file);
+		return;
+	}
+	n = il_listing_parse_memory(text, len, addr, value, 4 * MEM_SIZE, &err);
+	if(n < 0){
+		sprintf(msg, "error in line %u", (unsigned)err);
+		gtk_label_set_text(status, msg);
+	} else {
+		for(i = 0; i < n; i++){
+			il_interp_ctx_poke(&ctx, addr[i], value[i]);
+		}
+		if(dbg.history) il_history_clear(dbg.history);  // can't undo past this
+		gtk_label_set_text(status, "memory loaded");
+	}
+	g_free(text);
+	g_free(file);
+}
+
+/* Save the non-zero registers to a file */
+void memory_save(void){
+	static const uint16_t base[4] = {0, 10000, 30000, 40000};
+	gchar * file;
+	GString * text;
+	int i, j;
+
+	if(running || !(file = choose_file(GTK_FILE_CHOOSER_ACTION_SAVE, "Save memory"))) return;
+	text = g_string_new("");
+	for(j = 0; j < 4; j++){
+		for(i = 0; i < MEM_SIZE; i++){
+			uint16_t value = il_interp_ctx_peek(&ctx, base[j] + i + 1);
+			if(value) g_string_append_printf(text, "%05d %u\n", base[j] + i + 1, value);
+		}
+	}
+	if(!g_file_set_contents(file, text->str, text->len, NULL)){
+		gtk_label_set_text(status, "cannot write file");
+	}
+	g_string_free(text, TRUE);
+	g_free(file);
+}
+
+/* Load the shared constant bank 5xxxx from a table file */
+void const_load(void){
+	gchar * file;
+	size_t err;
+	gchar msg[48];
+
+	if(running || !(file = choose_file(GTK_FILE_CHOOSER_ACTION_OPEN, "Load constants"))) return;
+	if(il_const_load(file, &err)){
+		sprintf(msg, "%u constants loaded", (unsigned)il_const_count);
+	} else if(err){
+		sprintf(msg, "error in line %u", (unsigned)err);
+	} else {
+		strcpy(msg, "cannot read file");
+	}
+	gtk_label_set_text(status, msg);
+	g_free(file);
+}
+
+/* Toggle the breakpoint on a line. New breakpoints take
+ * the condition currently selected in the debug controls.
+ */
+void toggle_break(GtkToggleButton *button, gpointer line){
+	if(gtk_toggle_button_get_active(button)){
+		il_debug_set_break(&dbg, GPOINTER_TO_INT(line),
+				gtk_combo_box_get_active(break_cond),
+				gtk_spin_button_get_value_as_int(break_value));
+	} else {
+		il_debug_clear_break(&dbg, GPOINTER_TO_INT(line));
+	}
+}
+
+/* Toggle the watch on the address in the watch spin-edit */
+void toggle_watch(void){
+	uint16_t addr = gtk_spin_button_get_value_as_int(watch_addr);
+	bool watched = dbg.watch_map[addr >> 3] & (1 << (addr & 7));
+	gchar text[32];
+
+	il_debug_set_watch(&dbg, addr, !watched);
+	sprintf(text, "%s %05d", watched ? "unwatched" : "watching", addr);
+	gtk_label_set_text(status, text);
+}
+
+/* Run to the end of the current instruction list execution,
+ * or until a breakpoint or watched write stops it
+ */
 void run_to_end(void){
 	running = true;
-	while((current_line < NUM_LINES) && !halt){
-		current_line = execute_line(current_line);
-		//show_state();
+	load_program();
+	do{
+		il_trend_clock(&trend, g_get_monotonic_time());
+		stop_reason = il_debug_run(&dbg, 1);
 		if(gtk_events_pending()){
 			gtk_main_iteration();
 		}
-	}
-	if(!halt){
-		current_line = 0;
+	} while(stop_reason == IL_DBG_STEP && !halt);
+	if(stop_reason == IL_DBG_BREAK || stop_reason == IL_DBG_WATCH){
+		halt = true;  // Stop continuous execution too
 	}
 	show_state();
 	running = false;
@@ -418,6 +828,8 @@ activate (GtkApplication *app,
 	grid = gtk_grid_new (); // This will hold the command buttons and Memory
 
 	list = gtk_grid_new();  // This will hold the program commands
+	program_list = list;
+	main_window = window;
 
 	panes = GTK_PANED(gtk_paned_new(GTK_ORIENTATION_HORIZONTAL));
 
@@ -442,6 +854,12 @@ activate (GtkApplication *app,
 	button = gtk_button_new_with_label ("execute");
 	g_signal_connect (button, "clicked", G_CALLBACK (execute_program), NULL);
 	gtk_grid_attach (GTK_GRID (grid), button, 5, 0, 1, 1);
+	button = gtk_button_new_with_label ("back");
+	g_signal_connect (button, "clicked", G_CALLBACK (prog_back), NULL);
+	gtk_grid_attach (GTK_GRID (grid), button, 6, 0, 1, 1);
+	button = gtk_button_new_with_label ("back scan");
+	g_signal_connect (button, "clicked", G_CALLBACK (prog_back_scan), NULL);
+	gtk_grid_attach (GTK_GRID (grid), button, 7, 0, 1, 1);
 	button = gtk_button_new_with_label ("Quit");
 	g_signal_connect_swapped (button, "clicked", G_CALLBACK (app_quit), window);
 	gtk_grid_attach (GTK_GRID (grid), button, 1, 1, 1, 2);
@@ -454,10 +872,63 @@ activate (GtkApplication *app,
 	accum = GTK_SPIN_BUTTON(button);  // Save for later access.
 	gtk_grid_attach (GTK_GRID (grid), button, 6, 1, 1, 1);
 
+	/* The debug controls - watch address, breakpoint condition and status */
+	label = gtk_label_new("Watch");
+	gtk_grid_attach(GTK_GRID(grid), label, 2, 1, 1, 1);
+	button = gtk_spin_button_new_with_range(0.0,49999.0,1);
+	watch_addr = GTK_SPIN_BUTTON(button);
+	gtk_grid_attach (GTK_GRID (grid), button, 3, 1, 1, 1);
+	button = gtk_button_new_with_label ("watch");
+	g_signal_connect (button, "clicked", G_CALLBACK (toggle_watch), NULL);
+	gtk_grid_attach (GTK_GRID (grid), button, 4, 1, 1, 1);
+
+	button = gtk_button_new_with_label ("trend");
+	g_signal_connect (button, "clicked", G_CALLBACK (prog_trend), NULL);
+	gtk_grid_attach (GTK_GRID (grid), button, 7, 1, 1, 1);
+
+	label = gtk_label_new("Break if accum");
+	gtk_grid_attach(GTK_GRID(grid), label, 2, 2, 1, 1);
+	combobox = gtk_combo_box_text_new();
+	// In the order of the IL_DBG_xxx conditions
+	gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(combobox), "any");
+	gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(combobox), "=");
+	gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(combobox), "<>");
+	gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(combobox), ">");
+	gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(combobox), ">=");
+	gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(combobox), "<");
+	gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(combobox), "<=");
+	gtk_combo_box_set_active(GTK_COMBO_BOX(combobox), IL_DBG_ALWAYS);
+	break_cond = GTK_COMBO_BOX(combobox);
+	gtk_grid_attach (GTK_GRID (grid), combobox, 3, 2, 1, 1);
+	button = gtk_spin_button_new_with_range(0.0,65535.0,1);
+	break_value = GTK_SPIN_BUTTON(button);
+	gtk_grid_attach (GTK_GRID (grid), button, 4, 2, 1, 1);
+
+	label = gtk_label_new("");
+	status = GTK_LABEL(label);
+	gtk_grid_attach(GTK_GRID(grid), label, 5, 2, 2, 1);
+
 	/* and the memory label */
 	label = gtk_label_new("Memory");
 	gtk_grid_attach(GTK_GRID(grid), label, 1, 3, 1, 1);
 
+	/* Program and memory files */
+	button = gtk_button_new_with_label ("load prog");
+	g_signal_connect (button, "clicked", G_CALLBACK (prog_load), NULL);
+	gtk_grid_attach (GTK_GRID (grid), button, 3, 3, 1, 1);
+	button = gtk_button_new_with_label ("save prog");
+	g_signal_connect (button, "clicked", G_CALLBACK (prog_save), NULL);
+	gtk_grid_attach (GTK_GRID (grid), button, 4, 3, 1, 1);
+	button = gtk_button_new_with_label ("load mem");
+	g_signal_connect (button, "clicked", G_CALLBACK (memory_load), NULL);
+	gtk_grid_attach (GTK_GRID (grid), button, 5, 3, 1, 1);
+	button = gtk_button_new_with_label ("save mem");
+	g_signal_connect (button, "clicked", G_CALLBACK (memory_save), NULL);
+	gtk_grid_attach (GTK_GRID (grid), button, 6, 3, 1, 1);
+	button = gtk_button_new_with_label ("load const");
+	g_signal_connect (button, "clicked", G_CALLBACK (const_load), NULL);
+	gtk_grid_attach (GTK_GRID (grid), button, 7, 3, 1, 1);
+
 	/* Create the memory store on screen and connect to the memory arrays */
 	for(j = 0; j < 4; j++){
 		uint16_t base;
@@ -493,6 +964,14 @@ activate (GtkApplication *app,
 		}
 	}
 
+	/* The trend display below the memory */
+	trend_area = gtk_drawing_area_new();
+	gtk_widget_set_size_request(trend_area, 400, 150);
+	g_signal_connect (trend_area, "draw", G_CALLBACK (draw_trend), NULL);
+	gtk_grid_attach (GTK_GRID (grid), trend_area, 1, 4+MEM_SIZE, 7, 1);
+	il_trend_init(&trend);
+	g_timeout_add(TREND_FRAME_MS, redraw_trend, NULL);
+
 	/* Now the program item entry - Combaination of combobox and spin-edit*/
 
 	model = CreateCommands(); // Create a menu object to select the command
@@ -502,9 +981,10 @@ activate (GtkApplication *app,
 		gchar * label_text[10];
 		GtkWidget* label;
 
-		/* The label / line number - starting at 0 */
+		/* The label / line number - starting at 0. Click to toggle a breakpoint */
 		sprintf((char*)label_text, "%d", i);
-		label = gtk_label_new((const gchar*)label_text);
+		label = gtk_toggle_button_new_with_label((const gchar*)label_text);
+		g_signal_connect (label, "toggled", G_CALLBACK (toggle_break), GINT_TO_POINTER(i));
 
 		/* The command with command selection menu */
 		combobox = gtk_combo_box_new_with_model(model);
@@ -533,6 +1013,17 @@ activate (GtkApplication *app,
 	}
 	g_object_unref(model); // model now owned by combobox...
 
+	/* The interpreter context uses the display as its memory */
+	il_interp_ctx_init(&ctx, &mc);
+	il_debug_init(&dbg, &ctx, NUM_LINES);
+	if(il_history_init(&history, HISTORY_SNAPSHOTS, HISTORY_WRITES, HISTORY_INTERVAL)){
+		il_debug_set_history(&dbg, &history);
+	}
+	if(il_profile_init(&profile, NUM_LINES) && il_profile_init(&profile_shown, NUM_LINES)){
+		il_debug_set_profile(&dbg, &profile);
+		g_timeout_add(HEAT_PERIOD_MS, update_heat, NULL);
+	}
+
 
 	/* After packing the widgets, show them all in one go, by calling
      * gtk_widget_show_all() on the window.
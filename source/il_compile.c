@@ -0,0 +1,496 @@
+/*
+ * il_compile.c
+ *
+ * Pre-decoded IL programs.
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+#include <stdlib.h>
+#include "il_compile.h"
+#include "il_opcodes.h"
+#include "il_const.h"
+
+/* Binary operators, in command code order from CMD_AND */
+#define ALU_OPS(X) \
+	X(AND) X(OR) X(XOR) X(ADD) X(SUB) X(MUL) X(DIV) \
+	X(GT)  X(GE) X(EQ)  X(NE)  X(LE)  X(LT)
+
+/* Comparisons, which may be fused with a following conditional jump */
+#define CMP_OPS(X) X(GT) X(GE) X(EQ) X(NE) X(LE) X(LT)
+
+#define ALU_AND(a, b) ((a) & (b))
+#define ALU_OR(a, b)  ((a) | (b))
+#define ALU_XOR(a, b) ((a) ^ (b))
+#define ALU_ADD(a, b) ((a) + (b))
+#define ALU_SUB(a, b) ((a) - (b))
+#define ALU_MUL(a, b) ((a) * (b))
+#define ALU_DIV(a, b) ((b) ? (a) / (b) : IL_DIV_ZERO_RESULT)
+#define ALU_GT(a, b)  ((a) > (b))
+#define ALU_GE(a, b)  ((a) >= (b))
+#define ALU_EQ(a, b)  ((a) == (b))
+#define ALU_NE(a, b)  ((a) != (b))
+#define ALU_LE(a, b)  ((a) <= (b))
+#define ALU_LT(a, b)  ((a) < (b))
+
+/* Compiled operations. Every binary operator has four forms -
+ * immediate (_I), bit register (_B), word register (_W) and
+ * constant bank (_K). */
+enum{
+	OP_GENERIC,   // il_interp_ctx_execute(cmd, arg)
+	OP_NOP,
+	OP_IMM,       // accum = k
+	OP_LDB,       // accum = bit ^ k
+	OP_LDW,       // accum = word ^ k
+	OP_LDK,       // accum = constant ^ k
+	OP_STB,       // bit = (accum != 0) ^ k
+	OP_STW,       // word = accum ^ k
+	OP_PUTB_T,    // if accum, bit = k   (SET, RST)
+	OP_PUTB_F,    // if !accum, bit = k  (SET_N, RST_N)
+	OP_PUTW_T,
+	OP_PUTW_F,
+	OP_JMP,
+	OP_JMP_T,     // jump if accum
+	OP_JMP_F,     // jump if !accum
+	OP_SWW,       // jump table on a word (k = table)
+	OP_SWK,       // jump table on a constant
+	OP_SHL,       // accum <<= k          (MUL_I by a power of 2)
+	OP_SHR,       // accum >>= k          (DIV_I by a power of 2)
+	OP_MAGIC,     // accum = accum * m >> 32, m = arg:k  (other DIV_I)
+	OP_BOOL,      // accum = accum != 0   (GT_I 0, NE_I 0)
+	OP_NOT,       // accum = accum == 0   (EQ_I 0, LE_I 0)
+#define X(name) OP_##name##_I, OP_##name##_B, OP_##name##_W, OP_##name##_K,
+	ALU_OPS(X)
+#undef X
+	// Compare with k, then jump to arg if the result is bank (1 or 0)
+#define X(name) OP_CJ_##name,
+	CMP_OPS(X)
+#undef X
+};
+
+/* Compile one line */
+static void compile_line(il_op *op, uint16_t cmd, uint16_t value){
+	uint16_t code = cmd & CMD_MASK;
+	bool neg = (cmd & FLG_NEG) != 0;
+	int bank, index;
+	bool reg = il_image_decode(value, &bank, &index);
+	bool bit = reg && bank < 2;
+	int cindex = 0;
+	bool cnst = !reg && il_const_decode(value, &cindex);
+
+	op->op = OP_GENERIC;
+	op->bank = reg ? bank : 0;
+	op->arg = reg ? index : value;
+	op->k = 0;
+	op->cmd = cmd;
+
+	if(cmd & (FLG_PAR | FLG_FLT)){
+		op->arg = value;
+		return;    // delayed evaluation and floats stay on the generic op
+	}
+
+	switch(code){
+	case CMD_NOP:
+		op->op = OP_NOP;
+		break;
+	case CMD_LOAD:
+		if(cmd & FLG_IMM){
+			op->op = OP_IMM;
+			op->k = value;
+		} else if(reg){
+			op->op = bit ? OP_LDB : OP_LDW;
+			op->k = neg ? (bit ? 1 : 0xFFFF) : 0;
+		} else if(cnst){
+			op->op = OP_LDK;
+			op->arg = cindex;
+			op->k = neg ? 0xFFFF : 0;
+		} else {
+			op->op = OP_IMM;   // invalid address reads 0
+		}
+		break;
+	case CMD_STOR:
+		if(reg){
+			op->op = bit ? OP_STB : OP_STW;
+			op->k = neg ? (bit ? 1 : 0xFFFF) : 0;
+		} else {
+			op->op = OP_NOP;   // invalid address writes are ignored
+		}
+		break;
+	case CMD_SET:
+	case CMD_RST:
+		if(reg){
+			op->op = bit ? (neg ? OP_PUTB_F : OP_PUTB_T) : (neg ? OP_PUTW_F : OP_PUTW_T);
+			op->k = (code == CMD_SET) ? 1 : 0;
+		} else {
+			op->op = OP_NOP;
+		}
+		break;
+	case CMD_JMP:
+		op->arg = value;
+		if(!(cmd & FLG_CND)) op->op = OP_JMP;
+		else                 op->op = neg ? OP_JMP_F : OP_JMP_T;
+		break;
+	case CMD_AND: case CMD_OR:  case CMD_XOR: case CMD_ADD:
+	case CMD_SUB: case CMD_MUL: case CMD_DIV: case CMD_GT:
+	case CMD_GE:  case CMD_EQ:  case CMD_NE:  case CMD_LE:
+	case CMD_LT:
+		if(cmd & FLG_IMM){
+			op->op = OP_AND_I + 4 * (code - CMD_AND);
+			op->k = neg ? (uint16_t)~value : value;
+		} else if(reg){
+			op->op = OP_AND_I + 4 * (code - CMD_AND) + (bit ? 1 : 2);
+			op->k = neg ? 0xFFFF : 0;
+		} else if(cnst){
+			op->op = OP_AND_I + 4 * (code - CMD_AND) + 3;
+			op->arg = cindex;
+			op->k = neg ? 0xFFFF : 0;
+		} else {
+			// Invalid address reads 0
+			op->op = OP_AND_I + 4 * (code - CMD_AND);
+			op->k = neg ? 0xFFFF : 0;
+		}
+		break;
+	default:
+		// CALL, RET, '}', trap and anything newer
+		op->arg = value;
+		break;
+	}
+}
+
+/******************************************
+ * Strength reduction of operators with a
+ * constant operand
+ ******************************************/
+
+static int log2_exact(uint16_t k){
+	int n = 0;
+	if(!k || (k & (k - 1))) return -1;
+	while(k >>= 1) n++;
+	return n;
+}
+
+static void set_imm(il_op *op, uint16_t k){
+	op->op = OP_IMM;
+	op->k = k;
+}
+
+/* Replace an immediate operator by a cheaper equivalent.
+ * Divides by a constant become a shift, or a multiply by the
+ * rounded up reciprocal 2^32/k, which is exact for every 16-bit
+ * dividend. A constant zero divisor is resolved here. */
+static void reduce_line(il_op *op){
+	uint16_t k = op->k;
+	int n;
+
+	switch(op->op){
+	case OP_ADD_I: case OP_SUB_I: case OP_OR_I: case OP_XOR_I:
+		if(k == 0) op->op = OP_NOP;
+		break;
+	case OP_AND_I:
+		if(k == 0xFFFF) op->op = OP_NOP;
+		else if(k == 0) set_imm(op, 0);
+		break;
+	case OP_MUL_I:
+		if(k == 0) set_imm(op, 0);
+		else if(k == 1) op->op = OP_NOP;
+		else if((n = log2_exact(k)) > 0){
+			op->op = OP_SHL;
+			op->k = n;
+		}
+		break;
+	case OP_DIV_I:
+		if(k == 0) set_imm(op, IL_DIV_ZERO_RESULT);
+		else if(k == 1) op->op = OP_NOP;
+		else if((n = log2_exact(k)) > 0){
+			op->op = OP_SHR;
+			op->k = n;
+		} else {
+			uint32_t m = 0xFFFFFFFFUL / k + 1;
+			op->op = OP_MAGIC;
+			op->arg = m >> 16;
+			op->k = m & 0xFFFF;
+		}
+		break;
+	case OP_GT_I:
+		if(k == 0) op->op = OP_BOOL;
+		else if(k == 0xFFFF) set_imm(op, 0);
+		break;
+	case OP_GE_I:
+		if(k == 0) set_imm(op, 1);
+		break;
+	case OP_LT_I:
+		if(k == 0) set_imm(op, 0);
+		break;
+	case OP_LE_I:
+		if(k == 0) op->op = OP_NOT;
+		else if(k == 0xFFFF) set_imm(op, 1);
+		break;
+	case OP_EQ_I:
+		if(k == 0) op->op = OP_NOT;
+		break;
+	case OP_NE_I:
+		if(k == 0) op->op = OP_BOOL;
+		break;
+	}
+}
+
+/* Fuse an immediate compare with the conditional jump after it */
+static void fuse_compare(il_op *op, const il_op *next){
+	if(next->op != OP_JMP_T && next->op != OP_JMP_F) return;
+	switch(op->op){
+#define X(name) case OP_##name##_I: op->op = OP_CJ_##name; break;
+	CMP_OPS(X)
+#undef X
+	default: return;
+	}
+	op->arg = next->arg;
+	op->bank = (next->op == OP_JMP_T);
+}
+
+/******************************************
+ * Compare chains to jump tables
+ ******************************************/
+
+#define CHAIN_MIN    3     // shortest chain worth a table
+#define CHAIN_SPREAD 4     // most table entries per compare, beyond CHAIN_SLACK
+#define CHAIN_SLACK  16
+
+/* Length of the compare chain starting at line i, 0 if none */
+static uint16_t chain_length(const il_line *p, uint16_t lines, uint16_t i){
+	uint16_t n = 0;
+	uint32_t j;
+	uint16_t load = p[i].cmd;
+
+	if(load != CMD_LOAD && load != (CMD_LOAD | FLG_NEG)) return 0;
+	for(j = i; j + 2 < lines; j += 3, n++){
+		if(p[j].cmd != load || p[j].value != p[i].value
+				|| p[j+1].cmd != (CMD_EQ | FLG_IMM)
+				|| p[j+2].cmd != (CMD_JMP | FLG_CND)) break;
+	}
+	return n;
+}
+
+/* Replace the chain of n compares at line i with a jump table */
+static bool build_table(il_compiled *c, const il_line *p, uint16_t i, uint16_t n){
+	il_op * op = &c->ops[i];
+	il_jump_table * t;
+	il_jump_entry * e;
+	uint16_t lo = 0xFFFF, hi = 0, j;
+	uint32_t size, k;
+
+	if(op->op != OP_LDW && op->op != OP_LDK) return true;   // bit or invalid register
+	for(j = 0; j < n; j++){
+		uint16_t key = p[i + 3*j + 1].value;
+		if(key < lo) lo = key;
+		if(key > hi) hi = key;
+	}
+	size = (uint32_t)hi - lo + 1;
+	if(size > (uint32_t)CHAIN_SPREAD * n + CHAIN_SLACK) return true;   // too sparse
+
+	t = realloc(c->table, (c->tables + 1) * sizeof(il_jump_table));
+	if(!t) return false;
+	c->table = t;
+	e = realloc(c->entry, (c->entries + size) * sizeof(il_jump_entry));
+	if(!e) return false;
+	c->entry = e;
+
+	t = &c->table[c->tables];
+	t->base = lo;
+	t->size = (uint16_t)size;
+	t->mask = op->k;
+	t->fall = i + 3*n;
+	t->fall_steps = 3*n - 1;    // the LOAD itself is counted by the scan loop
+	t->first = c->entries;
+	e = &c->entry[c->entries];
+	for(k = 0; k < size; k++) e[k].line = IL_JUMP_NONE;
+	for(j = n; j-- > 0;){       // backwards, so the first compare of a key wins
+		il_jump_entry * x = &e[p[i + 3*j + 1].value - lo];
+		x->line = p[i + 3*j + 2].value;
+		x->steps = 3*j + 2;
+	}
+	op->op = (op->op == OP_LDW) ? OP_SWW : OP_SWK;
+	op->k = c->tables++;
+	c->entries += size;
+	return true;
+}
+
+/******************************************
+ * Interface functions
+ ******************************************/
+
+/* Compile a program */
+bool il_compile(const il_line *program, uint16_t lines, il_compiled *out){
+	uint16_t i;
+
+	out->ops = malloc((lines ? lines : 1) * sizeof(il_op));
+	if(!out->ops) return false;
+	out->lines = lines;
+	out->generic = 0;
+	out->table = NULL;
+	out->entry = NULL;
+	out->tables = 0;
+	out->entries = 0;
+	for(i = 0; i < lines; i++){
+		compile_line(&out->ops[i], program[i].cmd, program[i].value);
+		reduce_line(&out->ops[i]);
+		if(out->ops[i].op == OP_GENERIC) out->generic++;
+	}
+	for(i = 0; i + 1 < lines; i++){
+		fuse_compare(&out->ops[i], &out->ops[i + 1]);
+	}
+	for(i = 0; i < lines; i++){
+		uint16_t n = chain_length(program, lines, i);
+		if(n < CHAIN_MIN) continue;
+		if(!build_table(out, program, i, n)){
+			il_compiled_free(out);
+			return false;
+		}
+		i += 3*n - 1;
+	}
+	return true;
+}
+
+/* Release a compiled program */
+void il_compiled_free(il_compiled *c){
+	free(c->ops);
+	free(c->table);
+	free(c->entry);
+	c->ops = NULL;
+	c->table = NULL;
+	c->entry = NULL;
+	c->lines = 0;
+	c->tables = 0;
+	c->entries = 0;
+}
+
+/* Dispatch through a jump table. Returns the next line. If the
+ * chain would run past the step limit, just does the LOAD, so the
+ * limit stops the scan on the same line as the reference would. */
+static inline uint16_t dispatch(const il_compiled *c, const il_op *o, uint16_t v, uint16_t line,
+		uint16_t *accum, uint32_t *steps, uint32_t limit){
+	const il_jump_table * t = &c->table[o->k];
+	uint16_t i = v - t->base;
+	uint16_t target = t->fall, cost = t->fall_steps;
+	bool hit = i < t->size && c->entry[t->first + i].line != IL_JUMP_NONE;
+
+	if(hit){
+		target = c->entry[t->first + i].line;
+		cost = c->entry[t->first + i].steps;
+	}
+	if(*steps + cost > limit){
+		*accum = v;
+		return line;
+	}
+	*steps += cost;
+	*accum = hit;    // the last EQ_I of the chain
+	return target;
+}
+
+/* Run one scan of a compiled program */
+uint32_t il_compiled_scan(const il_compiled *c, il_context *ctx, uint32_t limit, bool *overrun){
+	il_memory_image * img = ctx->image;
+	const il_op * ops = c->ops;
+	uint16_t accum = ctx->accum;
+	uint16_t line = 0;
+	uint32_t steps = 0;
+
+	*overrun = false;
+	while(line < c->lines){
+		const il_op * o = &ops[line];
+		if(steps == limit){
+			*overrun = true;
+			break;
+		}
+		steps++;
+		line++;
+		switch(o->op){
+		case OP_GENERIC:
+			ctx->accum = accum;
+			line = il_interp_ctx_execute(ctx, o->cmd, o->arg, line - 1);
+			accum = ctx->accum;
+			break;
+		case OP_NOP:
+			break;
+		case OP_IMM:
+			accum = o->k;
+			break;
+		case OP_LDB:
+			accum = img->bits[o->bank][o->arg] ^ o->k;
+			break;
+		case OP_LDW:
+			accum = img->words[o->bank - 2][o->arg] ^ o->k;
+			break;
+		case OP_LDK:
+			accum = il_const_get(o->arg) ^ o->k;
+			break;
+		case OP_STB:
+			img->bits[o->bank][o->arg] = (accum != 0) ^ o->k;
+			break;
+		case OP_STW:
+			img->words[o->bank - 2][o->arg] = accum ^ o->k;
+			break;
+		case OP_PUTB_T: if(accum)  img->bits[o->bank][o->arg] = o->k; break;
+		case OP_PUTB_F: if(!accum) img->bits[o->bank][o->arg] = o->k; break;
+		case OP_PUTW_T: if(accum)  img->words[o->bank - 2][o->arg] = o->k; break;
+		case OP_PUTW_F: if(!accum) img->words[o->bank - 2][o->arg] = o->k; break;
+		case OP_JMP:
+			line = o->arg;
+			break;
+		case OP_JMP_T: if(accum)  line = o->arg; break;
+		case OP_JMP_F: if(!accum) line = o->arg; break;
+		case OP_SWW:
+			line = dispatch(c, o, img->words[o->bank - 2][o->arg] ^ c->table[o->k].mask, line, &accum, &steps, limit);
+			break;
+		case OP_SWK:
+			line = dispatch(c, o, il_const_get(o->arg) ^ c->table[o->k].mask, line, &accum, &steps, limit);
+			break;
+		case OP_SHL:   accum = (uint16_t)(accum << o->k); break;
+		case OP_SHR:   accum >>= o->k; break;
+		case OP_MAGIC: accum = (uint16_t)((accum * (((uint64_t)o->arg << 16) | o->k)) >> 32); break;
+		case OP_BOOL:  accum = (accum != 0); break;
+		case OP_NOT:   accum = (accum == 0); break;
+#define X(name) \
+		case OP_##name##_I: accum = (uint16_t)ALU_##name(accum, o->k); break; \
+		case OP_##name##_B: accum = (uint16_t)ALU_##name(accum, (uint16_t)(img->bits[o->bank][o->arg] ^ o->k)); break; \
+		case OP_##name##_W: accum = (uint16_t)ALU_##name(accum, (uint16_t)(img->words[o->bank - 2][o->arg] ^ o->k)); break; \
+		case OP_##name##_K: accum = (uint16_t)ALU_##name(accum, (uint16_t)(il_const_get(o->arg) ^ o->k)); break;
+		ALU_OPS(X)
+#undef X
+		// Fused compare and jump - the jump line counts as a step
+#define X(name) \
+		case OP_CJ_##name: \
+			accum = ALU_##name(accum, o->k); \
+			if(steps < limit){ \
+				steps++; \
+				line = ((accum != 0) == o->bank) ? o->arg : line + 1; \
+			} \
+			break;
+		CMP_OPS(X)
+#undef X
+		}
+	}
+	ctx->accum = accum;
+	return steps;
+}
@@ -0,0 +1,125 @@
+/*
+ * il_compile.h
+ *
+ * Pre-decoded form of an IL program for contexts with a flat memory
+ * image. Every line is decoded once - command, flags and register
+ * address resolved to a bank and index - so a scan is a single
+ * switch per line with no parsing, address decoding or function
+ * call. Lines the compiler has no fast form for use a generic op
+ * that calls il_interp_ctx_execute(), so the compiled form always
+ * behaves exactly like the reference interpreter. Line numbers are
+ * kept, so jump targets are unchanged.
+ *
+ * State machine dispatch written as a chain of
+ *     LOAD a ; EQ_I k ; JUMP_C target
+ * on one word or constant register is replaced by a single bounded
+ * jump table lookup at the first LOAD. The accumulator is left as the
+ * chain leaves it (1 after a match, 0 after falling through), and the
+ * chain's lines are still counted against the scan's step limit. The
+ * other lines of the chain are unchanged, so jumps into the middle of
+ * it still work.
+ *
+ * Operators with a constant operand are reduced: MUL_I and DIV_I by
+ * powers of two become shifts, and other DIV_I a multiply by the
+ * reciprocal. A constant zero divisor gives IL_DIV_ZERO_RESULT with
+ * no run-time test. Identities (ADD_I 0, MUL_I 1, ...) become no-ops,
+ * and compares with 0 or 65535 become tests or constants. A compare
+ * with a constant followed by JUMP_C or JUMP_CN runs as one op.
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+
+#ifndef IL_COMPILE_H_
+#define IL_COMPILE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "il_unit.h"
+
+/* One compiled line */
+typedef struct{
+	uint8_t op;      // compiled operation (private to il_compile.c)
+	uint8_t bank;    // IL_BANK_xxx of a register operand
+	uint16_t arg;    // index in bank, jump target, or the line's value
+	uint16_t k;      // constant - immediate, or invert mask
+	uint16_t cmd;    // the original command code, for the generic op
+} il_op;
+
+/* Jump table replacing a compare chain - repeated
+ *     LOAD a ; EQ_I k ; JUMP_C target
+ * on the same register. Key v selects entry v - base. */
+typedef struct{
+	uint16_t base;       // smallest key
+	uint16_t size;       // number of entries
+	uint16_t mask;       // invert mask of the LOAD
+	uint16_t fall;       // line after the chain
+	uint16_t fall_steps; // lines the chain executes when nothing matches
+	uint32_t first;      // first entry in il_compiled.entry
+} il_jump_table;
+
+typedef struct{
+	uint16_t line;       // jump target, IL_JUMP_NONE for no match
+	uint16_t steps;      // lines the chain executes to reach it
+} il_jump_entry;
+
+#define IL_JUMP_NONE 0xFFFF
+
+typedef struct{
+	il_op * ops;
+	uint16_t lines;
+	uint16_t generic;    // lines left to the generic op
+	il_jump_table * table;
+	il_jump_entry * entry;
+	uint16_t tables;     // compare chains replaced by jump tables
+	uint32_t entries;
+} il_compiled;
+
+/* Compile a program
+ *
+ * @param program - the program lines
+ * @param lines   - number of lines
+ * @param out     - the compiled program
+ * @return - true if compiled. false if out of memory.
+ */
+bool il_compile(const il_line *program, uint16_t lines, il_compiled *out);
+
+/* Release a compiled program */
+void il_compiled_free(il_compiled *c);
+
+/* Run one scan of a compiled program, from line 0 until execution
+ * runs off the end. The context must have a memory image and no
+ * write watch.
+ *
+ * @param c       - the compiled program
+ * @param ctx     - the context
+ * @param limit   - most lines to execute
+ * @param overrun - set true if the scan was stopped by limit
+ * @return - number of lines executed
+ */
+uint32_t il_compiled_scan(const il_compiled *c, il_context *ctx, uint32_t limit, bool *overrun);
+
+#endif /* IL_COMPILE_H_ */
@@ -0,0 +1,161 @@
+/*
+ * il_const.c
+ *
+ * Shared read-only constant bank.
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+#include "il_const.h"
+#include "il_listing.h"
+
+const uint16_t * il_const_table = NULL;
+uint16_t il_const_count = 0;
+
+static size_t map_size;
+
+/******************************************
+ * Table memory. A private mapping made
+ * read-only once filled where mmap exists,
+ * else (Windows) a plain heap block.
+ ******************************************/
+
+/* Allocate a zeroed table, NULL on failure */
+static uint16_t * table_alloc(size_t size){
+#ifdef _WIN32
+	return calloc(1, size);
+#else
+	void * p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	return (p == MAP_FAILED) ? NULL : p;
+#endif
+}
+
+/* Make a filled table read-only */
+static bool table_protect(uint16_t *table, size_t size){
+#ifdef _WIN32
+	(void)table; (void)size;
+	return true;
+#else
+	return mprotect(table, size, PROT_READ) == 0;
+#endif
+}
+
+static void table_free(const uint16_t *table, size_t size){
+#ifdef _WIN32
+	(void)size;
+	free((void *)table);
+#else
+	munmap((void *)table, size);
+#endif
+}
+
+/* Build the bank in a fresh table, then make it read-only */
+static bool publish(const uint16_t *addr, const uint16_t *value, size_t n, uint16_t count){
+	size_t size = (count ? count : 1) * sizeof(uint16_t);
+	uint16_t * table;
+	size_t i;
+	int index;
+
+	table = table_alloc(size);
+	if(!table) return false;
+	for(i = 0; i < n; i++){
+		if(!addr) index = (int)i;
+		else if(!il_const_decode(addr[i], &index)) continue;
+		table[index] = value[i];
+	}
+	if(!table_protect(table, size)){
+		table_free(table, size);
+		return false;
+	}
+	il_const_unload();
+	il_const_table = table;
+	il_const_count = count;
+	map_size = size;
+	return true;
+}
+
+/******************************************
+ * Interface functions
+ ******************************************/
+
+/* Load the constant bank from a table file */
+bool il_const_load(const char *path, size_t *error_line){
+	FILE * f = fopen(path, "rb");
+	char * text = NULL;
+	uint16_t * addr = NULL, * value = NULL;
+	long len, n, i;
+	uint16_t count = 0;
+	bool ok = false;
+	int index;
+
+	if(error_line) *error_line = 0;
+	if(!f) return false;
+	if(fseek(f, 0, SEEK_END) || (len = ftell(f)) < 0 || fseek(f, 0, SEEK_SET)) goto done;
+	text = malloc(len + 1);
+	// One register per line at most, so lines bounds the count
+	addr = malloc((len / 2 + 1) * sizeof(uint16_t));
+	value = malloc((len / 2 + 1) * sizeof(uint16_t));
+	if(!text || !addr || !value || fread(text, 1, len, f) != (size_t)len) goto done;
+
+	n = il_listing_parse_memory(text, len, addr, value, len / 2 + 1, error_line);
+	if(n < 0) goto done;
+	for(i = 0; i < n; i++){
+		if(!il_const_decode(addr[i], &index)){
+			// Parsing again with room for only i registers stops at the bad line
+			if(error_line) il_listing_parse_memory(text, len, addr, value, i, error_line);
+			goto done;
+		}
+		if(index + 1 > count) count = index + 1;
+	}
+	ok = publish(addr, value, n, count);
+
+done:
+	fclose(f);
+	free(text);
+	free(addr);
+	free(value);
+	return ok;
+}
+
+/* Load the constant bank from an array */
+bool il_const_set(const uint16_t *values, uint16_t count){
+	if(count > IL_CONST_BANK_SIZE) return false;
+	return publish(NULL, values, count, count);
+}
+
+/* Release the constant bank */
+void il_const_unload(void){
+	if(il_const_table) table_free(il_const_table, map_size);
+	il_const_table = NULL;
+	il_const_count = 0;
+	map_size = 0;
+}
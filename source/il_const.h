@@ -0,0 +1,100 @@
+/*
+ * il_const.h
+ *
+ * Shared read-only constant bank 5xxxx, for lookup tables, recipes
+ * and scaling constants used by every unit. The bank is loaded once
+ * per process into a single table that all interpreter contexts
+ * read. Where mmap is available the table is a mapping made read-only
+ * by the OS. On Windows it is a plain heap block. Programs read it
+ * like any other register with LOAD and the operator commands.
+ * Writes to 5xxxx are ignored.
+ *
+ * Table file - a memory listing (il_listing.h) of 5xxxx registers:
+ *
+ *     50001 120     ; curve point 1
+ *     50002 245
+ *
+ * Every register 50001 .. 59999 that is not listed reads 0.
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+
+#ifndef IL_CONST_H_
+#define IL_CONST_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define IL_CONST_BANK_SIZE 9999   // 50001 .. 59999
+
+/* The loaded bank - register 5NNNN is il_const_table[NNNN-1].
+ * NULL and 0 until a table is loaded. */
+extern const uint16_t * il_const_table;
+extern uint16_t il_const_count;
+
+/* Turn a 5xxxx address into an index of the constant bank
+ *
+ * @param addr  - the modbus style address
+ * @param index - pointer to store the index
+ * @return - true if addr is in the 5xxxx range (loaded or not)
+ */
+static inline bool il_const_decode(uint16_t addr, int *index){
+	int i = addr % 10000;
+	if(addr / 10000 != 5 || i == 0) return false;
+	*index = i - 1;
+	return true;
+}
+
+/* Read a constant by index, 0 if beyond the loaded table */
+static inline uint16_t il_const_get(int index){
+	return (index < il_const_count) ? il_const_table[index] : 0;
+}
+
+/* Load the constant bank from a table file, replacing any bank
+ * already loaded. Call before any unit scans.
+ *
+ * @param path       - the table file
+ * @param error_line - set to the text line (from 1) of an error, may be NULL
+ * @return - true if loaded. false if the file cannot be read, a line
+ *           is bad or an address is not 5xxxx.
+ */
+bool il_const_load(const char *path, size_t *error_line);
+
+/* Load the constant bank from an array, replacing any bank already
+ * loaded. Call before any unit scans.
+ *
+ * @param values - the values of 50001 onwards
+ * @param count  - number of values (up to IL_CONST_BANK_SIZE)
+ * @return - true if loaded
+ */
+bool il_const_set(const uint16_t *values, uint16_t count);
+
+/* Release the constant bank. 5xxxx reads 0 again. */
+void il_const_unload(void);
+
+#endif /* IL_CONST_H_ */
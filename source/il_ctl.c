@@ -0,0 +1,588 @@
+/*
+ * il_ctl.c
+ *
+ * Local control socket with a batched binary command protocol.
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "il_ctl.h"
+
+#define CTL_MAX_CLIENTS 8
+#define CTL_MAX_SUBS    16   // subscriptions per client
+#define CTL_MAX_MNEMONIC 15
+#define CTL_MAX_QUEUED  (2 * IL_CTL_MAX_FRAME)   // unsent output before a client is dropped
+
+/* A subscription to a register range of a unit */
+typedef struct{
+	bool active;
+	uint32_t unit;
+	uint16_t addr;
+	uint16_t count;
+	uint16_t * last;     // values last reported
+} ctl_sub;
+
+/* Growable output buffer */
+typedef struct{
+	uint8_t * data;
+	size_t len;
+	size_t size;
+	bool failed;
+} ctl_buf;
+
+/* A connected client */
+typedef struct{
+	int fd;              // non-blocking
+	uint8_t * rbuf;      // received, not yet processed
+	size_t rlen;
+	size_t rsize;
+	ctl_buf wq;          // output the socket has not taken yet
+	ctl_sub sub[CTL_MAX_SUBS];
+} ctl_client;
+
+/* Bounds checked input cursor */
+typedef struct{
+	const uint8_t * p;
+	const uint8_t * end;
+	bool bad;
+} ctl_in;
+
+struct il_ctl{
+	int fd;
+	char * path;
+	il_unit ** units;
+	uint32_t count;
+	uint16_t * line;     // STEP position of each unit
+	ctl_client client[CTL_MAX_CLIENTS];
+	ctl_buf out;
+};
+
+/******************************************
+ * Encoding helpers
+ ******************************************/
+
+static void put(ctl_buf *b, const void *src, size_t n){
+	if(b->failed) return;
+	if(b->len + n > b->size){
+		size_t size = b->size ? b->size : 256;
+		uint8_t * data;
+		while(size < b->len + n) size *= 2;
+		data = realloc(b->data, size);
+		if(!data){
+			b->failed = true;
+			return;
+		}
+		b->data = data;
+		b->size = size;
+	}
+	memcpy(b->data + b->len, src, n);
+	b->len += n;
+}
+
+static void put_u8(ctl_buf *b, uint8_t v){
+	put(b, &v, 1);
+}
+
+static void put_u16(ctl_buf *b, uint16_t v){
+	uint8_t d[2] = { (uint8_t)v, (uint8_t)(v >> 8) };
+	put(b, d, 2);
+}
+
+static void put_u32(ctl_buf *b, uint32_t v){
+	uint8_t d[4] = { (uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24) };
+	put(b, d, 4);
+}
+
+static const uint8_t * get(ctl_in *in, size_t n){
+	const uint8_t * p = in->p;
+	if(in->bad || (size_t)(in->end - in->p) < n){
+		in->bad = true;
+		return NULL;
+	}
+	in->p += n;
+	return p;
+}
+
+static uint8_t get_u8(ctl_in *in){
+	const uint8_t * p = get(in, 1);
+	return p ? p[0] : 0;
+}
+
+static uint16_t get_u16(ctl_in *in){
+	const uint8_t * p = get(in, 2);
+	return p ? (uint16_t)(p[0] | (p[1] << 8)) : 0;
+}
+
+static uint32_t get_u32(ctl_in *in){
+	const uint8_t * p = get(in, 4);
+	return p ? (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+	           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24) : 0;
+}
+
+/* Start a frame - the length is filled in by end_frame() */
+static size_t begin_frame(ctl_buf *b, uint8_t kind){
+	size_t start = b->len;
+	put_u32(b, 0);
+	put_u8(b, kind);
+	return start;
+}
+
+static void end_frame(ctl_buf *b, size_t start){
+	uint32_t len = (uint32_t)(b->len - start - 4);
+	if(b->failed) return;
+	b->data[start]   = (uint8_t)len;
+	b->data[start+1] = (uint8_t)(len >> 8);
+	b->data[start+2] = (uint8_t)(len >> 16);
+	b->data[start+3] = (uint8_t)(len >> 24);
+}
+
+/* True if addr .. addr+count-1 are valid addresses in one bank */
+static bool range_ok(uint16_t addr, uint16_t count){
+	int b1, b2, i1, i2;
+	uint32_t last = (uint32_t)addr + count - 1;
+	if(count == 0) return true;
+	if(last > 0xFFFF) return false;
+	return il_image_decode(addr, &b1, &i1) && il_image_decode((uint16_t)last, &b2, &i2) && b1 == b2;
+}
+
+/******************************************
+ * Operations
+ ******************************************/
+
+static void op_load(il_ctl *ctl, ctl_in *in, il_unit *u, uint32_t unit){
+	uint16_t lines = get_u16(in), i;
+	il_line * prog = malloc((lines ? lines : 1) * sizeof(il_line));
+	char mnemonic[CTL_MAX_MNEMONIC + 1];
+
+	if(!prog){
+		in->bad = true;
+		return;
+	}
+	for(i = 0; i < lines && !in->bad; i++){
+		uint8_t n = get_u8(in);
+		const uint8_t * text = get(in, n);
+		if(!text || n > CTL_MAX_MNEMONIC){
+			in->bad = true;
+			break;
+		}
+		memcpy(mnemonic, text, n);
+		mnemonic[n] = 0;
+		prog[i].cmd = il_interp_parse(mnemonic);
+		prog[i].value = get_u16(in);
+	}
+	if(!in->bad){
+		if(il_unit_load(u, prog, lines)){
+			il_interp_ctx_init_image(&u->ctx, u->ctx.image);
+			ctl->line[unit] = 0;
+			put_u8(&ctl->out, IL_CTL_OK);
+		} else {
+			put_u8(&ctl->out, IL_CTL_ERR_MEMORY);
+		}
+	}
+	free(prog);
+}
+
+static void op_read(il_ctl *ctl, ctl_in *in, il_unit *u){
+	uint16_t addr = get_u16(in), count = get_u16(in), i;
+	if(in->bad) return;
+	if(!range_ok(addr, count)){
+		put_u8(&ctl->out, IL_CTL_ERR_RANGE);
+		return;
+	}
+	put_u8(&ctl->out, IL_CTL_OK);
+	for(i = 0; i < count; i++){
+		put_u16(&ctl->out, il_image_get(u->ctx.image, addr + i, false));
+	}
+}
+
+static void op_write(il_ctl *ctl, ctl_in *in, il_unit *u){
+	uint16_t addr = get_u16(in), count = get_u16(in), i;
+	const uint8_t * data = get(in, 2 * (size_t)count);
+	if(in->bad) return;
+	if(!range_ok(addr, count)){
+		put_u8(&ctl->out, IL_CTL_ERR_RANGE);
+		return;
+	}
+	for(i = 0; i < count; i++){
+		il_unit_input(u, addr + i, (uint16_t)(data[2*i] | (data[2*i+1] << 8)));
+	}
+	put_u8(&ctl->out, IL_CTL_OK);
+}
+
+static void op_step(il_ctl *ctl, ctl_in *in, il_unit *u, uint32_t unit){
+	uint16_t n = get_u16(in), i;
+	if(in->bad) return;
+	for(i = 0; i < n; i++){
+		ctl->line[unit] = il_unit_step(u, ctl->line[unit]);
+	}
+	put_u8(&ctl->out, IL_CTL_OK);
+	put_u16(&ctl->out, ctl->line[unit]);
+	put_u16(&ctl->out, il_interp_ctx_get_accum(&u->ctx));
+}
+
+static void op_run(il_ctl *ctl, ctl_in *in, il_unit *u, uint32_t unit){
+	uint32_t scans = get_u32(in), i, steps = 0;
+	if(in->bad) return;
+	/* finish a scan left part way by STEP */
+	while(ctl->line[unit] != 0 && ++steps <= IL_SCAN_STEP_LIMIT){
+		ctl->line[unit] = il_unit_step(u, ctl->line[unit]);
+	}
+	ctl->line[unit] = 0;
+	for(i = 0; i < scans; i++){
+		il_unit_scan(u);
+	}
+	put_u8(&ctl->out, IL_CTL_OK);
+	put_u16(&ctl->out, ctl->line[unit]);
+	put_u16(&ctl->out, il_interp_ctx_get_accum(&u->ctx));
+}
+
+static void op_snapshot(il_ctl *ctl, il_unit *u, uint32_t unit){
+	const il_memory_image * img = u->ctx.image;
+	int b, i;
+	put_u8(&ctl->out, IL_CTL_OK);
+	put_u16(&ctl->out, IL_IMAGE_BANK_SIZE);
+	put_u16(&ctl->out, ctl->line[unit]);
+	put_u16(&ctl->out, il_interp_ctx_get_accum(&u->ctx));
+	put(&ctl->out, img->bits, sizeof(img->bits));
+	for(b = 0; b < 2; b++){
+		for(i = 0; i < IL_IMAGE_BANK_SIZE; i++) put_u16(&ctl->out, img->words[b][i]);
+	}
+}
+
+static void op_subscribe(il_ctl *ctl, ctl_client *c, ctl_in *in, il_unit *u, uint32_t unit){
+	uint16_t addr = get_u16(in), count = get_u16(in), i;
+	ctl_sub * s = NULL;
+	if(in->bad) return;
+	if(!range_ok(addr, count) || count == 0){
+		put_u8(&ctl->out, IL_CTL_ERR_RANGE);
+		return;
+	}
+	for(i = 0; i < CTL_MAX_SUBS && !s; i++){
+		if(!c->sub[i].active) s = &c->sub[i];
+	}
+	if(!s){
+		put_u8(&ctl->out, IL_CTL_ERR_LIMIT);
+		return;
+	}
+	s->last = malloc(count * sizeof(uint16_t));
+	if(!s->last){
+		put_u8(&ctl->out, IL_CTL_ERR_MEMORY);
+		return;
+	}
+	for(i = 0; i < count; i++) s->last[i] = il_image_get(u->ctx.image, addr + i, false);
+	s->unit = unit;
+	s->addr = addr;
+	s->count = count;
+	s->active = true;
+	put_u8(&ctl->out, IL_CTL_OK);
+}
+
+static void op_unsubscribe(il_ctl *ctl, ctl_client *c, uint32_t unit){
+	int i;
+	for(i = 0; i < CTL_MAX_SUBS; i++){
+		if(c->sub[i].active && c->sub[i].unit == unit){
+			free(c->sub[i].last);
+			c->sub[i].last = NULL;
+			c->sub[i].active = false;
+		}
+	}
+	put_u8(&ctl->out, IL_CTL_OK);
+}
+
+/* Append a notification frame for each subscription with changes */
+static void notify(il_ctl *ctl, ctl_client *c){
+	int i;
+	uint16_t k;
+	for(i = 0; i < CTL_MAX_SUBS; i++){
+		ctl_sub * s = &c->sub[i];
+		il_memory_image * img;
+		size_t start, count_at;
+		uint16_t changes = 0;
+		if(!s->active) continue;
+		img = ctl->units[s->unit]->ctx.image;
+		for(k = 0; k < s->count; k++){
+			if(il_image_get(img, s->addr + k, false) != s->last[k]) break;
+		}
+		if(k == s->count) continue;   // nothing changed
+
+		start = begin_frame(&ctl->out, IL_CTL_FRAME_NOTIFY);
+		put_u32(&ctl->out, s->unit);
+		count_at = ctl->out.len;
+		put_u16(&ctl->out, 0);
+		for(; k < s->count; k++){
+			uint16_t v = il_image_get(img, s->addr + k, false);
+			if(v != s->last[k]){
+				s->last[k] = v;
+				put_u16(&ctl->out, s->addr + k);
+				put_u16(&ctl->out, v);
+				changes++;
+			}
+		}
+		if(!ctl->out.failed){
+			ctl->out.data[count_at]   = (uint8_t)changes;
+			ctl->out.data[count_at+1] = (uint8_t)(changes >> 8);
+		}
+		end_frame(&ctl->out, start);
+	}
+}
+
+/* Execute every operation of a request frame into ctl->out */
+static void serve_frame(il_ctl *ctl, ctl_client *c, const uint8_t *data, size_t len){
+	ctl_in in = { data, data + len, false };
+	size_t start = begin_frame(&ctl->out, IL_CTL_FRAME_RESPONSE);
+
+	while(in.p < in.end && !in.bad){
+		uint8_t op = get_u8(&in);
+		uint32_t unit = get_u32(&in);
+		il_unit * u;
+		if(in.bad) break;
+		if(unit >= ctl->count){
+			/* the rest of the operation cannot be skipped safely */
+			put_u8(&ctl->out, IL_CTL_ERR_UNIT);
+			break;
+		}
+		u = ctl->units[unit];
+		switch(op){
+		case IL_CTL_OP_LOAD:        op_load(ctl, &in, u, unit);         break;
+		case IL_CTL_OP_READ:        op_read(ctl, &in, u);               break;
+		case IL_CTL_OP_WRITE:       op_write(ctl, &in, u);              break;
+		case IL_CTL_OP_STEP:        op_step(ctl, &in, u, unit);         break;
+		case IL_CTL_OP_RUN:         op_run(ctl, &in, u, unit);          break;
+		case IL_CTL_OP_SNAPSHOT:    op_snapshot(ctl, u, unit);          break;
+		case IL_CTL_OP_SUBSCRIBE:   op_subscribe(ctl, c, &in, u, unit); break;
+		case IL_CTL_OP_UNSUBSCRIBE: op_unsubscribe(ctl, c, unit);       break;
+		default:                    in.bad = true;                      break;
+		}
+	}
+	if(in.bad) put_u8(&ctl->out, IL_CTL_ERR_OP);
+	end_frame(&ctl->out, start);
+}
+
+/******************************************
+ * Connections
+ ******************************************/
+
+static void drop_client(ctl_client *c){
+	int i;
+	close(c->fd);
+	c->fd = -1;
+	free(c->rbuf);
+	c->rbuf = NULL;
+	c->rlen = c->rsize = 0;
+	free(c->wq.data);
+	memset(&c->wq, 0, sizeof(c->wq));
+	for(i = 0; i < CTL_MAX_SUBS; i++){
+		free(c->sub[i].last);
+		c->sub[i].last = NULL;
+		c->sub[i].active = false;
+	}
+}
+
+/* Send as much of the client's queue as the socket takes now.
+ * Returns false if the client is gone */
+static bool flush(ctl_client *c){
+	size_t pos = 0;
+	while(pos < c->wq.len){
+		ssize_t n = send(c->fd, c->wq.data + pos, c->wq.len - pos, MSG_NOSIGNAL);
+		if(n < 0){
+			if(errno == EINTR) continue;
+			if(errno == EAGAIN || errno == EWOULDBLOCK) break;
+			return false;
+		}
+		pos += n;
+	}
+	if(pos){
+		memmove(c->wq.data, c->wq.data + pos, c->wq.len - pos);
+		c->wq.len -= pos;
+	}
+	return true;
+}
+
+/* Queue ctl->out for a client and send what the socket takes.
+ * Returns false if the client is gone or has stopped reading */
+static bool queue(il_ctl *ctl, ctl_client *c){
+	if(ctl->out.failed) return false;
+	put(&c->wq, ctl->out.data, ctl->out.len);
+	if(c->wq.failed || !flush(c)) return false;
+	return c->wq.len <= CTL_MAX_QUEUED;
+}
+
+/* Read what is available and serve every complete frame.
+ * Returns the number of frames served, or -1 if the client is gone */
+static int serve_client(il_ctl *ctl, ctl_client *c){
+	ssize_t n;
+	size_t pos = 0;
+	int frames = 0;
+
+	if(c->rsize - c->rlen < 4096){
+		size_t size = c->rsize ? c->rsize * 2 : 8192;
+		uint8_t * buf = realloc(c->rbuf, size);
+		if(!buf) return -1;
+		c->rbuf = buf;
+		c->rsize = size;
+	}
+	n = recv(c->fd, c->rbuf + c->rlen, c->rsize - c->rlen, 0);
+	if(n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+	if(n <= 0) return -1;
+	c->rlen += n;
+
+	ctl->out.len = 0;
+	ctl->out.failed = false;
+	while(c->rlen - pos >= 4){
+		const uint8_t * p = c->rbuf + pos;
+		uint32_t len = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+		if(len > IL_CTL_MAX_FRAME) return -1;
+		if(c->rlen - pos - 4 < len) break;
+		serve_frame(ctl, c, p + 4, len);
+		notify(ctl, c);
+		pos += 4 + len;
+		frames++;
+	}
+	memmove(c->rbuf, c->rbuf + pos, c->rlen - pos);
+	c->rlen -= pos;
+	if(!queue(ctl, c)) return -1;
+	return frames;
+}
+
+/* Push notifications to every client for changes it has not seen,
+ * whatever made them - host scans, or requests of other clients */
+static void notify_all(il_ctl *ctl){
+	int i;
+	for(i = 0; i < CTL_MAX_CLIENTS; i++){
+		ctl_client * c = &ctl->client[i];
+		if(c->fd < 0) continue;
+		ctl->out.len = 0;
+		ctl->out.failed = false;
+		notify(ctl, c);
+		if(!queue(ctl, c)) drop_client(c);
+	}
+}
+
+/******************************************
+ * Interface functions
+ ******************************************/
+
+/* Create the control socket */
+il_ctl * il_ctl_create(const char *path, il_unit **units, uint32_t count){
+	struct sockaddr_un addr;
+	il_ctl * ctl;
+	int i;
+
+	if(strlen(path) >= sizeof(addr.sun_path)) return NULL;
+	ctl = calloc(1, sizeof(*ctl));
+	if(!ctl) return NULL;
+	ctl->units = units;
+	ctl->count = count;
+	ctl->line = calloc(count ? count : 1, sizeof(uint16_t));
+	ctl->path = strdup(path);
+	for(i = 0; i < CTL_MAX_CLIENTS; i++) ctl->client[i].fd = -1;
+	ctl->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(!ctl->line || !ctl->path || ctl->fd < 0){
+		if(ctl->fd >= 0) close(ctl->fd);
+		free(ctl->line);
+		free(ctl->path);
+		free(ctl);
+		return NULL;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+	unlink(path);
+	if(bind(ctl->fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(ctl->fd, CTL_MAX_CLIENTS) != 0){
+		close(ctl->fd);
+		free(ctl->line);
+		free(ctl->path);
+		free(ctl);
+		return NULL;
+	}
+	return ctl;
+}
+
+/* Accept connections and serve requests */
+int il_ctl_poll(il_ctl *ctl, int timeout_ms){
+	struct pollfd pfd[CTL_MAX_CLIENTS + 1];
+	int map[CTL_MAX_CLIENTS + 1];
+	int i, n = 0, served = 0;
+
+	notify_all(ctl);   // changes since the last poll, e.g. by host scans
+	pfd[n].fd = ctl->fd;
+	pfd[n].events = POLLIN;
+	map[n++] = -1;
+	for(i = 0; i < CTL_MAX_CLIENTS; i++){
+		if(ctl->client[i].fd < 0) continue;
+		pfd[n].fd = ctl->client[i].fd;
+		pfd[n].events = POLLIN | (ctl->client[i].wq.len ? POLLOUT : 0);
+		map[n++] = i;
+	}
+	if(poll(pfd, n, timeout_ms) <= 0) return 0;
+
+	for(i = 1; i < n; i++){
+		ctl_client * c = &ctl->client[map[i]];
+		int r = 0;
+		if((pfd[i].revents & POLLOUT) && !flush(c)) r = -1;
+		if(r == 0 && (pfd[i].revents & (POLLIN | POLLHUP | POLLERR))) r = serve_client(ctl, c);
+		if(r < 0) drop_client(c);
+		else served += r;
+	}
+	if(served) notify_all(ctl);   // changes one client made, for the others
+	if(pfd[0].revents & POLLIN){
+		int fd = accept(ctl->fd, NULL, NULL);
+		if(fd >= 0 && fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != 0){
+			close(fd);
+			fd = -1;
+		}
+		if(fd >= 0){
+			for(i = 0; i < CTL_MAX_CLIENTS && ctl->client[i].fd >= 0; i++);
+			if(i < CTL_MAX_CLIENTS) ctl->client[i].fd = fd;
+			else close(fd);   // no room
+		}
+	}
+	return served;
+}
+
+/* Close all connections and remove the socket */
+void il_ctl_destroy(il_ctl *ctl){
+	int i;
+	if(!ctl) return;
+	for(i = 0; i < CTL_MAX_CLIENTS; i++){
+		if(ctl->client[i].fd >= 0) drop_client(&ctl->client[i]);
+	}
+	close(ctl->fd);
+	unlink(ctl->path);
+	free(ctl->path);
+	free(ctl->line);
+	free(ctl->out.data);
+	free(ctl);
+}
@@ -0,0 +1,130 @@
+/*
+ * il_ctl.h
+ *
+ * Local control socket for driving simulated units from automated
+ * tests. A Unix-domain stream socket carrying a compact binary
+ * protocol. Any number of operations may be batched in one request
+ * frame, and all of their results come back in one response frame.
+ *
+ * Protocol - all integers little-endian
+ *
+ *  Request frame:   u32 length, then operations until length is used
+ *  Response frame:  u32 length, u8 IL_CTL_FRAME_RESPONSE, then one
+ *                   result per operation, in order
+ *  Notification:    u32 length, u8 IL_CTL_FRAME_NOTIFY,
+ *                   u32 unit, u16 changes, changes x (u16 addr, u16 value)
+ *
+ *  Every result starts with a u8 status (IL_CTL_OK or an error).
+ *  Data listed after "->" follows only when the status is IL_CTL_OK.
+ *  An operation that cannot be decoded, or names a unit that does not
+ *  exist, ends the batch.
+ *
+ *  IL_CTL_OP_LOAD       u32 unit, u16 lines,
+ *                       lines x (u8 n, n chars mnemonic, u16 value)
+ *  IL_CTL_OP_READ       u32 unit, u16 addr, u16 count  -> count x u16
+ *  IL_CTL_OP_WRITE      u32 unit, u16 addr, u16 count, count x u16
+ *  IL_CTL_OP_STEP       u32 unit, u16 lines       -> u16 line, u16 accum
+ *  IL_CTL_OP_RUN        u32 unit, u32 scans       -> u16 line, u16 accum
+ *  IL_CTL_OP_SNAPSHOT   u32 unit  -> u16 bank size, u16 line, u16 accum,
+ *                       2 x bank size bytes (0xxxx, 1xxxx),
+ *                       2 x bank size u16 (3xxxx, 4xxxx)
+ *  IL_CTL_OP_SUBSCRIBE  u32 unit, u16 addr, u16 count
+ *  IL_CTL_OP_UNSUBSCRIBE u32 unit
+ *
+ *  STEP executes single lines, carrying on from where the last STEP
+ *  stopped. RUN first completes a scan left part way by STEP, then runs
+ *  the given number of full scans. A subscription whose registers
+ *  changed sends one notification frame listing the changed registers:
+ *  after each request frame of its own client, and for changes made by
+ *  host scans or by other clients, on every il_ctl_poll().
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+
+#ifndef IL_CTL_H_
+#define IL_CTL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "il_unit.h"
+
+/* Frame kinds */
+#define IL_CTL_FRAME_RESPONSE 0
+#define IL_CTL_FRAME_NOTIFY   1
+
+/* Operations */
+#define IL_CTL_OP_LOAD        1
+#define IL_CTL_OP_READ        2
+#define IL_CTL_OP_WRITE       3
+#define IL_CTL_OP_STEP        4
+#define IL_CTL_OP_RUN         5
+#define IL_CTL_OP_SNAPSHOT    6
+#define IL_CTL_OP_SUBSCRIBE   7
+#define IL_CTL_OP_UNSUBSCRIBE 8
+
+/* Result status */
+#define IL_CTL_OK             0
+#define IL_CTL_ERR_OP         1   // unknown or truncated operation
+#define IL_CTL_ERR_UNIT       2   // unit number out of range
+#define IL_CTL_ERR_RANGE      3   // address range outside the image
+#define IL_CTL_ERR_MEMORY     4   // out of memory
+#define IL_CTL_ERR_LIMIT      5   // too many subscriptions
+
+/* Largest request frame accepted */
+#define IL_CTL_MAX_FRAME (16UL * 1024 * 1024)
+
+typedef struct il_ctl il_ctl;
+
+/* Create the control socket.
+ *
+ * @param path  - filesystem path of the socket (replaced if it exists)
+ * @param units - the units that may be controlled, addressed by index
+ * @param count - number of units
+ * @return - the server, or NULL on failure
+ */
+il_ctl * il_ctl_create(const char *path, il_unit **units, uint32_t count);
+
+/* Push notifications of changes to every client, then accept
+ * connections and serve requests until timeout_ms passes with nothing
+ * to do. Call this from the host's main loop, after its scans.
+ * Never blocks on a client: output a client has not read yet is
+ * queued, and a client that lets twice IL_CTL_MAX_FRAME of output
+ * pile up is disconnected.
+ *
+ * @param ctl        - the server
+ * @param timeout_ms - how long to wait for activity (-1 = forever)
+ * @return - number of request frames served
+ */
+int il_ctl_poll(il_ctl *ctl, int timeout_ms);
+
+/* Close all connections and remove the socket.
+ *
+ * @param ctl - the server
+ */
+void il_ctl_destroy(il_ctl *ctl);
+
+#endif /* IL_CTL_H_ */
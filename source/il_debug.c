@@ -0,0 +1,273 @@
+/*
+ * il_debug.c
+ *
+ * Debugger for IL programs - breakpoints by trap patching and
+ * write watchpoints through the context watch bitmap.
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "il_debug.h"
+
+/* Watch map selecting every address, used while a history is attached */
+static uint8_t watch_all[IL_DBG_WATCH_MAP_SIZE];
+
+/* Write observer installed in the context while addresses are watched */
+static void watch_observer(void *user, uint16_t addr, uint16_t old, uint16_t val){
+	il_debugger * dbg = user;
+	uint8_t bit = (uint8_t)(1 << (addr & 7));
+	if(dbg->history) il_history_write_log(dbg->history, addr, old);
+	if(dbg->tool && (dbg->tool_map[addr >> 3] & bit)) dbg->tool(dbg->tool_user, addr, old, val);
+	if(dbg->watch_map[addr >> 3] & bit){
+		dbg->watch_hit = true;
+		dbg->watch_addr = addr;
+		dbg->watch_old = old;
+		dbg->watch_new = val;
+	}
+}
+
+/* Give the context a watch map only while something needs observing */
+static void update_watch(il_debugger *dbg){
+	if(dbg->history || (dbg->tool && dbg->watches)){
+		if(!watch_all[0]) memset(watch_all, 0xFF, sizeof(watch_all));
+		il_interp_ctx_watch(dbg->ctx, watch_all, watch_observer, dbg);
+	} else if(dbg->tool){
+		il_interp_ctx_watch(dbg->ctx, dbg->tool_map, watch_observer, dbg);
+	} else if(dbg->watches){
+		il_interp_ctx_watch(dbg->ctx, dbg->watch_map, watch_observer, dbg);
+	} else {
+		il_interp_ctx_watch(dbg->ctx, NULL, NULL, NULL);
+	}
+}
+
+/* Check a breakpoint condition against the accumulator */
+static bool break_taken(const il_breakpoint *bp, uint16_t accum){
+	switch(bp->cond){
+	case IL_DBG_EQ: return accum == bp->value;
+	case IL_DBG_NE: return accum != bp->value;
+	case IL_DBG_GT: return accum >  bp->value;
+	case IL_DBG_GE: return accum >= bp->value;
+	case IL_DBG_LT: return accum <  bp->value;
+	case IL_DBG_LE: return accum <= bp->value;
+	}
+	return true;
+}
+
+/* Move to the next line after executing one
+ *
+ * @return - IL_DBG_WATCH, IL_DBG_END or IL_DBG_STEP
+ */
+static int advance(il_debugger *dbg, uint16_t next){
+	int ret = IL_DBG_STEP;
+	if(dbg->profile) il_profile_count(dbg->profile, dbg->line, next);
+	dbg->resume = false;
+	if(dbg->history) il_history_done(dbg->history, next >= dbg->lines);
+	if(next >= dbg->lines){
+		next = 0;
+		ret = IL_DBG_END;
+	}
+	dbg->line = next;
+	if(dbg->watch_hit){
+		dbg->watch_hit = false;
+		ret = IL_DBG_WATCH;
+	}
+	return ret;
+}
+
+/********************************************
+ * Interface functions
+ ********************************************/
+
+/* Attach a debugger to a context, with an empty program */
+bool il_debug_init(il_debugger *dbg, il_context *ctx, uint16_t lines){
+	memset(dbg, 0, sizeof(*dbg));
+	dbg->code = calloc(lines ? lines : 1, sizeof(il_line));
+	dbg->orig = calloc(lines ? lines : 1, sizeof(il_line));
+	dbg->bp = calloc(lines ? lines : 1, sizeof(il_breakpoint));
+	if(!dbg->code || !dbg->orig || !dbg->bp){
+		il_debug_free(dbg);
+		return false;
+	}
+	dbg->ctx = ctx;
+	dbg->lines = lines;
+	return true;
+}
+
+/* Detach from the context and release the program copies */
+void il_debug_free(il_debugger *dbg){
+	if(dbg->ctx && (dbg->watches || dbg->history || dbg->tool)) il_interp_ctx_watch(dbg->ctx, NULL, NULL, NULL);
+	free(dbg->code);
+	free(dbg->orig);
+	free(dbg->bp);
+	dbg->code = dbg->orig = NULL;
+	dbg->bp = NULL;
+	dbg->ctx = NULL;
+}
+
+/* Set one line of the program, keeping any breakpoint */
+void il_debug_set_line(il_debugger *dbg, uint16_t line, uint16_t cmd, uint16_t value){
+	if(line >= dbg->lines) return;
+	dbg->orig[line].cmd = cmd;
+	dbg->orig[line].value = value;
+	dbg->code[line].value = value;
+	if(!dbg->bp[line].set) dbg->code[line].cmd = cmd;
+}
+
+/* Set a breakpoint on a line by patching in the trap instruction */
+void il_debug_set_break(il_debugger *dbg, uint16_t line, uint8_t cond, uint16_t value){
+	if(line >= dbg->lines) return;
+	dbg->bp[line].set = true;
+	dbg->bp[line].cond = cond;
+	dbg->bp[line].value = value;
+	dbg->code[line].cmd = IL_INTERP_CMD_TRAP;
+}
+
+/* Remove a breakpoint - restore the original instruction */
+void il_debug_clear_break(il_debugger *dbg, uint16_t line){
+	if(line >= dbg->lines) return;
+	dbg->bp[line].set = false;
+	dbg->code[line].cmd = dbg->orig[line].cmd;
+}
+
+/* Watch, or stop watching, writes to an address */
+void il_debug_set_watch(il_debugger *dbg, uint16_t addr, bool watch){
+	uint8_t bit = (uint8_t)(1 << (addr & 7));
+	bool was = (dbg->watch_map[addr >> 3] & bit) != 0;
+
+	if(watch == was) return;
+	if(watch){
+		dbg->watch_map[addr >> 3] |= bit;
+		dbg->watches++;
+	} else {
+		dbg->watch_map[addr >> 3] &= (uint8_t)~bit;
+		dbg->watches--;
+	}
+	update_watch(dbg);
+}
+
+/* Attach a history for reverse stepping */
+void il_debug_set_history(il_debugger *dbg, il_history *hist){
+	dbg->history = hist;
+	if(hist) il_history_clear(hist);
+	update_watch(dbg);
+}
+
+/* Pass writes to some addresses on to another observer as well */
+void il_debug_set_observer(il_debugger *dbg, const uint8_t *map, il_write_observer observer, void *user){
+	dbg->tool_map = map;
+	dbg->tool = map ? observer : NULL;
+	dbg->tool_user = user;
+	update_watch(dbg);
+}
+
+/* Count executed lines in a profile */
+void il_debug_set_profile(il_debugger *dbg, il_profile *prof){
+	dbg->profile = prof;
+}
+
+/* Restart at line 0 */
+void il_debug_restart(il_debugger *dbg){
+	dbg->line = 0;
+	dbg->resume = false;
+	if(dbg->history) il_history_clear(dbg->history);
+}
+
+/* Execute one line, ignoring any breakpoint on it */
+int il_debug_step(il_debugger *dbg){
+	il_line * l;
+	if(dbg->line >= dbg->lines){
+		dbg->line = 0;
+		return IL_DBG_END;
+	}
+	if(dbg->history) il_history_line(dbg->history, dbg->ctx, dbg->line);
+	l = &dbg->orig[dbg->line];
+	return advance(dbg, il_interp_ctx_execute(dbg->ctx, l->cmd, l->value, dbg->line));
+}
+
+/* Execute until a breakpoint, a watched write or the end of the program */
+int il_debug_run(il_debugger *dbg, uint32_t limit){
+	int ret;
+	while(limit--){
+		uint16_t line = dbg->line, next;
+		if(line >= dbg->lines){
+			dbg->line = 0;
+			return IL_DBG_END;
+		}
+		if(dbg->history) il_history_line(dbg->history, dbg->ctx, line);
+
+		next = il_interp_ctx_execute(dbg->ctx, dbg->code[line].cmd, dbg->code[line].value, line);
+		if(next == IL_INTERP_LINE_TRAP && dbg->code[line].cmd == IL_INTERP_CMD_TRAP){
+			// Breakpoint site. The trap changed nothing, so stop here or
+			// carry on with the original instruction.
+			il_breakpoint * bp = &dbg->bp[line];
+			if(!dbg->resume && break_taken(bp, dbg->ctx->accum)){
+				bp->hits++;
+				dbg->resume = true;
+				return IL_DBG_BREAK;
+			}
+			next = il_interp_ctx_execute(dbg->ctx, dbg->orig[line].cmd, dbg->orig[line].value, line);
+		}
+		if((ret = advance(dbg, next)) != IL_DBG_STEP) return ret;
+	}
+	return IL_DBG_STEP;
+}
+
+/* Step backwards by a number of executed lines */
+bool il_debug_back(il_debugger *dbg, uint32_t lines){
+	il_history * hist = dbg->history;
+	il_profile * prof;
+	il_write_observer tool;
+	int64_t replay;
+	uint16_t line;
+
+	if(!hist || lines > hist->step) return false;
+	replay = il_history_rewind(hist, dbg->ctx, hist->step - lines, &line);
+	if(replay < 0) return false;
+
+	// Replay forward from the snapshot to the target, without
+	// counting the lines or passing the writes to the tool again
+	prof = dbg->profile;
+	tool = dbg->tool;
+	dbg->profile = NULL;
+	dbg->tool = NULL;
+	dbg->line = line;
+	while(replay--) il_debug_step(dbg);
+	dbg->profile = prof;
+	dbg->tool = tool;
+	dbg->watch_hit = false;
+	dbg->resume = true;   // don't stop again at a breakpoint here
+	return true;
+}
+
+/* Step back to the start of the current (or previous) scan */
+bool il_debug_back_scan(il_debugger *dbg){
+	int64_t start;
+	if(!dbg->history) return false;
+	start = il_history_scan_start(dbg->history);
+	if(start < 0) return false;
+	return il_debug_back(dbg, (uint32_t)(dbg->history->step - start));
+}
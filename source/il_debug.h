@@ -0,0 +1,192 @@
+/*
+ * il_debug.h
+ *
+ * Debugger for IL programs. Works on its own pre-parsed copy of the
+ * program and places breakpoints by patching the trap instruction
+ * over a line, so lines without a breakpoint run at full speed.
+ * Write watchpoints use the interpreter context's watch bitmap, so
+ * only writes to watched addresses pay anything. With a history
+ * attached (il_history.h) execution can also be stepped backwards.
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+
+#ifndef IL_DEBUG_H_
+#define IL_DEBUG_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "il_interpreter.h"
+#include "il_unit.h"
+#include "il_history.h"
+#include "il_profile.h"
+
+/* Why il_debug_run() / il_debug_step() returned */
+#define IL_DBG_STEP   0   // line limit reached
+#define IL_DBG_BREAK  1   // stopped at a breakpoint, before executing it
+#define IL_DBG_WATCH  2   // a watched address was written
+#define IL_DBG_END    3   // execution ran off the end of the program
+
+/* Breakpoint conditions on the accumulator */
+#define IL_DBG_ALWAYS 0
+#define IL_DBG_EQ     1
+#define IL_DBG_NE     2
+#define IL_DBG_GT     3
+#define IL_DBG_GE     4
+#define IL_DBG_LT     5
+#define IL_DBG_LE     6
+
+#define IL_DBG_WATCH_MAP_SIZE 8192   // one bit per 16-bit address
+
+typedef struct{
+	bool set;
+	uint8_t cond;      // IL_DBG_xxx condition
+	uint16_t value;    // compared with the accumulator
+	uint32_t hits;     // times the breakpoint stopped execution
+} il_breakpoint;
+
+typedef struct{
+	il_context *ctx;
+	il_line *code;          // program as executed, with traps patched in
+	il_line *orig;          // program as written
+	il_breakpoint *bp;      // one per line
+	uint16_t lines;
+	uint16_t line;          // next line to execute
+	bool resume;            // next line is a breakpoint already reported
+
+	uint8_t watch_map[IL_DBG_WATCH_MAP_SIZE];
+	uint32_t watches;       // number of watched addresses
+	bool watch_hit;
+	uint16_t watch_addr;    // last watched write: address,
+	uint16_t watch_old;     //   value before
+	uint16_t watch_new;     //   and after
+
+	il_history *history;    // for reverse stepping, or NULL
+	il_profile *profile;    // per-line execution counts, or NULL
+
+	/* Extra write observer for display tools (e.g. il_trend) */
+	const uint8_t *tool_map;
+	il_write_observer tool;
+	void *tool_user;
+} il_debugger;
+
+/* Attach a debugger to a context, with an empty program of a given size
+ *
+ * @param dbg   - the debugger
+ * @param ctx   - the context the program runs in
+ * @param lines - number of program lines
+ * @return - true if initialised. false if out of memory.
+ */
+bool il_debug_init(il_debugger *dbg, il_context *ctx, uint16_t lines);
+
+/* Detach from the context and release the program copies */
+void il_debug_free(il_debugger *dbg);
+
+/* Set one line of the program. A breakpoint on the line is kept.
+ *
+ * @param dbg   - the debugger
+ * @param line  - the line number
+ * @param cmd   - command code from il_interp_parse()
+ * @param value - the associated value
+ */
+void il_debug_set_line(il_debugger *dbg, uint16_t line, uint16_t cmd, uint16_t value);
+
+/* Set a breakpoint on a line
+ *
+ * @param dbg   - the debugger
+ * @param line  - the line number
+ * @param cond  - IL_DBG_ALWAYS, or a comparison of the accumulator with value
+ * @param value - the value to compare with
+ */
+void il_debug_set_break(il_debugger *dbg, uint16_t line, uint8_t cond, uint16_t value);
+
+/* Remove a breakpoint from a line */
+void il_debug_clear_break(il_debugger *dbg, uint16_t line);
+
+/* Watch, or stop watching, writes to an address */
+void il_debug_set_watch(il_debugger *dbg, uint16_t addr, bool watch);
+
+/* Attach a history for reverse stepping. The history is cleared.
+ * While a history is attached every memory write is observed.
+ *
+ * @param dbg  - the debugger
+ * @param hist - an initialised history, or NULL to detach
+ */
+void il_debug_set_history(il_debugger *dbg, il_history *hist);
+
+/* Pass writes to some addresses on to another observer as well,
+ * e.g. il_trend_observer(). The context has a single observer, which
+ * the debugger owns while it is attached. Writes replayed when
+ * stepping backwards are not passed on again.
+ *
+ * @param dbg      - the debugger
+ * @param map      - bitmap of addresses for the observer
+ * @param observer - the observer, or NULL to remove
+ * @param user     - passed to observer
+ */
+void il_debug_set_observer(il_debugger *dbg, const uint8_t *map, il_write_observer observer, void *user);
+
+/* Count executed lines in a profile (NULL to stop). Lines replayed
+ * when stepping backwards are not counted again.
+ */
+void il_debug_set_profile(il_debugger *dbg, il_profile *prof);
+
+/* Restart at line 0. The machine state is not changed, and the
+ * history (if any) is cleared. */
+void il_debug_restart(il_debugger *dbg);
+
+/* Execute one line, ignoring any breakpoint on it
+ *
+ * @return - IL_DBG_STEP, IL_DBG_WATCH or IL_DBG_END
+ */
+int il_debug_step(il_debugger *dbg);
+
+/* Execute until a breakpoint, a watched write or the end of the program
+ *
+ * @param dbg   - the debugger
+ * @param limit - maximum number of lines to execute
+ * @return - the reason for stopping (IL_DBG_xxx)
+ */
+int il_debug_run(il_debugger *dbg, uint32_t limit);
+
+/* Step backwards. Memory writes made by the program are undone;
+ * other changes to memory are not.
+ *
+ * @param dbg   - the debugger
+ * @param lines - number of executed lines to go back
+ * @return - true if done. false if that is further back than the history.
+ */
+bool il_debug_back(il_debugger *dbg, uint32_t lines);
+
+/* Step back to the start of the current scan, or of the previous
+ * scan if the current one has just started
+ *
+ * @return - true if done. false if not in the history.
+ */
+bool il_debug_back_scan(il_debugger *dbg);
+
+#endif /* IL_DEBUG_H_ */
@@ -0,0 +1,825 @@
+/*
+ * il_fleet.c
+ *
+ * Multi-unit simulation host with NUMA aware sharding.
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+#include "il_fleet.h"
+#include "il_plant.h"
+
+#define FLEET_MAX_NODES 64
+#define FLEET_CHUNK     32   // units per work item
+
+/******************************************
+ * Fleet data structures
+ ******************************************/
+
+/* A peer mapping resolved to unit pointers */
+typedef struct{
+	il_unit * src;
+	il_unit * dst;
+	uint16_t src_addr;
+	uint16_t dst_addr;
+	uint32_t order;     // position in the caller's list
+	int src_node;
+	int dst_node;
+} fleet_map;
+
+/* One NUMA node and the units sharded to it */
+typedef struct{
+	int os_id;                       // node number reported by the OS
+#ifdef __linux__
+	cpu_set_t cpus;                  // CPUs of the node
+#endif
+	int ncpus;
+	int workers;                     // workers bound to this node
+	int steal_order[FLEET_MAX_NODES];// other nodes, nearest first
+	uint32_t first;                  // first unit of this node
+	uint32_t count;                  // number of units
+	uint32_t chunks;                 // number of work items
+	il_unit * units;                 // allocated by a worker of the node
+	uint64_t * rng;                  // random stream of each unit
+	atomic_uint next_chunk;          // work cursor for the scan phase
+	atomic_uint next_hash;           // work cursor for the trace phase
+} fleet_node;
+
+/* A worker thread */
+typedef struct{
+	struct il_fleet * fleet;
+	pthread_t thread;
+	int node;                        // index into fleet->node[]
+	bool leader;                     // allocates and copies for its node
+	uint64_t local_chunks;
+	uint64_t stolen_chunks;
+	uint64_t skipped;                // units not due in their tick
+	uint8_t * tel_buf;               // telemetry message, IL_TELEMETRY_MAX_MESSAGE
+} fleet_worker;
+
+struct il_fleet{
+	il_fleet_config cfg;
+	int nnodes;
+	fleet_node node[FLEET_MAX_NODES];
+	int nworkers;
+	fleet_worker * worker;
+	il_unit ** unit;                 // unit index -> unit
+
+	/* Peer I/O. Sorted by destination node, then source node, then
+	 * the caller's order. seg[d*nnodes+s] is the first entry of the
+	 * batch copied from node s to node d. scatter holds the same
+	 * ranges per destination node, as indexes into map in the
+	 * caller's order. */
+	fleet_map * map;
+	uint16_t * staging;
+	uint32_t nmaps;
+	uint32_t * seg;
+	uint32_t * scatter;
+
+	uint64_t * unit_hash;            // unit index -> state hash after the last tick
+	uint64_t trace;                  // hash chained over all ticks
+
+	il_plant * plant;                // process models, stepped after peer I/O
+	il_telemetry_tx * tx;            // unit index -> telemetry encoder, or NULL
+	il_radio * radio;                // carries the telemetry, or NULL
+
+	pthread_mutex_t gate_lock;       // holds workers until all are started
+	pthread_cond_t gate_cond;
+	bool gate_open;
+	pthread_barrier_t ctl_barrier;   // workers + controlling thread
+	pthread_barrier_t tick_barrier;  // workers only
+	uint32_t run_ticks;
+	bool quit;
+	bool failed;
+	uint64_t ticks;
+};
+
+/******************************************
+ * Topology discovery
+ ******************************************/
+#ifdef __linux__
+/* Parse a sysfs CPU list ("0-3,8-11") into a cpu set,
+ * keeping only CPUs the process may run on.
+ *
+ * @return - number of CPUs in the set
+ */
+static int parse_cpulist(const char *list, const cpu_set_t *allowed, cpu_set_t *set){
+	const char * p = list;
+	int n = 0;
+	CPU_ZERO(set);
+	while(*p){
+		char * end;
+		long lo = strtol(p, &end, 10), hi;
+		if(end == p) break;
+		hi = lo;
+		if(*end == '-') hi = strtol(end + 1, &end, 10);
+		for(; lo <= hi; lo++){
+			if(lo < CPU_SETSIZE && CPU_ISSET(lo, allowed)){
+				CPU_SET(lo, set);
+				n++;
+			}
+		}
+		p = end;
+		if(*p == ',') p++; else break;
+	}
+	return n;
+}
+
+/* Read a small sysfs file into buf. Returns false if missing */
+static bool read_sysfs(const char *path, char *buf, size_t len){
+	FILE * f = fopen(path, "r");
+	size_t n;
+	if(!f) return false;
+	n = fread(buf, 1, len - 1, f);
+	buf[n] = 0;
+	fclose(f);
+	return true;
+}
+#endif
+
+/* Find the NUMA nodes with CPUs the process may use and order
+ * each node's steal list by node distance. Falls back to a single
+ * node holding every CPU.
+ */
+static void discover_nodes(il_fleet *f){
+	int i, j;
+#ifdef __linux__
+	cpu_set_t allowed;
+	char path[96], buf[1024];
+	int dist[FLEET_MAX_NODES][FLEET_MAX_NODES];
+
+	sched_getaffinity(0, sizeof(allowed), &allowed);
+	f->nnodes = 0;
+	if(f->cfg.numa){
+		for(i = 0; i < FLEET_MAX_NODES; i++){
+			fleet_node * n = &f->node[f->nnodes];
+			char * p;
+			snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", i);
+			if(!read_sysfs(path, buf, sizeof(buf))) continue;
+			n->ncpus = parse_cpulist(buf, &allowed, &n->cpus);
+			if(n->ncpus == 0) continue;   // memory only, or not allowed
+			n->os_id = i;
+
+			/* distance row is indexed by OS node number */
+			snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/distance", i);
+			for(j = 0; j < FLEET_MAX_NODES; j++) dist[f->nnodes][j] = (j == i) ? 10 : 20;
+			if(read_sysfs(path, buf, sizeof(buf))){
+				p = buf;
+				for(j = 0; j < FLEET_MAX_NODES && *p; j++){
+					char * end;
+					long d = strtol(p, &end, 10);
+					if(end == p) break;
+					dist[f->nnodes][j] = (int)d;
+					p = end;
+				}
+			}
+			f->nnodes++;
+		}
+	}
+	if(f->nnodes == 0){
+		f->nnodes = 1;
+		f->node[0].os_id = 0;
+		f->node[0].cpus = allowed;
+		f->node[0].ncpus = CPU_COUNT(&allowed);
+		dist[0][0] = 10;
+	}
+
+	/* steal list - the other nodes sorted by distance */
+	for(i = 0; i < f->nnodes; i++){
+		int k = 0;
+		for(j = 0; j < f->nnodes; j++) if(j != i) f->node[i].steal_order[k++] = j;
+		for(j = 1; j < k; j++){  // insertion sort, k is tiny
+			int v = f->node[i].steal_order[j], m = j;
+			while(m > 0 && dist[i][f->node[f->node[i].steal_order[m-1]].os_id] >
+			               dist[i][f->node[v].os_id]){
+				f->node[i].steal_order[m] = f->node[i].steal_order[m-1];
+				m--;
+			}
+			f->node[i].steal_order[m] = v;
+		}
+	}
+#else
+	f->nnodes = 1;
+	f->node[0].os_id = 0;
+	f->node[0].ncpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	(void)i; (void)j;
+#endif
+}
+
+/******************************************
+ * Random streams and state hashes
+ ******************************************/
+
+/* 64-bit mix (the splitmix64 finaliser) */
+static uint64_t mix64(uint64_t x){
+	x ^= x >> 30;
+	x *= 0xBF58476D1CE4E5B9ULL;
+	x ^= x >> 27;
+	x *= 0x94D049BB133111EBULL;
+	return x ^ (x >> 31);
+}
+
+/* Next number of a random stream */
+uint64_t il_fleet_random(uint64_t *rng){
+	*rng += 0x9E3779B97F4A7C15ULL;
+	return mix64(*rng);
+}
+
+/* Hash a block of memory. Four independent lanes over 32 byte
+ * blocks, so the multiplies overlap, then 8 bytes at a time. */
+static uint64_t hash_bytes(uint64_t h, const void *data, size_t len){
+	const uint8_t * p = data;
+	uint64_t lane[4] = {h, h ^ 1, h ^ 2, h ^ 3};
+	uint64_t w;
+	int k;
+	for(; len >= 32; len -= 32, p += 32){
+		for(k = 0; k < 4; k++){
+			memcpy(&w, p + 8 * k, 8);
+			w = (lane[k] ^ w) * 0x9E3779B97F4A7C15ULL;
+			lane[k] = (w << 31) | (w >> 33);
+		}
+	}
+	h = mix64(lane[0] ^ mix64(lane[1] ^ mix64(lane[2] ^ mix64(lane[3]))));
+	for(; len >= 8; len -= 8, p += 8){
+		memcpy(&w, p, 8);
+		h = mix64(h ^ w);
+	}
+	if(len){
+		w = 0;
+		memcpy(&w, p, len);
+		h = mix64(h ^ w ^ ((uint64_t)len << 56));
+	}
+	return h;
+}
+
+/* Hash of the state a unit carries from one tick to the next */
+static uint64_t unit_hash(const il_unit *u){
+	uint32_t fbits;
+	uint64_t h = hash_bytes(0, u->ctx.image, sizeof(il_memory_image));
+	memcpy(&fbits, &u->ctx.faccum, sizeof(fbits));
+	h = mix64(h ^ u->ctx.accum ^ ((uint64_t)fbits << 16));
+	h = mix64(h ^ u->scans ^ ((uint64_t)u->overruns << 32));
+	return mix64(h ^ u->next_scan);
+}
+
+/* Is a peer copy lost in a tick. Depends only on the seed, the tick
+ * and the mapping, never on which worker asks. */
+static bool peer_lost(const il_fleet *f, const fleet_map *m, uint64_t tick){
+	if(!f->cfg.peer_loss) return false;
+	return (mix64(f->cfg.seed ^ mix64(tick ^ ((uint64_t)m->order << 32))) & 0xFFFF) < f->cfg.peer_loss;
+}
+
+/******************************************
+ * Worker threads
+ ******************************************/
+
+/* Scan all units of a work item that are due */
+static void scan_chunk(il_fleet *f, fleet_worker *w, fleet_node *n, uint32_t chunk, uint64_t tick){
+	uint64_t now = tick * (f->cfg.tick_ms ? f->cfg.tick_ms : 1);
+	uint32_t i = chunk * FLEET_CHUNK;
+	uint32_t end = i + FLEET_CHUNK;
+	if(end > n->count) end = n->count;
+	for(; i < end; i++){
+		bool scanned;
+		if(f->cfg.fault) f->cfg.fault(&n->units[i], n->first + i, tick, &n->rng[i], f->cfg.user);
+		scanned = il_unit_poll(&n->units[i], now);
+		if(!scanned) w->skipped++;
+		if(f->tx){
+			il_telemetry_tx * tx = &f->tx[n->first + i];
+			if(scanned) il_telemetry_encode(tx, n->units[i].ctx.image, w->tel_buf, IL_TELEMETRY_MAX_MESSAGE);
+			else tx->last_bytes = 0;
+		}
+	}
+}
+
+/* Scan phase - own node's work first, then steal from the
+ * other nodes in order of distance */
+static void scan_phase(il_fleet *f, fleet_worker *w, uint64_t tick){
+	fleet_node * home = &f->node[w->node];
+	unsigned c;
+	int k;
+
+	while((c = atomic_fetch_add(&home->next_chunk, 1)) < home->chunks){
+		scan_chunk(f, w, home, c, tick);
+		w->local_chunks++;
+	}
+	for(k = 0; k < f->nnodes - 1; k++){
+		fleet_node * n = &f->node[home->steal_order[k]];
+		while((c = atomic_fetch_add(&n->next_chunk, 1)) < n->chunks){
+			scan_chunk(f, w, n, c, tick);
+			w->stolen_chunks++;
+		}
+	}
+}
+
+/* Trace phase - hash every unit, with the same work sharing as
+ * the scan phase */
+static void hash_phase(il_fleet *f, fleet_worker *w){
+	fleet_node * home = &f->node[w->node];
+	unsigned c;
+	int k;
+
+	for(k = -1; k < f->nnodes - 1; k++){
+		fleet_node * n = (k < 0) ? home : &f->node[home->steal_order[k]];
+		while((c = atomic_fetch_add(&n->next_hash, 1)) < n->chunks){
+			uint32_t i = c * FLEET_CHUNK;
+			uint32_t end = (i + FLEET_CHUNK < n->count) ? i + FLEET_CHUNK : n->count;
+			for(; i < end; i++) f->unit_hash[n->first + i] = unit_hash(&n->units[i]);
+		}
+	}
+}
+
+/* Chain the unit hashes of a tick, in unit order, into the trace */
+static void trace_tick(il_fleet *f, uint64_t tick){
+	uint64_t h = mix64(f->trace ^ tick);
+	uint32_t u;
+	for(u = 0; u < f->cfg.units; u++) h = mix64(h ^ f->unit_hash[u]);
+	f->trace = h;
+	if(f->cfg.tick_hook) f->cfg.tick_hook(tick, h, f->cfg.user);
+}
+
+/* Read the sources on this node for every destination node.
+ * Each (destination, source) pair is one contiguous batch. */
+static void gather_phase(il_fleet *f, int node){
+	int d;
+	uint32_t i;
+	for(d = 0; d < f->nnodes; d++){
+		uint32_t start = f->seg[d * f->nnodes + node];
+		uint32_t end   = f->seg[d * f->nnodes + node + 1];
+		for(i = start; i < end; i++){
+			f->staging[i] = il_image_get(f->map[i].src->ctx.image, f->map[i].src_addr, false);
+		}
+	}
+}
+
+/* Write this node's destinations, in the caller's order, so a
+ * register mapped from units on several nodes gets the same last
+ * value whatever the node layout */
+static void scatter_phase(il_fleet *f, int node, uint64_t tick){
+	uint32_t i;
+	uint32_t start = f->seg[node * f->nnodes];
+	uint32_t end   = f->seg[(node + 1) * f->nnodes];
+	for(i = start; i < end; i++){
+		uint32_t k = f->scatter[i];
+		if(peer_lost(f, &f->map[k], tick)) continue;
+		il_unit_input(f->map[k].dst, f->map[k].dst_addr, f->staging[k]);
+	}
+}
+
+/* Offer the messages encoded in a tick to the radio channel */
+static void radio_tick(il_fleet *f, uint64_t tick){
+	uint32_t u;
+
+	il_radio_run(f->radio, tick * (f->cfg.tick_ms ? f->cfg.tick_ms : 1) * 1000);
+	for(u = 0; u < f->cfg.units; u++){
+		if(f->tx[u].last_bytes) il_radio_send(f->radio, u, f->tx[u].last_bytes);
+	}
+}
+
+/* One tick: scan every unit that is due, copy peer I/O, then
+ * step the process models, and hash the units for the trace */
+static void fleet_tick(il_fleet *f, fleet_worker *w, uint64_t tick){
+	// The last trace phase ended before the previous tick's final barrier
+	if(w->leader) atomic_store(&f->node[w->node].next_hash, 0);
+	scan_phase(f, w, tick);
+	pthread_barrier_wait(&f->tick_barrier);
+	// Messages are final until the next scan phase
+	if(f->radio && w == &f->worker[0]) radio_tick(f, tick);
+	if(f->nmaps){
+		if(w->leader) gather_phase(f, w->node);
+		pthread_barrier_wait(&f->tick_barrier);
+		if(w->leader) scatter_phase(f, w->node, tick);
+	}
+	if(f->plant){
+		// The models are one batch - a single worker steps them all
+		if(f->nmaps) pthread_barrier_wait(&f->tick_barrier);
+		if(w == &f->worker[0]) il_plant_step(f->plant, (f->cfg.tick_ms ? f->cfg.tick_ms : 1) / 1000.0f);
+	}
+	if(f->cfg.trace){
+		if(f->nmaps || f->plant) pthread_barrier_wait(&f->tick_barrier);
+		hash_phase(f, w);
+	}
+	if(w->leader) atomic_store(&f->node[w->node].next_chunk, 0);
+	pthread_barrier_wait(&f->tick_barrier);
+
+	// The unit hashes are not written again until two barriers into
+	// the next tick, so one worker can fold them while the rest scan
+	if(f->cfg.trace && w == &f->worker[0]) trace_tick(f, tick);
+}
+
+/* Allocate and initialise the units of a node. Runs on a
+ * worker bound to the node so the pages are first touched there. */
+static bool node_alloc(il_fleet *f, int node){
+	fleet_node * n = &f->node[node];
+	uint32_t i;
+
+	n->units = calloc(n->count ? n->count : 1, sizeof(il_unit));
+	n->rng = calloc(n->count ? n->count : 1, sizeof(uint64_t));
+	if(!n->units || !n->rng) return false;
+	for(i = 0; i < n->count; i++){
+		il_unit * u = &n->units[i];
+		n->rng[i] = f->cfg.seed ^ mix64(n->first + i + 1);
+		il_unit_init(u);
+		if(f->cfg.program && !il_unit_load(u, f->cfg.program, f->cfg.lines)) return false;
+		if(f->cfg.setup) f->cfg.setup(u, n->first + i, f->cfg.user);
+		f->unit[n->first + i] = u;
+	}
+	return true;
+}
+
+static void * worker_main(void *arg){
+	fleet_worker * w = arg;
+	il_fleet * f = w->fleet;
+	uint32_t t;
+
+	pthread_mutex_lock(&f->gate_lock);
+	while(!f->gate_open) pthread_cond_wait(&f->gate_cond, &f->gate_lock);
+	pthread_mutex_unlock(&f->gate_lock);
+	if(f->quit) return NULL;  // not all workers could be started
+
+#ifdef __linux__
+	pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &f->node[w->node].cpus);
+#endif
+	if(w->leader && !node_alloc(f, w->node)) f->failed = true;
+	pthread_barrier_wait(&f->ctl_barrier);   // startup complete
+
+	for(;;){
+		pthread_barrier_wait(&f->ctl_barrier);  // wait for a run request
+		if(f->quit) break;
+		for(t = 0; t < f->run_ticks; t++){
+			fleet_tick(f, w, f->ticks + t);
+		}
+		pthread_barrier_wait(&f->ctl_barrier);  // run complete
+	}
+	return NULL;
+}
+
+/******************************************
+ * Interface functions
+ ******************************************/
+
+/* Create a fleet and start its worker threads */
+il_fleet * il_fleet_create(const il_fleet_config *cfg){
+	il_fleet * f;
+	int i, used, started = 0;
+	uint32_t before;
+
+	f = calloc(1, sizeof(*f));
+	if(!f) return NULL;
+	f->cfg = *cfg;
+	discover_nodes(f);
+
+	f->nworkers = cfg->threads;
+	if(f->nworkers <= 0){
+		f->nworkers = 0;
+		for(i = 0; i < f->nnodes; i++) f->nworkers += f->node[i].ncpus;
+		if(f->nworkers <= 0) f->nworkers = 1;
+	}
+	/* Fewer workers than nodes - only use as many nodes as workers */
+	used = (f->nworkers < f->nnodes) ? f->nworkers : f->nnodes;
+	for(i = 0; i < used; i++){  // drop unused nodes from steal lists
+		int k, m = 0;
+		for(k = 0; k < f->nnodes - 1; k++){
+			if(f->node[i].steal_order[k] < used) f->node[i].steal_order[m++] = f->node[i].steal_order[k];
+		}
+	}
+	f->nnodes = used;
+
+	f->worker = calloc(f->nworkers, sizeof(fleet_worker));
+	f->unit = calloc(cfg->units ? cfg->units : 1, sizeof(il_unit *));
+	f->unit_hash = calloc(cfg->units ? cfg->units : 1, sizeof(uint64_t));
+	if(!f->worker || !f->unit || !f->unit_hash){
+		free(f->worker); free(f->unit); free(f->unit_hash); free(f);
+		return NULL;
+	}
+
+	/* Workers round robin over nodes, units in proportion to workers */
+	for(i = 0; i < f->nworkers; i++){
+		f->worker[i].fleet = f;
+		f->worker[i].node = i % used;
+		f->worker[i].leader = (i < used);
+		f->node[i % used].workers++;
+	}
+	before = 0;
+	for(i = 0; i < used; i++){
+		fleet_node * n = &f->node[i];
+		n->first = (uint32_t)((uint64_t)cfg->units * before / f->nworkers);
+		before += n->workers;
+		n->count = (uint32_t)((uint64_t)cfg->units * before / f->nworkers) - n->first;
+		n->chunks = (n->count + FLEET_CHUNK - 1) / FLEET_CHUNK;
+		atomic_init(&n->next_chunk, 0);
+		atomic_init(&n->next_hash, 0);
+	}
+
+	pthread_mutex_init(&f->gate_lock, NULL);
+	pthread_cond_init(&f->gate_cond, NULL);
+	pthread_barrier_init(&f->ctl_barrier, NULL, f->nworkers + 1);
+	pthread_barrier_init(&f->tick_barrier, NULL, f->nworkers);
+	for(i = 0; i < f->nworkers; i++){
+		if(pthread_create(&f->worker[i].thread, NULL, worker_main, &f->worker[i]) != 0) break;
+		started++;
+	}
+
+	/* Release the workers, or send them home if not all started */
+	pthread_mutex_lock(&f->gate_lock);
+	f->quit = (started < f->nworkers);
+	f->gate_open = true;
+	pthread_cond_broadcast(&f->gate_cond);
+	pthread_mutex_unlock(&f->gate_lock);
+	if(f->quit){
+		for(i = 0; i < started; i++) pthread_join(f->worker[i].thread, NULL);
+		f->nworkers = 0;
+		il_fleet_destroy(f);
+		return NULL;
+	}
+
+	pthread_barrier_wait(&f->ctl_barrier);   // wait for node allocation
+	if(f->failed){
+		il_fleet_destroy(f);
+		return NULL;
+	}
+	return f;
+}
+
+/* Stop the workers and release all memory of a fleet */
+void il_fleet_destroy(il_fleet *f){
+	int i;
+	uint32_t u;
+
+	if(!f) return;
+	if(f->nworkers){
+		f->quit = true;
+		pthread_barrier_wait(&f->ctl_barrier);
+		for(i = 0; i < f->nworkers; i++){
+			pthread_join(f->worker[i].thread, NULL);
+		}
+	}
+	for(i = 0; i < f->nnodes; i++){
+		if(!f->node[i].units) continue;
+		for(u = 0; u < f->node[i].count; u++) il_unit_free(&f->node[i].units[u]);
+		free(f->node[i].units);
+	}
+	for(i = 0; i < f->nnodes; i++) free(f->node[i].rng);
+	il_fleet_set_telemetry(f, false);
+	pthread_barrier_destroy(&f->ctl_barrier);
+	pthread_barrier_destroy(&f->tick_barrier);
+	pthread_cond_destroy(&f->gate_cond);
+	pthread_mutex_destroy(&f->gate_lock);
+	free(f->map);
+	free(f->staging);
+	free(f->seg);
+	free(f->scatter);
+	free(f->worker);
+	free(f->unit);
+	free(f->unit_hash);
+	free(f);
+}
+
+/* Node index owning a unit */
+static int unit_node(const il_fleet *f, uint32_t unit){
+	int i;
+	for(i = f->nnodes - 1; i > 0; i--){
+		if(unit >= f->node[i].first) break;
+	}
+	return i;
+}
+
+static int map_compare(const void *a, const void *b){
+	const fleet_map * x = a;
+	const fleet_map * y = b;
+	if(x->dst_node != y->dst_node) return x->dst_node - y->dst_node;
+	if(x->src_node != y->src_node) return x->src_node - y->src_node;
+	return (x->order > y->order) - (x->order < y->order);
+}
+
+/* Set the peer I/O mappings */
+bool il_fleet_set_maps(il_fleet *f, const il_peer_map *maps, uint32_t count){
+	fleet_map * m = NULL;
+	uint16_t * staging = NULL;
+	uint32_t * seg, * scatter = NULL, * pos = NULL;
+	uint32_t fill[FLEET_MAX_NODES] = {0};
+	uint32_t i, pairs = f->nnodes * f->nnodes;
+
+	for(i = 0; i < count; i++){
+		if(maps[i].src_unit >= f->cfg.units || maps[i].dst_unit >= f->cfg.units) return false;
+	}
+	seg = calloc(pairs + 1, sizeof(uint32_t));
+	if(count){
+		m = malloc(count * sizeof(fleet_map));
+		staging = calloc(count, sizeof(uint16_t));
+		scatter = malloc(count * sizeof(uint32_t));
+		pos = malloc(count * sizeof(uint32_t));
+	}
+	if(!seg || (count && (!m || !staging || !scatter || !pos))){
+		free(seg); free(m); free(staging); free(scatter); free(pos);
+		return false;
+	}
+	for(i = 0; i < count; i++){
+		m[i].src = f->unit[maps[i].src_unit];
+		m[i].dst = f->unit[maps[i].dst_unit];
+		m[i].src_addr = maps[i].src_addr;
+		m[i].dst_addr = maps[i].dst_addr;
+		m[i].order = i;
+		m[i].src_node = unit_node(f, maps[i].src_unit);
+		m[i].dst_node = unit_node(f, maps[i].dst_unit);
+		seg[m[i].dst_node * f->nnodes + m[i].src_node + 1]++;
+	}
+	if(count) qsort(m, count, sizeof(fleet_map), map_compare);
+	for(i = 1; i <= pairs; i++) seg[i] += seg[i-1];
+
+	// Each destination node's entries again, in the caller's order
+	for(i = 0; i < count; i++) pos[m[i].order] = i;
+	for(i = 0; i < count; i++){
+		int d = m[pos[i]].dst_node;
+		scatter[seg[d * f->nnodes] + fill[d]++] = pos[i];
+	}
+	free(pos);
+
+	free(f->map); free(f->staging); free(f->seg); free(f->scatter);
+	f->map = m;
+	f->staging = staging;
+	f->seg = seg;
+	f->scatter = scatter;
+	f->nmaps = count;
+	return true;
+}
+
+/* Set the process models */
+void il_fleet_set_plant(il_fleet *f, il_plant *plant){
+	f->plant = plant;
+}
+
+/* Start or stop telemetry encoding */
+bool il_fleet_set_telemetry(il_fleet *f, bool on){
+	il_telemetry_tx * tx = NULL;
+	int i;
+	uint32_t u;
+
+	if(on){
+		tx = malloc((f->cfg.units ? f->cfg.units : 1) * sizeof(il_telemetry_tx));
+		if(!tx) return false;
+		for(i = 0; i < f->nworkers; i++){
+			if(!f->worker[i].tel_buf && !(f->worker[i].tel_buf = malloc(IL_TELEMETRY_MAX_MESSAGE))){
+				free(tx);
+				return false;
+			}
+		}
+		for(u = 0; u < f->cfg.units; u++) il_telemetry_init(&tx[u], f->unit[u]->ctx.image);
+	} else {
+		for(i = 0; i < f->nworkers; i++){
+			free(f->worker[i].tel_buf);
+			f->worker[i].tel_buf = NULL;
+		}
+	}
+	free(f->tx);
+	f->tx = tx;
+	if(!tx) f->radio = NULL;   // nothing left to send
+	return true;
+}
+
+/* Send the telemetry over a radio channel */
+bool il_fleet_set_radio(il_fleet *f, il_radio *radio){
+	if(radio){
+		if(il_radio_nodes(radio) < f->cfg.units) return false;
+		if(!f->tx && !il_fleet_set_telemetry(f, true)) return false;
+	}
+	f->radio = radio;
+	return true;
+}
+
+/* Get the telemetry encoder of a unit */
+const il_telemetry_tx * il_fleet_telemetry(const il_fleet *f, uint32_t index){
+	if(index >= f->cfg.units || !f->tx) return NULL;
+	return &f->tx[index];
+}
+
+/* Run the fleet for a number of ticks */
+void il_fleet_run(il_fleet *f, uint32_t ticks){
+	if(!ticks) return;
+	f->run_ticks = ticks;
+	pthread_barrier_wait(&f->ctl_barrier);   // start
+	pthread_barrier_wait(&f->ctl_barrier);   // done
+	f->ticks += ticks;
+}
+
+/* Get a unit of the fleet */
+il_unit * il_fleet_unit(il_fleet *f, uint32_t index){
+	if(index >= f->cfg.units) return NULL;
+	return f->unit[index];
+}
+
+/* Get the fleet statistics */
+void il_fleet_get_stats(const il_fleet *f, il_fleet_stats *stats){
+	int i;
+	uint32_t u;
+
+	memset(stats, 0, sizeof(*stats));
+	stats->nodes = f->nnodes;
+	stats->threads = f->nworkers;
+	stats->ticks = f->ticks;
+	for(i = 0; i < f->nworkers; i++){
+		stats->local_chunks += f->worker[i].local_chunks;
+		stats->stolen_chunks += f->worker[i].stolen_chunks;
+		stats->skipped += f->worker[i].skipped;
+	}
+	for(u = 0; u < f->cfg.units; u++){
+		stats->scans += f->unit[u]->scans;
+		stats->overruns += f->unit[u]->overruns;
+		if(f->tx){
+			stats->telemetry_messages += f->tx[u].messages;
+			stats->telemetry_bytes += f->tx[u].bytes;
+		}
+	}
+}
+
+/* Get the trace hash */
+uint64_t il_fleet_trace(const il_fleet *f){
+	return f->trace;
+}
+
+/* Get the hash of one unit's state after the last tick */
+uint64_t il_fleet_unit_trace(const il_fleet *f, uint32_t index){
+	if(index >= f->cfg.units || !f->cfg.trace) return 0;
+	return f->unit_hash[index];
+}
+
+/* Run a fleet on one worker and on many and compare the traces */
+bool il_fleet_check(const il_fleet_config *cfg, const il_fleet_check_config *check,
+		il_fleet_check_result *res){
+	il_fleet_config c = *cfg;
+	il_fleet * f[2] = {NULL, NULL};
+	il_plant * p[2] = {NULL, NULL};
+	bool ok = true;
+	uint32_t t, u;
+	int k;
+
+	memset(res, 0, sizeof(*res));
+	res->match = true;
+	res->tick = check->ticks;
+	c.trace = true;
+	c.tick_hook = NULL;
+	for(k = 0; k < 2 && ok; k++){
+		c.threads = k ? check->threads : 1;
+		f[k] = il_fleet_create(&c);
+		ok = f[k] && il_fleet_set_maps(f[k], check->maps, check->nmaps);
+		if(ok && check->plant){
+			p[k] = check->plant(f[k], cfg->user);
+			ok = (p[k] != NULL);
+			il_fleet_set_plant(f[k], p[k]);
+		}
+	}
+
+	// One tick at a time, to report the first tick that differs
+	for(t = 0; ok && t < check->ticks; t++){
+		il_fleet_run(f[0], 1);
+		il_fleet_run(f[1], 1);
+		if(f[0]->trace != f[1]->trace){
+			res->match = false;
+			res->tick = t;
+			for(u = 0; u < cfg->units && f[0]->unit_hash[u] == f[1]->unit_hash[u]; u++);
+			res->unit = u;
+			break;
+		}
+	}
+	if(ok){
+		res->trace_one = f[0]->trace;
+		res->trace_many = f[1]->trace;
+	}
+	for(k = 0; k < 2; k++){
+		il_fleet_destroy(f[k]);
+		if(p[k]) il_plant_destroy(p[k]);
+	}
+	return ok;
+}
@@ -0,0 +1,268 @@
+/*
+ * il_fleet.h
+ *
+ * Multi-unit simulation host. Runs many il_unit instances across
+ * worker threads, one scan per unit per tick, and copies peer I/O
+ * mappings between units at the end of each tick.
+ *
+ * On NUMA machines units are sharded per node. Each node's units
+ * (contexts, memory images and program copies) are allocated and
+ * first touched by a worker bound to that node, workers steal work
+ * from their own node first, and peer I/O is copied in per node
+ * batches.
+ *
+ * Results are the same for any number of workers and any scheduling.
+ * Units only change themselves while they scan, peer I/O is applied in
+ * the caller's order, the process models are stepped by one worker,
+ * and fault injection draws from a random stream per unit (or, for
+ * lost peer copies, from a hash of the seed, tick and mapping). With
+ * trace set, a hash of every unit's state is kept after each tick and
+ * chained into a fleet trace hash that can be compared between runs.
+ * il_fleet_check() runs a fleet on one worker and on many and compares
+ * the traces tick by tick.
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+
+#ifndef IL_FLEET_H_
+#define IL_FLEET_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "il_unit.h"
+#include "il_plant.h"
+#include "il_telemetry.h"
+#include "il_radio.h"
+
+typedef struct il_fleet il_fleet;
+
+/* Peer I/O mapping - copy one register from a source unit to a
+ * destination unit at the end of every tick (like a radio I/O
+ * mapping between two RTUs). Changed values count as input changes
+ * for the destination's adaptive scan rate.
+ */
+typedef struct{
+	uint32_t src_unit;
+	uint16_t src_addr;
+	uint32_t dst_unit;
+	uint16_t dst_addr;
+} il_peer_map;
+
+/* Fleet creation parameters */
+typedef struct{
+	uint32_t units;          // number of units
+	int threads;             // worker threads. 0 = one per available CPU
+	bool numa;               // shard units over NUMA nodes
+	const il_line *program;  // program loaded into every unit (may be NULL)
+	uint16_t lines;          // number of lines in program
+	uint32_t tick_ms;        // simulated time per tick, for units with an
+	                         // adaptive scan rate (0 = 1 ms)
+
+	/* Optional per-unit setup, called on a worker bound to the
+	 * unit's node after the unit is initialised, so anything it
+	 * allocates or writes is local to that node. */
+	void (*setup)(il_unit *unit, uint32_t index, void *user);
+	void *user;
+
+	uint64_t seed;           // seeds the per-unit random streams and peer_loss
+	uint16_t peer_loss;      // chance in 65536 that a peer I/O copy is lost in a tick
+	/* Optional fault injection, called for every unit in every tick
+	 * before it is polled, with the unit's own random stream (see
+	 * il_fleet_random()). It may only change that unit. */
+	void (*fault)(il_unit *unit, uint32_t index, uint64_t tick, uint64_t *rng, void *user);
+	bool trace;              // hash every unit's state after each tick
+	/* Optional, with trace. Called once per tick with the fleet trace
+	 * hash after it. Runs on a worker while the next tick may already
+	 * be scanning, so it must not touch the units. */
+	void (*tick_hook)(uint64_t tick, uint64_t hash, void *user);
+} il_fleet_config;
+
+/* Check of a fleet run on many workers against one worker */
+typedef struct{
+	uint32_t ticks;          // ticks to run
+	int threads;             // workers of the run checked (0 = one per CPU)
+	const il_peer_map *maps; // peer I/O mappings for both runs
+	uint32_t nmaps;
+	/* Optional - build the process models of one of the two fleets.
+	 * Called with the config's user pointer. They are destroyed with
+	 * il_plant_destroy() at the end. */
+	il_plant * (*plant)(il_fleet *fleet, void *user);
+} il_fleet_check_config;
+
+/* Result of il_fleet_check() */
+typedef struct{
+	bool match;              // every tick gave the same trace
+	uint64_t tick;           // first tick that differed (ticks if none)
+	uint32_t unit;           // first unit that differed in that tick
+	uint64_t trace_one;      // trace hash of the single worker run
+	uint64_t trace_many;     // trace hash of the many worker run
+} il_fleet_check_result;
+
+/* Fleet statistics */
+typedef struct{
+	uint32_t nodes;          // NUMA nodes in use
+	uint32_t threads;        // worker threads
+	uint64_t ticks;          // completed ticks
+	uint64_t scans;          // unit scans executed
+	uint64_t skipped;        // unit ticks without a scan (adaptive rate, not due)
+	uint64_t overruns;       // scans stopped by the step limit
+	uint64_t local_chunks;   // work items scanned on their home node
+	uint64_t stolen_chunks;  // work items stolen from another node
+	uint64_t telemetry_messages; // telemetry messages encoded (il_fleet_set_telemetry)
+	uint64_t telemetry_bytes;    // their total size
+} il_fleet_stats;
+
+
+/* Create a fleet and start its worker threads.
+ *
+ * @param cfg - the fleet parameters
+ * @return - the fleet, or NULL on failure
+ */
+il_fleet * il_fleet_create(const il_fleet_config *cfg);
+
+/* Stop the workers and release all memory of a fleet.
+ *
+ * @param fleet - the fleet
+ */
+void il_fleet_destroy(il_fleet *fleet);
+
+/* Set the peer I/O mappings (replaces any previous set). Mappings
+ * are applied after every tick, in the order given: all sources are
+ * read first, then destinations are written in order. Must not be
+ * called while il_fleet_run() is executing.
+ *
+ * @param fleet - the fleet
+ * @param maps  - array of mappings
+ * @param count - number of mappings
+ * @return - true if set. false if a unit index is invalid or out of memory.
+ */
+bool il_fleet_set_maps(il_fleet *fleet, const il_peer_map *maps, uint32_t count);
+
+/* Set the process models stepped after every tick, once the peer
+ * I/O has been copied. The models are stepped by tick_ms of time.
+ * Must not be called while il_fleet_run() is executing.
+ *
+ * @param fleet - the fleet
+ * @param plant - the models (the caller keeps ownership), or NULL for none
+ */
+void il_fleet_set_plant(il_fleet *fleet, il_plant *plant);
+
+/* Encode every unit's changes as a telemetry message (il_telemetry.h)
+ * after each of its scans, measuring the report traffic of the fleet.
+ * Each unit gets its own encoder, starting from its image at the time
+ * of the call. Units not scanned in a tick send nothing. Must not be
+ * called while il_fleet_run() is executing.
+ *
+ * @param fleet - the fleet
+ * @param on    - true to start (or restart) encoding, false to stop
+ *                (which also detaches any radio channel)
+ * @return - true if set. false if out of memory.
+ */
+bool il_fleet_set_telemetry(il_fleet *fleet, bool on);
+
+/* Get the telemetry encoder of a unit, for its message count, total
+ * bytes and the size of its message in the last tick.
+ *
+ * @param fleet - the fleet
+ * @param index - unit number 0 .. units-1
+ * @return - the encoder, or NULL if index is invalid or telemetry is off
+ */
+const il_telemetry_tx * il_fleet_telemetry(const il_fleet *fleet, uint32_t index);
+
+/* Send every unit's telemetry over a radio channel (il_radio.h).
+ * Unit N is radio node N. In every tick the channel is run to the
+ * tick's time (tick * tick_ms, in us), then each unit that encoded a
+ * message offers it, in unit order. Turns telemetry on if it is off.
+ * Must not be called while il_fleet_run() is executing.
+ *
+ * @param fleet - the fleet
+ * @param radio - the channel (the caller keeps ownership), or NULL for none
+ * @return - true if set. false if the channel has fewer nodes than
+ *           the fleet has units, or out of memory.
+ */
+bool il_fleet_set_radio(il_fleet *fleet, il_radio *radio);
+
+/* Run the fleet for a number of ticks. Returns when done.
+ *
+ * @param fleet - the fleet
+ * @param ticks - number of ticks to run
+ */
+void il_fleet_run(il_fleet *fleet, uint32_t ticks);
+
+/* Get a unit of the fleet (for loading, inspection and input writes
+ * between runs).
+ *
+ * @param fleet - the fleet
+ * @param index - unit number 0 .. units-1
+ * @return - the unit, or NULL if index is invalid
+ */
+il_unit * il_fleet_unit(il_fleet *fleet, uint32_t index);
+
+/* Get the fleet statistics
+ *
+ * @param fleet - the fleet
+ * @param stats - structure to fill
+ */
+void il_fleet_get_stats(const il_fleet *fleet, il_fleet_stats *stats);
+
+/* Get the trace hash, chained over every tick run so far (0 without
+ * trace). Equal hashes mean equal unit states after every tick.
+ *
+ * @param fleet - the fleet
+ * @return - the trace hash
+ */
+uint64_t il_fleet_trace(const il_fleet *fleet);
+
+/* Get the hash of one unit's state after the last tick (with trace)
+ *
+ * @param fleet - the fleet
+ * @param index - unit number 0 .. units-1
+ * @return - the hash, 0 if index is invalid or there is no trace
+ */
+uint64_t il_fleet_unit_trace(const il_fleet *fleet, uint32_t index);
+
+/* Next number of a random stream (splitmix64)
+ *
+ * @param rng - the stream state, as passed to the fault function
+ * @return - 64 random bits
+ */
+uint64_t il_fleet_random(uint64_t *rng);
+
+/* Run a fleet on one worker and on many for the same number of ticks,
+ * with trace on, and compare the traces after every tick. The config's
+ * threads and tick_hook are not used.
+ *
+ * @param cfg   - the fleet parameters
+ * @param check - the check parameters
+ * @param res   - the result
+ * @return - true if both runs completed. false if a fleet could not
+ *           be set up.
+ */
+bool il_fleet_check(const il_fleet_config *cfg, const il_fleet_check_config *check,
+		il_fleet_check_result *res);
+
+#endif /* IL_FLEET_H_ */
@@ -0,0 +1,179 @@
+/*
+ * il_history.c
+ *
+ * Execution history for reverse stepping - snapshot ring plus
+ * a log of the memory writes between snapshots.
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "il_history.h"
+
+/* Drop the oldest snapshot and the writes logged before the next one */
+static void drop_oldest(il_history *hist){
+	hist->snap_tail++;
+	if(hist->snap_tail < hist->snap_head){
+		hist->write_tail = hist->snaps[hist->snap_tail % hist->snap_size].first_write;
+	} else {
+		hist->write_tail = hist->write_head;
+	}
+}
+
+/********************************************
+ * Interface functions
+ ********************************************/
+
+/* Allocate a history */
+bool il_history_init(il_history *hist, uint32_t snapshots, uint32_t writes, uint32_t interval){
+	memset(hist, 0, sizeof(*hist));
+	if(!snapshots || !writes) return false;
+	hist->snaps = malloc(snapshots * sizeof(il_history_snap));
+	hist->writes = malloc(writes * sizeof(il_history_write));
+	hist->scans = malloc(snapshots * sizeof(uint64_t));
+	if(!hist->snaps || !hist->writes || !hist->scans){
+		il_history_free(hist);
+		return false;
+	}
+	hist->snap_size = snapshots;
+	hist->write_size = writes;
+	hist->interval = interval ? interval : 1;
+	il_history_clear(hist);
+	return true;
+}
+
+/* Release a history */
+void il_history_free(il_history *hist){
+	free(hist->snaps);
+	free(hist->writes);
+	free(hist->scans);
+	hist->snaps = NULL;
+	hist->writes = NULL;
+	hist->scans = NULL;
+}
+
+/* Forget everything recorded */
+void il_history_clear(il_history *hist){
+	hist->step = 0;
+	hist->snap_head = hist->snap_tail = 0;
+	hist->write_head = hist->write_tail = 0;
+	hist->scans[0] = 0;   // history starts at the start of a scan
+	hist->scan_head = 1;
+}
+
+/* A line is about to be executed - take a snapshot if one is due */
+void il_history_line(il_history *hist, const il_context *ctx, uint16_t line){
+	il_history_snap * s;
+
+	if(hist->snap_head > hist->snap_tail &&
+	   hist->step - hist->snaps[(hist->snap_head - 1) % hist->snap_size].step < hist->interval){
+		return;
+	}
+	if(hist->snap_head - hist->snap_tail == hist->snap_size) drop_oldest(hist);
+
+	s = &hist->snaps[hist->snap_head % hist->snap_size];
+	s->step = hist->step;
+	s->first_write = hist->write_head;
+	s->line = line;
+	s->accum = ctx->accum;
+	s->faccum = ctx->faccum;
+	s->eval_stack_top = ctx->eval_stack_top;
+	s->call_stack_top = ctx->call_stack_top;
+	memcpy(s->eval_stack, ctx->eval_stack, sizeof(s->eval_stack));
+	memcpy(s->call_stack, ctx->call_stack, sizeof(s->call_stack));
+	hist->snap_head++;
+}
+
+/* Log a memory write with the value it replaced */
+void il_history_write_log(il_history *hist, uint16_t addr, uint16_t old){
+	il_history_write * w;
+
+	while(hist->write_head - hist->write_tail == hist->write_size &&
+	      hist->snap_head > hist->snap_tail){
+		drop_oldest(hist);
+	}
+	if(hist->snap_head == hist->snap_tail) return;  // nothing to go back to
+
+	w = &hist->writes[hist->write_head % hist->write_size];
+	w->addr = addr;
+	w->old = old;
+	hist->write_head++;
+}
+
+/* A line was executed */
+void il_history_done(il_history *hist, bool scan_end){
+	hist->step++;
+	if(scan_end){
+		hist->scans[hist->scan_head % hist->snap_size] = hist->step;
+		hist->scan_head++;
+	}
+}
+
+/* Go back to the newest snapshot at or before a step */
+int64_t il_history_rewind(il_history *hist, il_context *ctx, uint64_t target, uint16_t *line){
+	uint64_t i, first = hist->scan_head > hist->snap_size ? hist->scan_head - hist->snap_size : 0;
+	il_history_snap * s = NULL;
+
+	if(target > hist->step) return -1;
+	for(i = hist->snap_head; i > hist->snap_tail; i--){
+		if(hist->snaps[(i - 1) % hist->snap_size].step <= target){
+			s = &hist->snaps[(i - 1) % hist->snap_size];
+			break;
+		}
+	}
+	if(!s) return -1;
+
+	// Undo the writes since the snapshot, newest first
+	while(hist->write_head > s->first_write){
+		il_history_write * w = &hist->writes[--hist->write_head % hist->write_size];
+		il_interp_ctx_poke(ctx, w->addr, w->old);
+	}
+	ctx->accum = s->accum;
+	ctx->faccum = s->faccum;
+	ctx->eval_stack_top = s->eval_stack_top;
+	ctx->call_stack_top = s->call_stack_top;
+	memcpy(ctx->eval_stack, s->eval_stack, sizeof(s->eval_stack));
+	memcpy(ctx->call_stack, s->call_stack, sizeof(s->call_stack));
+	*line = s->line;
+
+	hist->snap_head = i;
+	hist->step = s->step;
+	while(hist->scan_head > first + 1 &&
+	      hist->scans[(hist->scan_head - 1) % hist->snap_size] > s->step){
+		hist->scan_head--;
+	}
+	return (int64_t)(target - s->step);
+}
+
+/* Get the step at which the current (or previous) scan started */
+int64_t il_history_scan_start(const il_history *hist){
+	uint64_t i, first = hist->scan_head > hist->snap_size ? hist->scan_head - hist->snap_size : 0;
+	for(i = hist->scan_head; i > first; i--){
+		uint64_t start = hist->scans[(i - 1) % hist->snap_size];
+		if(start < hist->step) return (int64_t)start;
+	}
+	return -1;
+}
@@ -0,0 +1,144 @@
+/*
+ * il_history.h
+ *
+ * Execution history for reverse stepping in the debugger.
+ *
+ * Every interval lines the debugger snapshots the interpreter state
+ * (accumulator, stacks and current line - not memory), and every
+ * memory write between snapshots is logged with the value it
+ * replaced. Going back n lines undoes the logged writes down to the
+ * newest snapshot at or before the target, restores that snapshot and
+ * replays forward to the target. Both logs are rings of a fixed size;
+ * when either is full the oldest snapshot and its writes are dropped.
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+
+#ifndef IL_HISTORY_H_
+#define IL_HISTORY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "il_interpreter.h"
+
+/* Saved interpreter state at one point in the history */
+typedef struct{
+	uint64_t step;         // lines executed before the snapshot
+	uint64_t first_write;  // first write logged after the snapshot
+	uint16_t line;         // next line to execute
+	uint16_t accum;
+	float faccum;
+	int eval_stack_top;
+	int call_stack_top;
+	struct{
+		uint16_t command;
+		uint16_t accum;
+		float faccum;
+	} eval_stack[IL_EVAL_STACK_MAX_DEPTH];
+	uint16_t call_stack[IL_CALL_STACK_MAX_DEPTH];
+} il_history_snap;
+
+/* One logged memory write */
+typedef struct{
+	uint16_t addr;
+	uint16_t old;    // value before the write
+} il_history_write;
+
+typedef struct{
+	uint32_t interval;      // lines between snapshots
+	uint64_t step;          // lines executed since the history was cleared
+
+	il_history_snap *snaps; // snapshot ring
+	uint32_t snap_size;
+	uint64_t snap_head;     // snapshots taken (ring index = count % size)
+	uint64_t snap_tail;     // oldest snapshot kept
+
+	il_history_write *writes;  // write ring
+	uint32_t write_size;
+	uint64_t write_head;
+	uint64_t write_tail;
+
+	uint64_t *scans;        // step of each scan start, ring of snap_size
+	uint64_t scan_head;
+} il_history;
+
+/* Allocate a history
+ *
+ * @param hist      - the history
+ * @param snapshots - number of snapshots kept
+ * @param writes    - number of memory writes kept
+ * @param interval  - lines executed between snapshots
+ * @return - true if allocated. false if out of memory.
+ */
+bool il_history_init(il_history *hist, uint32_t snapshots, uint32_t writes, uint32_t interval);
+
+/* Release a history */
+void il_history_free(il_history *hist);
+
+/* Forget everything recorded, e.g. after the memory was edited */
+void il_history_clear(il_history *hist);
+
+/* Record that a line is about to be executed. Takes a snapshot when
+ * one is due.
+ *
+ * @param hist - the history
+ * @param ctx  - the interpreter context
+ * @param line - the line about to be executed
+ */
+void il_history_line(il_history *hist, const il_context *ctx, uint16_t line);
+
+/* Record a memory write (from a context write observer) */
+void il_history_write_log(il_history *hist, uint16_t addr, uint16_t old);
+
+/* Record that a line was executed
+ *
+ * @param hist     - the history
+ * @param scan_end - true if execution ran off the end of the program
+ */
+void il_history_done(il_history *hist, bool scan_end);
+
+/* Go back to the newest snapshot at or before a step. Logged writes
+ * after the snapshot are undone in ctx, and the snapshot's state is
+ * restored.
+ *
+ * @param hist   - the history
+ * @param ctx    - the interpreter context
+ * @param target - step to go back to
+ * @param line   - set to the snapshot's next line
+ * @return - lines to replay to reach target, or -1 if the target is
+ *           older than the history kept
+ */
+int64_t il_history_rewind(il_history *hist, il_context *ctx, uint64_t target, uint16_t *line);
+
+/* Get the step at which the current scan started (or the previous
+ * scan, if the current one has just started)
+ *
+ * @return - the step, or -1 if not in the history
+ */
+int64_t il_history_scan_start(const il_history *hist);
+
+#endif /* IL_HISTORY_H_ */
@@ -0,0 +1,83 @@
+/*
+ * il_image.c
+ *
+ * Flat memory image for the Instruction List Interpreter.
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+#include "il_image.h"
+#include "il_const.h"
+
+/* Decode a Modbus type address into bank and index.
+ * Same mapping as addr_decode() in the demo application.
+ */
+bool il_image_decode(uint16_t addr, int * bank, int * index){
+	int tbank = addr / 10000;
+	int tindex = (addr % 10000);
+	if(tindex == 0 || (tindex > IL_IMAGE_BANK_SIZE)) return false;
+	tindex -= 1;
+	switch(tbank){
+	case 0: case 1: break;
+	case 3: case 4: tbank--; break;
+	default: return false;
+	}
+	*bank = tbank;
+	*index = tindex;
+	return true;
+}
+
+/* Get a value from the image. 0 for invalid addresses */
+uint16_t il_image_get(const il_memory_image *img, uint16_t addr, bool invert){
+	uint16_t val = 0;
+	int bank, index;
+	if(il_image_decode(addr, &bank, &index)){
+		if(bank < 2){
+			val = img->bits[bank][index];
+			if(invert) val = !val;
+		} else {
+			val = img->words[bank-2][index];
+			if(invert) val = ~val;
+		}
+	} else if(il_const_decode(addr, &index)){
+		val = il_const_get(index);
+		if(invert) val = ~val;
+	}
+	return val;
+}
+
+/* Set a value in the image. Invalid addresses are ignored */
+void il_image_set(il_memory_image *img, uint16_t addr, uint16_t val, bool invert){
+	int bank, index;
+	if(il_image_decode(addr, &bank, &index)){
+		if(bank < 2){
+			if(invert) val = !val;
+			img->bits[bank][index] = (val ? 1 : 0);
+		} else {
+			if(invert) val = ~val;
+			img->words[bank-2][index] = val;
+		}
+	}
+}
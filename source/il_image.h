@@ -0,0 +1,98 @@
+/*
+ * il_image.h
+ *
+ * Flat memory image for the Instruction List Interpreter.
+ *
+ * Holds the four Modbus style memory banks of one simulated unit as
+ * plain arrays, so a host can run many interpreter instances without
+ * going through per-access memory callbacks.
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+
+#ifndef IL_IMAGE_H_
+#define IL_IMAGE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Number of registers in each bank. Address xNNNN maps to
+ * index NNNN-1, so valid addresses are x0001 .. xIL_IMAGE_BANK_SIZE.
+ * May be overridden at compile time.
+ */
+#ifndef IL_IMAGE_BANK_SIZE
+#define IL_IMAGE_BANK_SIZE 1000
+#endif
+
+/* Bank numbers returned by il_image_decode() */
+#define IL_BANK_COIL    0   // 0xxxx - bit outputs
+#define IL_BANK_INPUT   1   // 1xxxx - bit inputs
+#define IL_BANK_IREG    2   // 3xxxx - word inputs
+#define IL_BANK_HREG    3   // 4xxxx - word outputs / holding registers
+
+/* The memory image of one unit.
+ * - 2 sets of bit memory 0xxxx and 1xxxx, one byte (0 or 1) per bit
+ * - 2 sets of word memory 3xxxx and 4xxxx
+ */
+typedef struct{
+	uint8_t  bits[2][IL_IMAGE_BANK_SIZE];
+	uint16_t words[2][IL_IMAGE_BANK_SIZE];
+} il_memory_image;
+
+/* Turn a Modbus type address into a bank and index.
+ *
+ * @param addr  - The modbus style address 0xxxx, 1xxxx, 3xxxx, 4xxxx
+ * @param bank  - pointer to store the bank (IL_BANK_xxx)
+ * @param index - pointer to store the index within the bank
+ *
+ * @return - true if valid address else false
+ */
+bool il_image_decode(uint16_t addr, int * bank, int * index);
+
+/* Get a value from the image (optional invert). Bit values are
+ * inverted 0->1, 1->0. 16-bit values are bitwise inverted.
+ * 5xxxx addresses read the shared constant bank (il_const.h).
+ *
+ * @param img    - the memory image
+ * @param addr   - the 16-bit modbus style address
+ * @param invert - invert the value before returning
+ * @return - 0 if invalid address, else the value (with invert)
+ */
+uint16_t il_image_get(const il_memory_image *img, uint16_t addr, bool invert);
+
+/* Set an address in the image to a value (optional invert).
+ * Bit addresses are set to 1 or 0 depending on the value.
+ * Invalid addresses and the read-only 5xxxx bank are ignored.
+ *
+ * @param img    - the memory image
+ * @param addr   - the 16-bit modbus style address
+ * @param val    - the 16-bit value
+ * @param invert - invert the value before storing
+ */
+void il_image_set(il_memory_image *img, uint16_t addr, uint16_t val, bool invert);
+
+#endif /* IL_IMAGE_H_ */
@@ -34,57 +34,82 @@ DEALINGS IN THE SOFTWARE.
 #include <stdbool.h>
 #include <string.h>
 #include "il_interpreter.h"
+#include "il_opcodes.h"
 
-static il_memory_callbacks *mem;
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
-static uint16_t accum;
+/* The built-in context used by the original single
+ * instance interface functions */
+static il_context default_ctx;
 
 static bool initialised = false;
 
+/******************************************
+ * Memory access. Goes straight to the flat
+ * memory image when the context has one,
+ * otherwise through the caller's callbacks.
+ ******************************************/
+static uint16_t mem_get(il_context *ctx, uint16_t addr, bool invert){
+	if(ctx->image) return il_image_get(ctx->image, addr, invert);
+	return ctx->mem->get(addr, invert);
+}
+
+static void mem_set(il_context *ctx, uint16_t addr, uint16_t val, bool invert){
+	if(ctx->watch_map && (ctx->watch_map[addr >> 3] & (1 << (addr & 7)))){
+		uint16_t old = mem_get(ctx, addr, false);
+		if(ctx->image) il_image_set(ctx->image, addr, val, invert);
+		else           ctx->mem->set(addr, val, invert);
+		ctx->observer(ctx->observer_user, addr, old, mem_get(ctx, addr, false));
+		return;
+	}
+	if(ctx->image) il_image_set(ctx->image, addr, val, invert);
+	else           ctx->mem->set(addr, val, invert);
+}
+
 /******************************************
  * Delayed Evaluation Stack. This supports
  * the '{' and '}' delayed evaluation 
  * functionality
  ******************************************/
-#define EVAL_STACK_MAX_DEPTH 20
-
-struct{
-	uint16_t command;
-	uint16_t accum;
-} eval_stack[EVAL_STACK_MAX_DEPTH];
-
-static int eval_stack_top = 0;
 
 /* Push a command and current accumulator value onto the 
- * evaluation stack for delayed execution at the closing '}'
+ * evaluation stack for delayed execution at the closing '}'.
+ * The float accumulator is saved with it.
  *
+ * @param ctx   - the interpreter context
  * @param cmd   - the 16-bit command code being executed
  * @param accum - the current accumulator value to use for delayed execution
  */
-static void eval_stack_push(uint16_t cmd, uint16_t accum){
-	if(eval_stack_top < EVAL_STACK_MAX_DEPTH){
-		eval_stack[eval_stack_top].accum = accum;
-		eval_stack[eval_stack_top].command = cmd;
+static void eval_stack_push(il_context *ctx, uint16_t cmd, uint16_t accum){
+	if(ctx->eval_stack_top < IL_EVAL_STACK_MAX_DEPTH){
+		ctx->eval_stack[ctx->eval_stack_top].accum = accum;
+		ctx->eval_stack[ctx->eval_stack_top].faccum = ctx->faccum;
+		ctx->eval_stack[ctx->eval_stack_top].command = cmd;
 	}
-	eval_stack_top++;
+	ctx->eval_stack_top++;
 }
 
 /* Pop a saved command and accumulator value from the 
  * evaluation stack for execution at the closing '}'
  * 
- * @param cmd   - pointer to store the saved 16-bit command code
- * @param accum - pointer to store the saved accumulator value
+ * @param ctx    - the interpreter context
+ * @param cmd    - pointer to store the saved 16-bit command code
+ * @param accum  - pointer to store the saved accumulator value
+ * @param faccum - pointer to store the saved float accumulator value
  * 
  * @return - true if valid stack. false if no valid stack state
  */
-static bool eval_stack_pop(uint16_t* cmd, uint16_t* accum){
-	if((eval_stack_top  == 0) || (eval_stack_top >= EVAL_STACK_MAX_DEPTH)){
+static bool eval_stack_pop(il_context *ctx, uint16_t* cmd, uint16_t* accum, float* faccum){
+	if((ctx->eval_stack_top  == 0) || (ctx->eval_stack_top >= IL_EVAL_STACK_MAX_DEPTH)){
 		return false;
 	}
 
-	eval_stack_top--;
-	*cmd   = eval_stack[eval_stack_top].command;
-	*accum = eval_stack[eval_stack_top].accum;
+	ctx->eval_stack_top--;
+	*cmd   = ctx->eval_stack[ctx->eval_stack_top].command;
+	*accum = ctx->eval_stack[ctx->eval_stack_top].accum;
+	*faccum = ctx->eval_stack[ctx->eval_stack_top].faccum;
 	return true;
 }
 
@@ -93,33 +118,32 @@ static bool eval_stack_pop(uint16_t* cmd, uint16_t* accum){
  * the functionality to support CALL and RET
  * instructions.
  ****************************************/ 
-#define CALL_STACK_MAX_DEPTH 20
-uint16_t call_stack[CALL_STACK_MAX_DEPTH];
-static int call_stack_top = 0;
 
 /* Push a return address onto the call stack
  *
+ * @param ctx  - the interpreter context
  * @param addr - The return address to save
  * @return - true if value was pushed. false if stack is already full.
  */
-static bool call_stack_push(uint16_t addr){
-	if(call_stack_top >= CALL_STACK_MAX_DEPTH)	return false;
+static bool call_stack_push(il_context *ctx, uint16_t addr){
+	if(ctx->call_stack_top >= IL_CALL_STACK_MAX_DEPTH)	return false;
 
-	call_stack[call_stack_top] = addr;
-	call_stack_top++;
+	ctx->call_stack[ctx->call_stack_top] = addr;
+	ctx->call_stack_top++;
 	return true;
 }
 
 /* Pop the return address from the top of the call stack.
  *
+ * @param ctx     - the interpreter context
  * @param retaddr - pointer to save the popped line number
  * @return - true if valid value. false if stack is empty
  */
-static bool call_stack_pop(uint16_t * retaddr){
-	if(call_stack_top <= 0)	return false;
+static bool call_stack_pop(il_context *ctx, uint16_t * retaddr){
+	if(ctx->call_stack_top <= 0)	return false;
 
-	call_stack_top --;
-	(* retaddr) = call_stack[call_stack_top];
+	ctx->call_stack_top --;
+	(* retaddr) = ctx->call_stack[ctx->call_stack_top];
 	return true;
 }
 
@@ -127,6 +151,65 @@ static bool call_stack_pop(uint16_t * retaddr){
  * Interface functions
  ********************************************/
 
+/* Initialise an interpreter context with callbacks to
+ * allow the interpreter to manipulate the caller's
+ * memory image.
+ * 
+ * @param ctx - the context to initialise
+ * @param cb  - structure with the caller's set() and get()
+ *              memory access functions
+ */
+void il_interp_ctx_init(il_context *ctx, il_memory_callbacks *cb){
+
+	ctx->mem = cb;
+
+	ctx->image = NULL;
+
+	ctx->accum = 0;
+	ctx->faccum = 0;
+
+	ctx->eval_stack_top = 0;
+
+	ctx->call_stack_top = 0;
+
+	ctx->watch_map = NULL;
+}
+
+/* Initialise an interpreter context to operate directly
+ * on a flat memory image.
+ *
+ * @param ctx   - the context to initialise
+ * @param image - the memory image for this context
+ */
+void il_interp_ctx_init_image(il_context *ctx, il_memory_image *image){
+	il_interp_ctx_init(ctx, NULL);
+	ctx->image = image;
+}
+
+/* Read a memory address of a context (for debug) */
+uint16_t il_interp_ctx_peek(il_context *ctx, uint16_t addr){
+	return mem_get(ctx, addr, false);
+}
+
+/* Write a memory address of a context, bypassing any write watch */
+void il_interp_ctx_poke(il_context *ctx, uint16_t addr, uint16_t value){
+	if(ctx->image) il_image_set(ctx->image, addr, value, false);
+	else           ctx->mem->set(addr, value, false);
+}
+
+/* Watch writes to memory through an address bitmap
+ *
+ * @param ctx      - the interpreter context
+ * @param map      - bitmap of watched addresses, NULL to stop watching
+ * @param observer - function called after each watched write
+ * @param user     - passed to observer
+ */
+void il_interp_ctx_watch(il_context *ctx, const uint8_t *map, il_write_observer observer, void *user){
+	ctx->observer = observer;
+	ctx->observer_user = user;
+	ctx->watch_map = observer ? map : NULL;
+}
+
 /* Initialise the interpreter with callbacks to 
  * allow the interpreter to manipulate the caller's
  * memory image.
@@ -136,15 +219,25 @@ static bool call_stack_pop(uint16_t * retaddr){
  */
 void il_interp_init(il_memory_callbacks *cb){
 
-	mem = cb;
+	il_interp_ctx_init(&default_ctx, cb);
 
-	accum = 0;
-
-	eval_stack_top = 0;
+	initialised = true;
+}
 
-	call_stack_top = 0;
+/* Get the accumulator value of a context (for debug)
+ *
+ * @return - the current accumulator value
+ */
+uint16_t il_interp_ctx_get_accum(const il_context *ctx){
+	return ctx->accum;
+}
 
-	initialised = true;
+/* Get the float accumulator value of a context
+ *
+ * @return - the current float accumulator value
+ */
+float il_interp_ctx_get_faccum(const il_context *ctx){
+	return ctx->faccum;
 }
 
 /* Get the accumulator value (for debug)
@@ -152,7 +245,7 @@ void il_interp_init(il_memory_callbacks *cb){
  * @return - the current accumulator value
  */
 uint16_t il_interp_get_accum(void){
-	return accum;
+	return default_ctx.accum;
 }
 
 /******************************************************
@@ -167,37 +260,7 @@ static bool match(char * str1, char * str2){
 static bool flag(char flag, char* str){
 	return((str) && (str = strchr(str, '_')) && strchr(str,flag));
 }
-/* Command is represented as a 16-bit value 
- * bits 0-7 contain the command code. 
- * bits 8-16 contain flag bits (currently 8-11 used).
-#define CMD_LOAD 1
-#define CMD_STOR 2
-#define CMD_SET  3
-#define CMD_RST  4
-#define CMD_AND  5
-#define CMD_OR   6
-#define CMD_XOR  7
-#define CMD_ADD  8
-#define CMD_SUB  9
-#define CMD_MUL  10
-#define CMD_DIV  11
-#define CMD_GT   12
-#define CMD_GE   13
-#define CMD_EQ   14
-#define CMD_NE   15
-#define CMD_LE   16
-#define CMD_LT   17
-#define CMD_JMP  18
-#define CMD_CAL  19
-#define CMD_RET  20
-#define CMD_PAR  21   // '}' - Closing Parenthesis for sub-calculation
-#define CMD_NOP  0
-#define CMD_MASK 0x00FF
-
-#define FLG_IMM 0x1000  // 'I' - Immediate value flag
-#define FLG_NEG 0x2000  // 'N' - Negate
-#define FLG_CND 0x4000  // 'C' - Conditional for branch and call
-#define FLG_PAR 0x8000  // '{' - Begin sub-calculation 
+/* Command codes and flags are in il_opcodes.h */
 
 /* Parse a command string to a 16-bit command code
  * 
@@ -227,19 +290,73 @@ uint16_t il_interp_parse(char * command){
 	if(match("JUMP",command)) { ret = CMD_JMP;  } else
 	if(match("CALL",command)) { ret = CMD_CAL;  } else
 	if(match("RET", command)) { ret = CMD_RET;  } else
+	if(match("SEQ", command)) { ret = CMD_SEQ;  } else
+	if(match("ALARMB", command)) { ret = CMD_ALB; } else
+	if(match("ALARM", command))  { ret = CMD_ALM; } else
+	if(match("PUSH",command)) { ret = CMD_PSH;  } else
+	if(match("POP", command)) { ret = CMD_POP;  } else
+	if(match("PEEK",command)) { ret = CMD_PEK;  } else
+	if(match("SUM", command)) { ret = CMD_SUM;  } else
+	if(match("MIN", command)) { ret = CMD_MIN;  } else
+	if(match("MAX", command)) { ret = CMD_MAX;  } else
+	if(match("MEAN",command)) { ret = CMD_AVG;  } else
+	if(match("ITOF",command)) { ret = CMD_ITF;  } else
+	if(match("FTOI",command)) { ret = CMD_FTI;  } else
 	if(match("}",   command)) { ret = CMD_PAR;  } else
 	ret = CMD_NOP;
 
 	if(flag('I', command)){ ret |= FLG_IMM; }
 	if(flag('N', command)){ ret |= FLG_NEG; }
 	if(flag('C', command)){ ret |= FLG_CND; }
+	if(flag('F', command)){ ret |= FLG_FLT; }
+	if(flag('W', command)){ ret |= FLG_SWP; }
 	if(flag('{', command)){ ret |= FLG_PAR; }
 
 	return ret;
 }
 
+/* Write the mnemonic of a command code - the inverse of il_interp_parse()
+ *
+ * @param cmd  - 16-bit command code
+ * @param buf  - buffer for the mnemonic
+ * @param size - size of buf
+ * @return - buf
+ */
+char * il_interp_mnemonic(uint16_t cmd, char *buf, size_t size){
+	static const char * const names[] = {
+		"_", "LOAD", "STOR", "SET", "RST", "AND", "OR", "XOR",
+		"ADD", "SUB", "MUL", "DIV", "GT", "GE", "EQ", "NE",
+		"LE", "LT", "JUMP", "CALL", "RET", "}", "SEQ", "ALARM",
+		"ALARMB", "PUSH", "POP", "PEEK", "SUM",
+		"MIN", "MAX", "MEAN", "ITOF", "FTOI"
+	};
+	char text[16];
+	size_t n;
+
+	if((cmd & CMD_MASK) >= sizeof(names)/sizeof(names[0])){
+		strcpy(text, "_");
+	} else {
+		strcpy(text, names[cmd & CMD_MASK]);
+		if((cmd & CMD_MASK) != CMD_NOP && (cmd & (FLG_CND | FLG_NEG | FLG_IMM | FLG_FLT | FLG_SWP | FLG_PAR))){
+			n = strlen(text);
+			text[n++] = '_';
+			if(cmd & FLG_CND) text[n++] = 'C';
+			if(cmd & FLG_NEG) text[n++] = 'N';
+			if(cmd & FLG_IMM) text[n++] = 'I';
+			if(cmd & FLG_FLT) text[n++] = 'F';
+			if(cmd & FLG_SWP) text[n++] = 'W';
+			if(cmd & FLG_PAR) text[n++] = '{';
+			text[n] = 0;
+		}
+	}
+	if(size){
+		strncpy(buf, text, size - 1);
+		buf[size - 1] = 0;
+	}
+	return buf;
+}
 
-static uint16_t evaluate_operator(uint16_t cmd, uint16_t op1, uint16_t op2){
+static uint16_t evaluate_operator(il_context *ctx, uint16_t cmd, uint16_t op1, uint16_t op2){
 	uint16_t ret = 0;
 
 	// Special case code for LOAD_{ command Note: This
@@ -247,7 +364,7 @@ static uint16_t evaluate_operator(uint16_t cmd, uint16_t op1, uint16_t op2){
 	// the execution stack. Code for regular LOAD
 	// command is below in il_interp_execute(..)
 	if((cmd & CMD_MASK) == CMD_LOAD){
-		ret = mem->get(op2,FLG_NEG==(cmd&FLG_NEG));
+		ret = mem_get(ctx, op2,FLG_NEG==(cmd&FLG_NEG));
 		return ret;
 	}
 	// and for STOR_{ Command. Note: This code will
@@ -256,7 +373,7 @@ static uint16_t evaluate_operator(uint16_t cmd, uint16_t op1, uint16_t op2){
 	// in il_interp_execute(..)
 	if((cmd & CMD_MASK) == CMD_STOR){
 		ret = op1;
-		mem->set(op2, op1,FLG_NEG==(cmd&FLG_NEG));
+		mem_set(ctx, op2, op1,FLG_NEG==(cmd&FLG_NEG));
 		return ret;
 	}
 
@@ -270,7 +387,7 @@ static uint16_t evaluate_operator(uint16_t cmd, uint16_t op1, uint16_t op2){
 	case CMD_ADD: ret = op1 + op2; break;
 	case CMD_SUB: ret = op1 - op2; break;
 	case CMD_MUL: ret = op1 * op2; break;
-	case CMD_DIV: ret = op1 / op2; break;
+	case CMD_DIV: ret = op2 ? op1 / op2 : IL_DIV_ZERO_RESULT; break;
 	case CMD_GT:  ret = op1 > op2; break;
 	case CMD_GE:  ret = op1 >=op2; break;
 	case CMD_EQ:  ret = op1 ==op2; break;
@@ -281,21 +398,497 @@ static uint16_t evaluate_operator(uint16_t cmd, uint16_t op1, uint16_t op2){
 	return ret;
 }
 
+/******************************************
+ * Floating point on register pairs
+ ******************************************/
+
+/* Read a float from a register pair
+ *
+ * @param ctx  - the interpreter context
+ * @param addr - address of the pair
+ * @param cmd  - the command (FLG_SWP selects low word first)
+ * @return - the value
+ */
+static float mem_get_float(il_context *ctx, uint16_t addr, uint16_t cmd){
+	uint32_t hi = mem_get(ctx, addr, false);
+	uint32_t lo = mem_get(ctx, addr + 1, false);
+	uint32_t bits = (cmd & FLG_SWP) ? (lo << 16 | hi) : (hi << 16 | lo);
+	float f;
+	memcpy(&f, &bits, sizeof(f));
+	return f;
+}
+
+/* Write a float to a register pair. See mem_get_float() */
+static void mem_set_float(il_context *ctx, uint16_t addr, float f, uint16_t cmd){
+	uint32_t bits;
+	memcpy(&bits, &f, sizeof(bits));
+	mem_set(ctx, addr,     (cmd & FLG_SWP) ? bits & 0xFFFF : bits >> 16, false);
+	mem_set(ctx, addr + 1, (cmd & FLG_SWP) ? bits >> 16 : bits & 0xFFFF, false);
+}
+
+/* Float version of evaluate_operator(). LOAD and STOR only come here
+ * from '}', with op2 unused and the address in the accumulator.
+ *
+ * @param ctx - the interpreter context
+ * @param cmd - the command
+ * @param op1 - the float accumulator
+ * @param op2 - the float operand
+ */
+static void evaluate_float(il_context *ctx, uint16_t cmd, float op1, float op2){
+	switch(cmd & CMD_MASK){
+	case CMD_LOAD: ctx->faccum = mem_get_float(ctx, ctx->accum, cmd); break;
+	case CMD_STOR:
+		mem_set_float(ctx, ctx->accum, (cmd & FLG_NEG) ? -op1 : op1, cmd);
+		ctx->faccum = op1;
+		break;
+	case CMD_ADD: ctx->faccum = op1 + op2; break;
+	case CMD_SUB: ctx->faccum = op1 - op2; break;
+	case CMD_MUL: ctx->faccum = op1 * op2; break;
+	case CMD_DIV: ctx->faccum = op1 / op2; break;
+	default:
+		// Compares keep the float accumulator
+		ctx->faccum = op1;
+		switch(cmd & CMD_MASK){
+		case CMD_GT: ctx->accum = op1 > op2;  break;
+		case CMD_GE: ctx->accum = op1 >= op2; break;
+		case CMD_EQ: ctx->accum = op1 == op2; break;
+		case CMD_NE: ctx->accum = op1 != op2; break;
+		case CMD_LE: ctx->accum = op1 <= op2; break;
+		case CMD_LT: ctx->accum = op1 < op2;  break;
+		}
+		break;
+	}
+}
+
+/* Execute a float (F flag) LOAD, STOR, arithmetic or compare
+ *
+ * @param ctx      - the interpreter context
+ * @param cmd      - the command
+ * @param location - the line's value
+ */
+static void execute_float(il_context *ctx, uint16_t cmd, uint16_t location){
+	float value;
+
+	if((cmd & FLG_PAR) && ((cmd & CMD_MASK) == CMD_LOAD || (cmd & CMD_MASK) == CMD_STOR)){
+		// Calculate the pair's address in the accumulator
+		eval_stack_push(ctx, cmd, ctx->accum);
+		ctx->accum = location;
+		return;
+	}
+	if((cmd & CMD_MASK) == CMD_STOR){
+		mem_set_float(ctx, location, (cmd & FLG_NEG) ? -ctx->faccum : ctx->faccum, cmd);
+		return;
+	}
+
+	if(cmd & FLG_IMM) value = location;
+	else              value = mem_get_float(ctx, location, cmd);
+	if(cmd & FLG_NEG) value = -value;
+
+	if((cmd & CMD_MASK) == CMD_LOAD){
+		ctx->faccum = value;
+	} else if(cmd & FLG_PAR){
+		eval_stack_push(ctx, cmd, ctx->accum);
+		ctx->faccum = value;
+	} else {
+		evaluate_float(ctx, cmd, ctx->faccum, value);
+	}
+}
+
+/* Float accumulator to 16-bit, rounded and limited */
+static uint16_t float_to_word(float f){
+	if(!(f >= 0.5f)) return 0;       // also NaN
+	if(f >= 65534.5f) return 65535;
+	return (uint16_t)(f + 0.5f);
+}
+
+/* Run the step sequencer whose register block starts at block
+ *
+ * @param ctx   - the interpreter context
+ * @param block - address of the sequencer block
+ * @param line  - the line after the SEQ
+ * @return - the next line to execute
+ */
+static uint16_t sequence(il_context *ctx, uint16_t block, uint16_t line){
+	uint16_t steps = mem_get(ctx, block + IL_SEQ_STEPS, false);
+	uint16_t step  = mem_get(ctx, block + IL_SEQ_STEP, false);
+	uint16_t row, cond, time, next, entry = 0, exit;
+
+	ctx->accum = 0;
+	if(step >= steps) return line;
+
+	row = block + IL_SEQ_TABLE + IL_SEQ_ROW * step;
+	cond = mem_get(ctx, row, false);
+	if(!cond || !mem_get(ctx, cond, false)){
+		time = mem_get(ctx, block + IL_SEQ_TIME, false);
+		if(time != 0xFFFF) mem_set(ctx, block + IL_SEQ_TIME, time + 1, false);
+		return line;
+	}
+
+	// Transition
+	next = mem_get(ctx, row + 1, false);
+	exit = mem_get(ctx, row + 3, false);
+	if(next < steps) entry = mem_get(ctx, block + IL_SEQ_TABLE + IL_SEQ_ROW * next + 2, false);
+	mem_set(ctx, block + IL_SEQ_STEP, next, false);
+	mem_set(ctx, block + IL_SEQ_TIME, 0, false);
+	ctx->accum = 1;
+
+	// Call the exit action with the entry action as its return
+	// address, so RET from exit runs entry, and RET from entry
+	// comes back here.
+	if(entry && call_stack_push(ctx, line)) line = entry;
+	if(exit  && call_stack_push(ctx, line)) line = exit;
+	return line;
+}
+
+/* Find a range of word registers in the context's memory image
+ *
+ * @param ctx   - the interpreter context (with an image)
+ * @param addr  - the first address
+ * @param count - number of registers
+ * @return - the first register, or NULL if the range is not all in
+ *           one word bank
+ */
+static uint16_t * word_range(il_context *ctx, uint16_t addr, uint16_t count){
+	int bank, index;
+	if(!il_image_decode(addr, &bank, &index) || bank < IL_BANK_IREG) return NULL;
+	if(index + count > IL_IMAGE_BANK_SIZE) return NULL;
+	return &ctx->image->words[bank - IL_BANK_IREG][index];
+}
+
+/* New alarm status of one value, before any delay. Branch free, so
+ * the block loop below vectorises.
+ *
+ * @param v     - the value
+ * @param old   - the previous status
+ * @param hh, h, l, ll - the limits
+ * @param hyst  - hysteresis
+ * @param hold  - status bits held by an unacknowledged latch
+ * @param raise - set to the limits passed now
+ * @return - the status
+ */
+static inline uint16_t alarm_status(uint16_t v, uint16_t old, uint16_t hh, uint16_t h,
+		uint16_t l, uint16_t ll, uint16_t hyst, uint16_t hold, uint16_t *raise){
+	uint32_t up = (uint32_t)v + hyst;     // compared with a high limit to clear it
+	uint32_t lo = (uint32_t)v;
+	uint16_t r, keep;
+
+	r = (v >= hh) * IL_ALARM_HH | (v >= h) * IL_ALARM_H
+	  | (v <= l) * IL_ALARM_L   | (v <= ll) * IL_ALARM_LL;
+	keep = (up >= hh) * IL_ALARM_HH | (up >= h) * IL_ALARM_H
+	     | (lo <= (uint32_t)l + hyst) * IL_ALARM_L | (lo <= (uint32_t)ll + hyst) * IL_ALARM_LL;
+	*raise = r;
+	return r | (old & (keep | hold));
+}
+
+/* Run the alarm whose register block starts at block
+ *
+ * @return - the new status
+ */
+static uint16_t alarm(il_context *ctx, uint16_t block){
+	uint16_t lim[4], timer[4];
+	uint16_t v, hyst, delay, config, status, old, ack, raise, hold;
+	int k;
+
+	v      = mem_get(ctx, mem_get(ctx, block + IL_ALARM_VALUE, false), false);
+	for(k = 0; k < 4; k++) lim[k] = mem_get(ctx, block + IL_ALARM_LIMITS + k, false);
+	hyst   = mem_get(ctx, block + IL_ALARM_HYST, false);
+	delay  = mem_get(ctx, block + IL_ALARM_DELAY, false);
+	config = mem_get(ctx, block + IL_ALARM_CONFIG, false);
+	old    = mem_get(ctx, block + IL_ALARM_STATUS, false);
+	ack    = mem_get(ctx, block + IL_ALARM_ACK, false);
+
+	hold = ((config & IL_ALARM_LATCH) && !ack) ? 0x0F : 0;
+	status = alarm_status(v, old, lim[0], lim[1], lim[2], lim[3], hyst, hold, &raise);
+
+	// A limit must be passed for delay scans in a row before it alarms
+	for(k = 0; k < 4; k++){
+		uint16_t bit = 1 << k;
+		uint16_t t = mem_get(ctx, block + IL_ALARM_TIMERS + k, false);
+		timer[k] = (raise & bit) ? (t == 0xFFFF ? t : t + 1) : 0;
+		if(timer[k] != t) mem_set(ctx, block + IL_ALARM_TIMERS + k, timer[k], false);
+		if((raise & bit) && !(old & bit) && timer[k] < delay) status &= ~bit;
+	}
+	status &= config & 0x0F;
+
+	if(status != old) mem_set(ctx, block + IL_ALARM_STATUS, status, false);
+	if(ack) mem_set(ctx, block + IL_ALARM_ACK, 0, false);
+	return status;
+}
+
+/* Run the block alarm whose register block starts at block
+ *
+ * @return - the number of values in alarm
+ */
+static uint16_t alarm_block(il_context *ctx, uint16_t block){
+	uint16_t first  = mem_get(ctx, block + IL_ALARMB_FIRST, false);
+	uint16_t count  = mem_get(ctx, block + IL_ALARMB_COUNT, false);
+	uint16_t hh     = mem_get(ctx, block + IL_ALARMB_LIMITS, false);
+	uint16_t h      = mem_get(ctx, block + IL_ALARMB_LIMITS + 1, false);
+	uint16_t l      = mem_get(ctx, block + IL_ALARMB_LIMITS + 2, false);
+	uint16_t ll     = mem_get(ctx, block + IL_ALARMB_LIMITS + 3, false);
+	uint16_t hyst   = mem_get(ctx, block + IL_ALARMB_HYST, false);
+	uint16_t config = mem_get(ctx, block + IL_ALARMB_CONFIG, false);
+	uint16_t ack    = mem_get(ctx, block + IL_ALARMB_ACK, false);
+	uint16_t enable = config & 0x0F;
+	uint16_t hold   = ((config & IL_ALARM_LATCH) && !ack) ? 0x0F : 0;
+	uint16_t active = 0, raise, i;
+	uint16_t * val, * st;
+
+	if(ctx->image && !ctx->watch_map
+			&& (val = word_range(ctx, first, count))
+			&& (st = word_range(ctx, block + IL_ALARMB_STATUS, count))){
+		// Flat memory - straight over the register arrays
+		for(i = 0; i < count; i++){
+			uint16_t s = alarm_status(val[i], st[i], hh, h, l, ll, hyst, hold, &raise) & enable;
+			st[i] = s;
+			active += (s != 0);
+		}
+	} else {
+		for(i = 0; i < count; i++){
+			uint16_t old = mem_get(ctx, block + IL_ALARMB_STATUS + i, false);
+			uint16_t s = alarm_status(mem_get(ctx, first + i, false), old,
+					hh, h, l, ll, hyst, hold, &raise) & enable;
+			if(s != old) mem_set(ctx, block + IL_ALARMB_STATUS + i, s, false);
+			active += (s != 0);
+		}
+	}
+	mem_set(ctx, block + IL_ALARMB_ACTIVE, active, false);
+	if(ack) mem_set(ctx, block + IL_ALARMB_ACK, 0, false);
+	return active;
+}
+
+/* Copy registers between a ring and a block of registers, in at
+ * most two runs either side of the wrap
+ *
+ * @param ctx   - the interpreter context
+ * @param ring  - address of the ring's first register
+ * @param size  - capacity of the ring
+ * @param pos   - first position in the ring
+ * @param block - address of the first register of the block
+ * @param count - number of registers (no more than size)
+ * @param push  - true to copy into the ring, false out of it
+ */
+static void ring_copy(il_context *ctx, uint16_t ring, uint16_t size, uint16_t pos,
+		uint16_t block, uint16_t count, bool push){
+	uint16_t * r, * b;
+	uint32_t i;
+
+	if(ctx->image && !ctx->watch_map
+			&& (r = word_range(ctx, ring, size))
+			&& (b = word_range(ctx, block, count))){
+		// Flat memory - straight copies
+		size_t first = (size_t)(size - pos < count ? size - pos : count);
+		if(push){
+			memmove(r + pos, b, first * sizeof(*r));
+			memmove(r, b + first, (count - first) * sizeof(*r));
+		} else {
+			memmove(b, r + pos, first * sizeof(*r));
+			memmove(b + first, r, (count - first) * sizeof(*r));
+		}
+		return;
+	}
+	for(i = 0; i < count; i++){
+		uint16_t at = ring + (uint16_t)((pos + i) % size);
+		if(push) mem_set(ctx, at, mem_get(ctx, block + i, false), false);
+		else     mem_set(ctx, block + i, mem_get(ctx, at, false), false);
+	}
+}
+
+/* Push, pop or peek on the ring described at block
+ *
+ * @param ctx   - the interpreter context
+ * @param block - address of the ring's registers
+ * @param cmd   - CMD_PSH, CMD_POP or CMD_PEK
+ * @return - values in the ring after a push, or values copied out
+ */
+static uint16_t fifo(il_context *ctx, uint16_t block, uint16_t cmd){
+	uint16_t n     = mem_get(ctx, block + IL_FIFO_BLOCK, false);
+	uint16_t head  = mem_get(ctx, block + IL_FIFO_HEAD, false);
+	uint16_t tail  = mem_get(ctx, block + IL_FIFO_TAIL, false);
+	uint16_t count = mem_get(ctx, block + IL_FIFO_COUNT, false);
+	uint16_t size  = mem_get(ctx, block + IL_FIFO_SIZE, false);
+	uint16_t ring  = block + IL_FIFO_DATA;
+	uint16_t ret, first;
+
+	if(size == 0) return 0;
+	if(n == 0) n = 1;
+	if(head >= size || count > size) head = count = 0;
+	first = (uint16_t)(((uint32_t)head + size - count) % size);
+
+	if(cmd == CMD_PSH){
+		uint16_t src = mem_get(ctx, block + IL_FIFO_SOURCE, false);
+		if(n > size){
+			// Only the newest values fit
+			src += n - size;
+			n = size;
+		}
+		ring_copy(ctx, ring, size, head, src, n, true);
+		head = (uint16_t)(((uint32_t)head + n) % size);
+		count = (uint32_t)count + n > size ? size : count + n;
+		ret = count;
+	} else {
+		if(n > count) n = count;
+		ring_copy(ctx, ring, size, first, mem_get(ctx, block + IL_FIFO_DEST, false), n, false);
+		if(cmd == CMD_POP) count -= n;
+		ret = n;
+	}
+	first = (uint16_t)(((uint32_t)head + size - count) % size);
+
+	if(head  != mem_get(ctx, block + IL_FIFO_HEAD, false))  mem_set(ctx, block + IL_FIFO_HEAD, head, false);
+	if(first != tail)                                         mem_set(ctx, block + IL_FIFO_TAIL, first, false);
+	if(count != mem_get(ctx, block + IL_FIFO_COUNT, false)) mem_set(ctx, block + IL_FIFO_COUNT, count, false);
+	return ret;
+}
+
+/******************************************
+ * Block statistics kernels over plain
+ * register arrays. SSE2 where available.
+ ******************************************/
+
+#ifdef __SSE2__
+
+/* Sum of n registers */
+static uint32_t block_sum(const uint16_t *v, uint16_t n){
+	const __m128i zero = _mm_setzero_si128();
+	__m128i acc = zero;
+	uint32_t lanes[4], sum;
+	uint16_t i = 0;
+
+	for(; i + 8 <= n; i += 8){
+		__m128i x = _mm_loadu_si128((const __m128i *)(v + i));
+		acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(x, zero));
+		acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(x, zero));
+	}
+	_mm_storeu_si128((__m128i *)lanes, acc);
+	sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+	for(; i < n; i++) sum += v[i];
+	return sum;
+}
 
-/* Execute a line of the program. Update the machine state 
- * and return the next line to execute.
+/* Smallest or largest of n registers (n > 0). SSE2 only compares
+ * signed words, so values are biased by 0x8000 first.
+ */
+static uint16_t block_extreme(const uint16_t *v, uint16_t n, bool max){
+	const __m128i bias = _mm_set1_epi16((short)0x8000);
+	uint16_t lanes[8], best = v[0];
+	uint16_t i = 0, k;
+
+	if(n >= 8){
+		__m128i b = _mm_xor_si128(_mm_loadu_si128((const __m128i *)v), bias);
+		for(i = 8; i + 8 <= n; i += 8){
+			__m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(v + i)), bias);
+			b = max ? _mm_max_epi16(b, x) : _mm_min_epi16(b, x);
+		}
+		_mm_storeu_si128((__m128i *)lanes, _mm_xor_si128(b, bias));
+		for(k = 0; k < 8; k++){
+			if(max ? lanes[k] > best : lanes[k] < best) best = lanes[k];
+		}
+	}
+	for(; i < n; i++){
+		if(max ? v[i] > best : v[i] < best) best = v[i];
+	}
+	return best;
+}
+
+/* Index of the first of n registers equal to val (n if none) */
+static uint16_t block_find(const uint16_t *v, uint16_t n, uint16_t val){
+	const __m128i k = _mm_set1_epi16((short)val);
+	uint16_t i = 0;
+
+	// Skip whole groups of 8 without a match, then finish one by one
+	for(; i + 8 <= n; i += 8){
+		__m128i x = _mm_loadu_si128((const __m128i *)(v + i));
+		if(_mm_movemask_epi8(_mm_cmpeq_epi16(x, k))) break;
+	}
+	while(i < n && v[i] != val) i++;
+	return i;
+}
+
+#else
+
+static uint32_t block_sum(const uint16_t *v, uint16_t n){
+	uint32_t sum = 0;
+	uint16_t i;
+	for(i = 0; i < n; i++) sum += v[i];
+	return sum;
+}
+
+static uint16_t block_extreme(const uint16_t *v, uint16_t n, bool max){
+	uint16_t best = v[0], i;
+	for(i = 1; i < n; i++){
+		if(max ? v[i] > best : v[i] < best) best = v[i];
+	}
+	return best;
+}
+
+static uint16_t block_find(const uint16_t *v, uint16_t n, uint16_t val){
+	uint16_t i = 0;
+	while(i < n && v[i] != val) i++;
+	return i;
+}
+
+#endif
+
+/* Sum, minimum, maximum or mean of the range described at block
+ *
+ * @param ctx   - the interpreter context
+ * @param block - address of the statistic's registers
+ * @param cmd   - CMD_SUM, CMD_MIN, CMD_MAX or CMD_AVG
+ * @return - the result
+ */
+static uint16_t block_stat(il_context *ctx, uint16_t block, uint16_t cmd){
+	uint16_t first = mem_get(ctx, block + IL_STAT_FIRST, false);
+	uint16_t count = mem_get(ctx, block + IL_STAT_COUNT, false);
+	uint16_t result = 0, extra = 0, i;
+	uint32_t sum = 0;
+	const uint16_t * v;
+
+	if(count == 0){
+		// Nothing to reduce
+	} else if(ctx->image && (v = word_range(ctx, first, count))){
+		// Flat memory - run the kernels straight over the registers
+		if(cmd == CMD_SUM || cmd == CMD_AVG){
+			sum = block_sum(v, count);
+		} else {
+			result = block_extreme(v, count, cmd == CMD_MAX);
+			extra = block_find(v, count, result);
+		}
+	} else {
+		result = mem_get(ctx, first, false);
+		for(i = 0; i < count; i++){
+			uint16_t x = mem_get(ctx, first + i, false);
+			sum += x;
+			if(cmd == CMD_MAX ? x > result : x < result){
+				result = x;
+				extra = i;
+			}
+		}
+	}
+	if(cmd == CMD_SUM || cmd == CMD_AVG){
+		result = (uint16_t)(cmd == CMD_SUM ? sum : (count ? sum / count : 0));
+		extra = (uint16_t)(sum >> 16);
+	}
+	mem_set(ctx, block + IL_STAT_RESULT, result, false);
+	mem_set(ctx, block + IL_STAT_EXTRA, extra, false);
+	return result;
+}
+
+/* Execute a line of the program in a context. Update the
+ * machine state and return the next line to execute.
  * 
- * @param - cmd   - The command code to execute (private to il_interpreter.c)
+ * @param - ctx   - The interpreter context
+ * @param - cmd   - The command code to execute (codes are in il_opcodes.h)
  * @param - value - The Value parameter associated with the command
  * @param - location - The current line number (for relative jumps)
  *
  * @return - The new line number according to the command and current line
  */
-uint16_t il_interp_execute(uint16_t cmd, uint16_t location, uint16_t line){
+uint16_t il_interp_ctx_execute(il_context *ctx, uint16_t cmd, uint16_t location, uint16_t line){
 
 	uint16_t value;
 	uint16_t s_accum;
 	uint16_t s_cmd;
+	float s_faccum;
 
 	value = location; // This default for "I" flag and for STOR Cmd
 	line += 1;        // safe to pre-increment the line number.
@@ -303,24 +896,26 @@ uint16_t il_interp_execute(uint16_t cmd, uint16_t location, uint16_t line){
 
 	switch(cmd & CMD_MASK){
 
+	case CMD_TRP:
+		return IL_INTERP_LINE_TRAP;
 	case CMD_SET:
-		if(	(!(cmd & FLG_NEG) &&  accum) ||
-			( (cmd & FLG_NEG) && !accum) ){
-			mem->set(location,1,false);
+		if(	(!(cmd & FLG_NEG) &&  ctx->accum) ||
+			( (cmd & FLG_NEG) && !ctx->accum) ){
+			mem_set(ctx, location,1,false);
 		}
 		break;
 	case CMD_RST:
-		if(	(!(cmd & FLG_NEG) &&  accum) ||
-			( (cmd & FLG_NEG) && !accum) ){
-			mem->set(location,0,false);
+		if(	(!(cmd & FLG_NEG) &&  ctx->accum) ||
+			( (cmd & FLG_NEG) && !ctx->accum) ){
+			mem_set(ctx, location,0,false);
 		}
 		break;
 	case CMD_JMP:
 	case CMD_RET:
 	case CMD_CAL:
 		if((cmd & FLG_CND) &&  // Conditional
-		   ( ( (cmd & FLG_NEG) &&  accum) ||
-			 (!(cmd & FLG_NEG) && !accum) ) ){
+		   ( ( (cmd & FLG_NEG) &&  ctx->accum) ||
+			 (!(cmd & FLG_NEG) && !ctx->accum) ) ){
 				break; // If condition fails, no action
 		}
 		switch(cmd & CMD_MASK){
@@ -328,14 +923,14 @@ uint16_t il_interp_execute(uint16_t cmd, uint16_t location, uint16_t line){
 			line = location;   // Execute the jump
 			break;
 		case CMD_RET:
-			if(!call_stack_pop(&line)){
+			if(!call_stack_pop(ctx, &line)){
 				// Pop failed - No context on stack
 				// Exit
 				line = 65535;
 			}
 			break;
 		case CMD_CAL:
-			if(call_stack_push(line)){
+			if(call_stack_push(ctx, line)){
 				line = location;
 			}
 			// If no space on call stack, move to next line
@@ -344,19 +939,21 @@ uint16_t il_interp_execute(uint16_t cmd, uint16_t location, uint16_t line){
 		break;
 	case CMD_STOR:
 	case CMD_LOAD:
-		if(cmd & FLG_PAR){
+		if(cmd & FLG_FLT){
+			execute_float(ctx, cmd, location);
+		} else if(cmd & FLG_PAR){
 			// Push the command and current accumulator
 			// to the eval stack
-			eval_stack_push(cmd, accum);
+			eval_stack_push(ctx, cmd, ctx->accum);
 			// Now start the address calculation by loading the
 			// value into the accumulator
-			accum = location;
+			ctx->accum = location;
 		} else {
 			if((cmd & CMD_MASK) == CMD_STOR){
-				mem->set(location, accum,FLG_NEG==(cmd&FLG_NEG));
+				mem_set(ctx, location, ctx->accum,FLG_NEG==(cmd&FLG_NEG));
 			} else { // CMD_LOAD
-				if(cmd & FLG_IMM) accum = location;
-				else accum = mem->get(location,FLG_NEG==(cmd&FLG_NEG));
+				if(cmd & FLG_IMM) ctx->accum = location;
+				else ctx->accum = mem_get(ctx, location,FLG_NEG==(cmd&FLG_NEG));
 			}
 		}
 		break;
@@ -373,18 +970,58 @@ uint16_t il_interp_execute(uint16_t cmd, uint16_t location, uint16_t line){
 	case CMD_NE:
 	case CMD_LE:
 	case CMD_LT:
+		if((cmd & FLG_FLT) && (cmd & CMD_MASK) >= CMD_ADD){
+			execute_float(ctx, cmd, location);
+			break;
+		}
 		if(cmd & FLG_IMM) value = location;
-		else              value = mem->get(location,false);
+		else              value = mem_get(ctx, location,false);
 		if(cmd & FLG_PAR){     // Delayed evaluation
-			eval_stack_push(cmd, accum);
-			accum = value;
+			eval_stack_push(ctx, cmd, ctx->accum);
+			ctx->accum = value;
 		} else {// Normal evaluation
-			accum = evaluate_operator(cmd, accum, value);
+			ctx->accum = evaluate_operator(ctx, cmd, ctx->accum, value);
 		}
 		break;
+	case CMD_SEQ:
+		line = sequence(ctx, location, line);
+		break;
+	case CMD_ALM:
+		ctx->accum = alarm(ctx, location);
+		break;
+	case CMD_ALB:
+		ctx->accum = alarm_block(ctx, location);
+		break;
+	case CMD_PSH:
+	case CMD_POP:
+	case CMD_PEK:
+		ctx->accum = fifo(ctx, location, cmd & CMD_MASK);
+		break;
+	case CMD_SUM:
+	case CMD_MIN:
+	case CMD_MAX:
+	case CMD_AVG:
+		ctx->accum = block_stat(ctx, location, cmd & CMD_MASK);
+		break;
+	case CMD_ITF:
+		ctx->faccum = ctx->accum;
+		break;
+	case CMD_FTI:
+		ctx->accum = float_to_word(ctx->faccum);
+		break;
 	case CMD_PAR: // Close Parentheses "}"
-		if(eval_stack_pop(&s_cmd, &s_accum)){
-			accum = evaluate_operator(s_cmd, s_accum, accum);
+		if(!eval_stack_pop(ctx, &s_cmd, &s_accum, &s_faccum)){
+			// Unbalanced - nothing to close
+		} else if(s_cmd & FLG_FLT){
+			if((s_cmd & CMD_MASK) == CMD_LOAD || (s_cmd & CMD_MASK) == CMD_STOR){
+				evaluate_float(ctx, s_cmd, ctx->faccum, 0);
+			} else {
+				evaluate_float(ctx, s_cmd, s_faccum, ctx->faccum);
+			}
+			// As in the flat forms, only compares leave a result in accum
+			if((s_cmd & CMD_MASK) < CMD_GT) ctx->accum = s_accum;
+		} else {
+			ctx->accum = evaluate_operator(ctx, s_cmd, s_accum, ctx->accum);
 		}
 		break;
 	case CMD_NOP:
@@ -394,7 +1031,14 @@ uint16_t il_interp_execute(uint16_t cmd, uint16_t location, uint16_t line){
 	return line;
 }
 
-
-
-
-
+/* Execute a line of the program in the built-in context.
+ * 
+ * @param - cmd   - The command code to execute (codes are in il_opcodes.h)
+ * @param - value - The Value parameter associated with the command
+ * @param - location - The current line number (for relative jumps)
+ *
+ * @return - The new line number according to the command and current line
+ */
+uint16_t il_interp_execute(uint16_t cmd, uint16_t location, uint16_t line){
+	return il_interp_ctx_execute(&default_ctx, cmd, location, line);
+}
@@ -37,6 +37,9 @@ DEALINGS IN THE SOFTWARE.
 #define IL_INTERPRETER_H_
 
 #include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "il_image.h"
 
 /* Memory call back structure provdes interface to memory get and set instrns
  * invert allows the memory interface to handle bit and word types correctly
@@ -49,6 +52,204 @@ typedef struct{
 	void (*set)(uint16_t address, uint16_t value, bool invert);
 } il_memory_callbacks;
 
+/******************************************
+ * Interpreter context. Holds the complete
+ * machine state of one interpreter instance
+ * so that a host can run many units, and
+ * allocate each one where it is executed.
+ ******************************************/
+#define IL_EVAL_STACK_MAX_DEPTH 20
+#define IL_CALL_STACK_MAX_DEPTH 20
+
+/* Trap instruction. A debugger patches this command code over a line
+ * to place a breakpoint. Executing it changes nothing and returns
+ * IL_INTERP_LINE_TRAP instead of the next line number.
+ */
+#define IL_INTERP_CMD_TRAP  0x00FE
+#define IL_INTERP_LINE_TRAP 65534
+
+/* Result of a divide by zero (DIV, DIV_I and delayed DIV). Define
+ * at compile time to match the firmware being simulated.
+ */
+#ifndef IL_DIV_ZERO_RESULT
+#define IL_DIV_ZERO_RESULT 0
+#endif
+
+/* Step sequencer. "SEQ addr" runs the sequencer whose block of
+ * registers starts at addr (normally 4xxxx):
+ *
+ *   addr+0         current step, 0 .. steps-1
+ *   addr+1         step time - scans since the step was entered
+ *                  (saturates at 65535)
+ *   addr+2         number of steps
+ *   addr+3+4*s     step s: condition address, next step,
+ *                  entry line, exit line
+ *
+ * The current step's row is found directly. When the register named
+ * by its condition address is non-zero (address 0 = never), the step
+ * changes to next, the step time restarts at 0, and the step's exit
+ * action and then the new step's entry action are called. Actions
+ * are subroutines ending in RET, called as by CALL. Line 0 means no
+ * action. The accumulator is set to 1 if the step changed, else 0,
+ * before any action runs.
+ * A current step outside the table does nothing.
+ */
+#define IL_SEQ_STEP  0
+#define IL_SEQ_TIME  1
+#define IL_SEQ_STEPS 2
+#define IL_SEQ_TABLE 3
+#define IL_SEQ_ROW   4   // registers per step: condition, next, entry, exit
+
+/* Alarm evaluation. "ALARM addr" checks one analog point against
+ * four limits, with the limits and state in a block of registers
+ * at addr (normally 4xxxx):
+ *
+ *   addr+0         address of the value to check
+ *   addr+1 .. 4    HH, H, L and LL limits
+ *   addr+5         hysteresis
+ *   addr+6         delay - scans a limit must be passed before it alarms
+ *   addr+7         config - IL_ALARM_xx bits of the limits in use,
+ *                  plus IL_ALARM_LATCH
+ *   addr+8         status - IL_ALARM_xx bits of the active alarms
+ *   addr+9         acknowledge - set non-zero to release latched
+ *                  alarms whose condition has cleared. Reset to 0.
+ *   addr+10 .. 13  delay counters of HH, H, L and LL
+ *
+ * A high alarm is raised when value >= limit and clears when
+ * value < limit - hysteresis. A low alarm is raised when value <= limit
+ * and clears when value > limit + hysteresis. With IL_ALARM_LATCH an
+ * alarm also stays active until acknowledged. Values are unsigned.
+ * The accumulator is set to the status.
+ *
+ * "ALARMB addr" checks a block of points against one set of limits,
+ * without delay:
+ *
+ *   addr+0         address of the first value (3xxxx or 4xxxx)
+ *   addr+1         number of values
+ *   addr+2 .. 5    HH, H, L and LL limits
+ *   addr+6         hysteresis
+ *   addr+7         config
+ *   addr+8         acknowledge
+ *   addr+9         number of values with an active alarm
+ *   addr+10 ..     status of each value
+ *
+ * The accumulator is set to the number of values in alarm.
+ */
+#define IL_ALARM_HH     0x01
+#define IL_ALARM_H      0x02
+#define IL_ALARM_L      0x04
+#define IL_ALARM_LL     0x08
+#define IL_ALARM_LATCH  0x10
+
+#define IL_ALARM_VALUE  0
+#define IL_ALARM_LIMITS 1
+#define IL_ALARM_HYST   5
+#define IL_ALARM_DELAY  6
+#define IL_ALARM_CONFIG 7
+#define IL_ALARM_STATUS 8
+#define IL_ALARM_ACK    9
+#define IL_ALARM_TIMERS 10
+#define IL_ALARM_SIZE   14
+
+#define IL_ALARMB_FIRST  0
+#define IL_ALARMB_COUNT  1
+#define IL_ALARMB_LIMITS 2
+#define IL_ALARMB_HYST   6
+#define IL_ALARMB_CONFIG 7
+#define IL_ALARMB_ACK    8
+#define IL_ALARMB_ACTIVE 9
+#define IL_ALARMB_STATUS 10
+
+/* Ring buffers (FIFOs) in word memory. "PUSH addr" appends a block of
+ * registers to the ring described at addr, dropping the oldest values
+ * once it is full. "POP addr" moves the oldest values out to a block of
+ * registers, and "PEEK addr" copies them without removing them.
+ *
+ *   addr+0         address of the first register to push
+ *   addr+1         address of the first register to pop or peek into
+ *   addr+2         registers per operation (0 is taken as 1)
+ *   addr+3         head - position the next value is written to
+ *   addr+4         tail - position of the oldest value
+ *   addr+5         number of values in the ring
+ *   addr+6         capacity
+ *   addr+7 ..      the ring, capacity registers
+ *
+ * A ring whose head or count is out of range is emptied. PUSH sets the
+ * accumulator to the number of values in the ring. POP and PEEK set it
+ * to the number of values copied, which is fewer than asked for when
+ * the ring holds fewer.
+ */
+#define IL_FIFO_SOURCE 0
+#define IL_FIFO_DEST   1
+#define IL_FIFO_BLOCK  2
+#define IL_FIFO_HEAD   3
+#define IL_FIFO_TAIL   4
+#define IL_FIFO_COUNT  5
+#define IL_FIFO_SIZE   6
+#define IL_FIFO_DATA   7
+
+/* Block statistics over a range of registers. "SUM addr", "MIN addr",
+ * "MAX addr" and "MEAN addr" reduce the range described at addr:
+ *
+ *   addr+0         address of the first register
+ *   addr+1         number of registers
+ *   addr+2         result - low word of the sum, the minimum, the
+ *                  maximum or the mean (rounded down)
+ *   addr+3         high word of the sum for SUM and MEAN, index of the
+ *                  first minimum or maximum for MIN and MAX
+ *
+ * Values are unsigned. The accumulator is set to the result. An empty
+ * range gives 0.
+ */
+#define IL_STAT_FIRST  0
+#define IL_STAT_COUNT  1
+#define IL_STAT_RESULT 2
+#define IL_STAT_EXTRA  3
+
+/* Floating point. The F flag makes LOAD, STOR, ADD, SUB, MUL, DIV and
+ * the compares work on a 32-bit IEEE-754 float accumulator, kept apart
+ * from the 16-bit accumulator. Their operand is a pair of registers
+ * holding a float, high word first at the address, or low word first
+ * with the W flag as well. With I the operand is the value itself,
+ * converted to float. N negates the operand (or the stored value for
+ * STOR). Compares leave the float accumulator alone and set the 16-bit
+ * accumulator to 0 or 1, ready for JUMP_C. Division by zero gives an
+ * IEEE infinity or NaN. '{' works as for the integer forms.
+ *
+ * "ITOF" loads the float accumulator with the 16-bit accumulator.
+ * "FTOI" sets the 16-bit accumulator to the float accumulator rounded
+ * to the nearest integer and limited to 0 .. 65535 (NaN gives 0).
+ */
+
+/* Write observer. Called after a write to an address selected in the
+ * context's watch map, with the stored values before and after.
+ */
+typedef void (*il_write_observer)(void *user, uint16_t addr, uint16_t old, uint16_t val);
+
+typedef struct{
+	il_memory_callbacks *mem;  // caller's memory callbacks
+	il_memory_image *image;    // flat memory image. Used instead of mem if set
+	uint16_t accum;
+	float faccum;              // float accumulator for the F forms
+
+	/* Delayed evaluation stack for '{' and '}' */
+	struct{
+		uint16_t command;
+		uint16_t accum;
+		float faccum;
+	} eval_stack[IL_EVAL_STACK_MAX_DEPTH];
+	int eval_stack_top;
+
+	/* Call stack for CALL and RET */
+	uint16_t call_stack[IL_CALL_STACK_MAX_DEPTH];
+	int call_stack_top;
+
+	/* Write watch - one bit per address, NULL when nothing is watched */
+	const uint8_t *watch_map;
+	il_write_observer observer;
+	void *observer_user;
+} il_context;
+
 /* Initialise the interpreter with callbacks to 
  * allow the interpreter to manipulate the caller's
  * memory image.
@@ -60,7 +261,7 @@ void il_interp_init(il_memory_callbacks *cb);
 
 
 /* Parse a command string to a 16-bit command code 
- * (actual encoding is private to il_interpreter.c)
+ * (actual encoding is in the private header il_opcodes.h)
  * 
  * @param - command string representing the command.
  * @return - 16-bit internal representaiton of the command
@@ -68,11 +269,22 @@ void il_interp_init(il_memory_callbacks *cb);
 uint16_t il_interp_parse(char * command);
 
 
+/* Write the mnemonic of a command code - the inverse of
+ * il_interp_parse(). Flags follow an '_' in the order C N I F W {,
+ * matching the demo's command menu. NOP is "_".
+ *
+ * @param cmd  - 16-bit command code
+ * @param buf  - buffer for the mnemonic
+ * @param size - size of buf (16 is always enough)
+ * @return - buf
+ */
+char * il_interp_mnemonic(uint16_t cmd, char *buf, size_t size);
+
 /* Execute a line of the program, update the machine state 
  * and return the next line to execute.
  * 
  * @param - cmd   - The command code to execute 
- *                    (codes are private to il_interpreter.c)
+ *                    (codes are in the private header il_opcodes.h)
  * @param - value - The Value parameter associated with the command
  * @param - line  - The current line number (for relative jumps)
  *
@@ -86,6 +298,71 @@ uint16_t il_interp_execute(uint16_t cmd, uint16_t value, uint16_t line);
  */
 uint16_t il_interp_get_accum(void);
 
+/* Context versions of the interface functions. The functions
+ * above operate on a single built-in context.
+ */
+
+/* Initialise an interpreter context with memory callbacks
+ *
+ * @param ctx - the context to initialise
+ * @param cb  - structure with the caller's set() and get()
+ *              memory access functions
+ */
+void il_interp_ctx_init(il_context *ctx, il_memory_callbacks *cb);
+
+/* Initialise an interpreter context operating directly on 
+ * a flat memory image (no callbacks)
+ *
+ * @param ctx   - the context to initialise
+ * @param image - the memory image for this context
+ */
+void il_interp_ctx_init_image(il_context *ctx, il_memory_image *image);
+
+/* Execute a line of the program in a context.
+ * See il_interp_execute()
+ */
+uint16_t il_interp_ctx_execute(il_context *ctx, uint16_t cmd, uint16_t value, uint16_t line);
+
+/* Get the 16-bit accumulator value of a context
+ *
+ * @return - the current accumulator value
+ */
+uint16_t il_interp_ctx_get_accum(const il_context *ctx);
+
+/* Get the float accumulator value of a context
+ *
+ * @return - the current float accumulator value
+ */
+float il_interp_ctx_get_faccum(const il_context *ctx);
+
+/* Read a memory address of a context (for debug)
+ *
+ * @param ctx  - the interpreter context
+ * @param addr - the modbus style address
+ * @return - the stored value
+ */
+uint16_t il_interp_ctx_peek(il_context *ctx, uint16_t addr);
+
+/* Write a memory address of a context, bypassing any write watch
+ * (for debug tools restoring memory)
+ *
+ * @param ctx   - the interpreter context
+ * @param addr  - the modbus style address
+ * @param value - the value to store
+ */
+void il_interp_ctx_poke(il_context *ctx, uint16_t addr, uint16_t value);
+
+/* Watch writes to memory. Only writes to addresses whose bit is set
+ * in map (bit addr%8 of byte addr/8) call the observer, so unwatched
+ * writes cost one test of the map pointer.
+ *
+ * @param ctx      - the interpreter context
+ * @param map      - 8192 byte bitmap of watched addresses, NULL to stop watching
+ * @param observer - function called after each watched write
+ * @param user     - passed to observer
+ */
+void il_interp_ctx_watch(il_context *ctx, const uint8_t *map, il_write_observer observer, void *user);
+
 
 
 #endif /* IL_INTERPRETER_H_ */
@@ -0,0 +1,155 @@
+/*
+ * il_listing.c
+ *
+ * Text listings of IL programs and memory.
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include "il_listing.h"
+
+/* Cursor over the text being parsed */
+typedef struct{
+	const char *p;
+	const char *end;
+	size_t line;
+} cursor;
+
+static bool is_space(char c){
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static void skip_space(cursor *c){
+	while(c->p < c->end && is_space(*c->p)) c->p++;
+}
+
+/* At the end of a text line (or a comment)? */
+static bool at_eol(cursor *c){
+	return c->p >= c->end || *c->p == '\n' || *c->p == ';';
+}
+
+/* Move to the start of the next text line */
+static void next_line(cursor *c){
+	while(c->p < c->end && *c->p != '\n') c->p++;
+	if(c->p < c->end) c->p++;
+	c->line++;
+}
+
+/* Read a decimal number up to 65535 */
+static bool number(cursor *c, uint16_t *value){
+	uint32_t v = 0;
+	const char * start = c->p;
+	while(c->p < c->end && *c->p >= '0' && *c->p <= '9'){
+		v = v * 10 + (*c->p++ - '0');
+		if(v > 65535) return false;
+	}
+	*value = (uint16_t)v;
+	return c->p > start;
+}
+
+/* Rest of the line must be blank or a comment */
+static bool line_done(cursor *c){
+	skip_space(c);
+	return at_eol(c);
+}
+
+/********************************************
+ * Interface functions
+ ********************************************/
+
+/* Parse a program listing */
+long il_listing_parse(const char *text, size_t len, il_line *program, size_t max, size_t *error_line){
+	cursor c = { text, text + len, 1 };
+	size_t n = 0;
+
+	for(; c.p < c.end; next_line(&c)){
+		char token[16], check[16];
+		size_t t = 0;
+		uint16_t cmd, value = 0;
+
+		skip_space(&c);
+		if(at_eol(&c)) continue;
+
+		while(c.p < c.end && !is_space(*c.p) && *c.p != '\n' && *c.p != ';'){
+			if(t == sizeof(token) - 1) goto error;
+			token[t++] = *c.p++;
+		}
+		token[t] = 0;
+		// Only accept the exact spelling il_interp_mnemonic() gives
+		cmd = il_interp_parse(token);
+		if(strcmp(il_interp_mnemonic(cmd, check, sizeof(check)), token)) goto error;
+
+		skip_space(&c);
+		if(!at_eol(&c) && !number(&c, &value)) goto error;
+		if(!line_done(&c) || n == max) goto error;
+
+		program[n].cmd = cmd;
+		program[n].value = value;
+		n++;
+	}
+	return (long)n;
+
+error:
+	if(error_line) *error_line = c.line;
+	return -1;
+}
+
+/* Write a program listing */
+size_t il_listing_format(const il_line *program, size_t lines, char *buf, size_t size){
+	size_t i, total = 0;
+	for(i = 0; i < lines; i++){
+		char text[32], name[16];
+		int n = sprintf(text, "%s %u\n", il_interp_mnemonic(program[i].cmd, name, sizeof(name)),
+				program[i].value);
+		if(buf && total + n < size) memcpy(buf + total, text, n);
+		total += n;
+	}
+	if(buf && size) buf[total < size ? total : size - 1] = 0;
+	return total;
+}
+
+/* Parse a memory listing */
+long il_listing_parse_memory(const char *text, size_t len, uint16_t *addr, uint16_t *value,
+		size_t max, size_t *error_line){
+	cursor c = { text, text + len, 1 };
+	size_t n = 0;
+
+	for(; c.p < c.end; next_line(&c)){
+		skip_space(&c);
+		if(at_eol(&c)) continue;
+		if(n == max || !number(&c, &addr[n])) goto error;
+		skip_space(&c);
+		if(!number(&c, &value[n]) || !line_done(&c)) goto error;
+		n++;
+	}
+	return (long)n;
+
+error:
+	if(error_line) *error_line = c.line;
+	return -1;
+}
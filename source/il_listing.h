@@ -0,0 +1,90 @@
+/*
+ * il_listing.h
+ *
+ * Text listings of IL programs and memory, for saving and loading.
+ *
+ * Program listing - one program line per text line:
+ *
+ *     MNEMONIC [VALUE]    ; comment
+ *
+ *   MNEMONIC is as in the demo's command menu (see il_interp_mnemonic()),
+ *   "_" for an empty line. VALUE is decimal, 0 if left out. Lines that
+ *   are blank or hold only a comment are not program lines.
+ *
+ * Memory listing - one register per text line:
+ *
+ *     ADDRESS VALUE       ; e.g. "40001 1234" or "00003 1"
+ *
+ * Parsing is a single pass over the text straight into arrays, so
+ * even very long listings load at once.
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+
+#ifndef IL_LISTING_H_
+#define IL_LISTING_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "il_unit.h"
+
+/* Parse a program listing
+ *
+ * @param text       - the listing (need not be 0 terminated)
+ * @param len        - length of text
+ * @param program    - array for the parsed lines
+ * @param max        - size of program
+ * @param error_line - set to the text line (from 1) of an error
+ * @return - number of program lines, or -1 on an unknown mnemonic,
+ *           bad value or more than max lines
+ */
+long il_listing_parse(const char *text, size_t len, il_line *program, size_t max, size_t *error_line);
+
+/* Write a program listing
+ *
+ * @param program - the program
+ * @param lines   - number of lines
+ * @param buf     - buffer for the text (may be NULL to measure)
+ * @param size    - size of buf
+ * @return - length of the whole listing. Only complete if less than size.
+ */
+size_t il_listing_format(const il_line *program, size_t lines, char *buf, size_t size);
+
+/* Parse a memory listing
+ *
+ * @param text       - the listing
+ * @param len        - length of text
+ * @param addr       - array for the addresses
+ * @param value      - array for the values
+ * @param max        - size of addr and value
+ * @param error_line - set to the text line (from 1) of an error
+ * @return - number of registers, or -1 on a bad line or more than max
+ */
+long il_listing_parse_memory(const char *text, size_t len, uint16_t *addr, uint16_t *value,
+		size_t max, size_t *error_line);
+
+#endif /* IL_LISTING_H_ */
@@ -0,0 +1,448 @@
+/*
+ * il_modbus_rtu.c
+ *
+ * Modbus RTU slave front-end over Linux pseudo-terminals.
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <termios.h>
+#include <unistd.h>
+#include "il_modbus_rtu.h"
+#include "il_shm_export.h"
+
+#define RTU_MAX_ADU   256    // largest RTU frame
+#define RTU_BITS_CHAR 11     // start + 8 data + parity/stop + stop
+
+/* Modbus exception codes */
+#define EXC_FUNCTION  1
+#define EXC_ADDRESS   2
+#define EXC_VALUE     3
+
+/* One serial line */
+typedef struct{
+	int fd;                    // pty master - our end
+	int slave_fd;              // kept open so the master never sees hangup
+	uint64_t char_ns;          // time of one character on the wire
+	uint64_t t35_ns;           // inter-frame silence
+	il_unit * slave[248];      // units by Modbus address
+
+	uint8_t rx[RTU_MAX_ADU];
+	size_t rxlen;
+	bool overflow;             // frame longer than RTU_MAX_ADU
+	uint64_t last_rx;          // time the last bytes arrived
+
+	uint8_t tx[RTU_MAX_ADU];
+	size_t txlen;              // pending reply
+	uint64_t tx_at;            // time the reply's last character is on the wire
+	uint64_t busy_until;       // end of our last transmission + t3.5
+
+	il_rtu_stats stats;
+} rtu_line;
+
+struct il_rtu{
+	int nlines;
+	rtu_line * line[IL_RTU_MAX_LINES];
+};
+
+/******************************************
+ * CRC-16 (Modbus), reflected polynomial 0xA001
+ ******************************************/
+/* CRC of each byte value (polynomial 0xA001, one byte shifted through) */
+static const uint16_t crc_table[256] = {
+	0x0000, 0xC0C1, 0xC181, 0x0140, 0xC301, 0x03C0, 0x0280, 0xC241,
+	0xC601, 0x06C0, 0x0780, 0xC741, 0x0500, 0xC5C1, 0xC481, 0x0440,
+	0xCC01, 0x0CC0, 0x0D80, 0xCD41, 0x0F00, 0xCFC1, 0xCE81, 0x0E40,
+	0x0A00, 0xCAC1, 0xCB81, 0x0B40, 0xC901, 0x09C0, 0x0880, 0xC841,
+	0xD801, 0x18C0, 0x1980, 0xD941, 0x1B00, 0xDBC1, 0xDA81, 0x1A40,
+	0x1E00, 0xDEC1, 0xDF81, 0x1F40, 0xDD01, 0x1DC0, 0x1C80, 0xDC41,
+	0x1400, 0xD4C1, 0xD581, 0x1540, 0xD701, 0x17C0, 0x1680, 0xD641,
+	0xD201, 0x12C0, 0x1380, 0xD341, 0x1100, 0xD1C1, 0xD081, 0x1040,
+	0xF001, 0x30C0, 0x3180, 0xF141, 0x3300, 0xF3C1, 0xF281, 0x3240,
+	0x3600, 0xF6C1, 0xF781, 0x3740, 0xF501, 0x35C0, 0x3480, 0xF441,
+	0x3C00, 0xFCC1, 0xFD81, 0x3D40, 0xFF01, 0x3FC0, 0x3E80, 0xFE41,
+	0xFA01, 0x3AC0, 0x3B80, 0xFB41, 0x3900, 0xF9C1, 0xF881, 0x3840,
+	0x2800, 0xE8C1, 0xE981, 0x2940, 0xEB01, 0x2BC0, 0x2A80, 0xEA41,
+	0xEE01, 0x2EC0, 0x2F80, 0xEF41, 0x2D00, 0xEDC1, 0xEC81, 0x2C40,
+	0xE401, 0x24C0, 0x2580, 0xE541, 0x2700, 0xE7C1, 0xE681, 0x2640,
+	0x2200, 0xE2C1, 0xE381, 0x2340, 0xE101, 0x21C0, 0x2080, 0xE041,
+	0xA001, 0x60C0, 0x6180, 0xA141, 0x6300, 0xA3C1, 0xA281, 0x6240,
+	0x6600, 0xA6C1, 0xA781, 0x6740, 0xA501, 0x65C0, 0x6480, 0xA441,
+	0x6C00, 0xACC1, 0xAD81, 0x6D40, 0xAF01, 0x6FC0, 0x6E80, 0xAE41,
+	0xAA01, 0x6AC0, 0x6B80, 0xAB41, 0x6900, 0xA9C1, 0xA881, 0x6840,
+	0x7800, 0xB8C1, 0xB981, 0x7940, 0xBB01, 0x7BC0, 0x7A80, 0xBA41,
+	0xBE01, 0x7EC0, 0x7F80, 0xBF41, 0x7D00, 0xBDC1, 0xBC81, 0x7C40,
+	0xB401, 0x74C0, 0x7580, 0xB541, 0x7700, 0xB7C1, 0xB681, 0x7640,
+	0x7200, 0xB2C1, 0xB381, 0x7340, 0xB101, 0x71C0, 0x7080, 0xB041,
+	0x5000, 0x90C1, 0x9181, 0x5140, 0x9301, 0x53C0, 0x5280, 0x9241,
+	0x9601, 0x56C0, 0x5780, 0x9741, 0x5500, 0x95C1, 0x9481, 0x5440,
+	0x9C01, 0x5CC0, 0x5D80, 0x9D41, 0x5F00, 0x9FC1, 0x9E81, 0x5E40,
+	0x5A00, 0x9AC1, 0x9B81, 0x5B40, 0x9901, 0x59C0, 0x5880, 0x9841,
+	0x8801, 0x48C0, 0x4980, 0x8941, 0x4B00, 0x8BC1, 0x8A81, 0x4A40,
+	0x4E00, 0x8EC1, 0x8F81, 0x4F40, 0x8D01, 0x4DC0, 0x4C80, 0x8C41,
+	0x4400, 0x84C1, 0x8581, 0x4540, 0x8701, 0x47C0, 0x4680, 0x8641,
+	0x8201, 0x42C0, 0x4380, 0x8341, 0x4100, 0x81C1, 0x8081, 0x4040
+};
+
+/* Modbus CRC-16 of a buffer */
+uint16_t il_rtu_crc(const uint8_t *data, size_t len){
+	uint16_t crc = 0xFFFF;
+	while(len--){
+		crc = (crc >> 8) ^ crc_table[(crc ^ *data++) & 0xFF];
+	}
+	return crc;
+}
+
+static uint64_t now_ns(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/******************************************
+ * Modbus functions
+ ******************************************/
+
+static uint16_t be16(const uint8_t *p){
+	return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static size_t exception(uint8_t fn, uint8_t code, uint8_t *resp){
+	resp[0] = fn | 0x80;
+	resp[1] = code;
+	return 2;
+}
+
+/* Check that a quantity is allowed and the range fits the image */
+static uint8_t check_range(uint16_t start, uint16_t qty, uint16_t max){
+	if(qty < 1 || qty > max) return EXC_VALUE;
+	if((uint32_t)start + qty > IL_IMAGE_BANK_SIZE) return EXC_ADDRESS;
+	return 0;
+}
+
+/* Execute a request PDU against a unit and build the reply PDU.
+ * Writes that change a register count as input changes for the
+ * unit's adaptive scan rate.
+ *
+ * @return - length of the reply PDU
+ */
+static size_t process_pdu(il_unit *u, const uint8_t *req, size_t len, uint8_t *resp){
+	il_memory_image * img = u->ctx.image;
+	uint8_t fn = req[0], exc;
+	uint16_t start, qty, i;
+	int bank;
+
+	switch(fn){
+	case 1: case 2:   // read coils / discrete inputs
+		if(len != 5) return exception(fn, EXC_VALUE, resp);
+		start = be16(req + 1);
+		qty = be16(req + 3);
+		if((exc = check_range(start, qty, 2000))) return exception(fn, exc, resp);
+		bank = (fn == 1) ? IL_BANK_COIL : IL_BANK_INPUT;
+		resp[0] = fn;
+		resp[1] = (uint8_t)((qty + 7) / 8);
+		memset(resp + 2, 0, resp[1]);
+		for(i = 0; i < qty; i++){
+			if(img->bits[bank][start + i]) resp[2 + i/8] |= (uint8_t)(1 << (i % 8));
+		}
+		return 2 + resp[1];
+
+	case 3: case 4:   // read holding / input registers
+		if(len != 5) return exception(fn, EXC_VALUE, resp);
+		start = be16(req + 1);
+		qty = be16(req + 3);
+		if((exc = check_range(start, qty, 125))) return exception(fn, exc, resp);
+		bank = (fn == 3) ? IL_BANK_HREG : IL_BANK_IREG;
+		resp[0] = fn;
+		resp[1] = (uint8_t)(2 * qty);
+		for(i = 0; i < qty; i++){
+			uint16_t v = img->words[bank - 2][start + i];
+			resp[2 + 2*i] = (uint8_t)(v >> 8);
+			resp[3 + 2*i] = (uint8_t)v;
+		}
+		return 2 + resp[1];
+
+	case 5:           // write single coil
+		if(len != 5) return exception(fn, EXC_VALUE, resp);
+		start = be16(req + 1);
+		qty = be16(req + 3);
+		if(qty != 0xFF00 && qty != 0x0000) return exception(fn, EXC_VALUE, resp);
+		if(start >= IL_IMAGE_BANK_SIZE) return exception(fn, EXC_ADDRESS, resp);
+		u->input_changes += (img->bits[IL_BANK_COIL][start] != (qty != 0));
+		img->bits[IL_BANK_COIL][start] = (qty != 0);
+		if(u->shm) il_shm_export_publish(u->shm, IL_SHM_BANK(IL_BANK_COIL), false);
+		memcpy(resp, req, 5);
+		return 5;
+
+	case 6:           // write single register
+		if(len != 5) return exception(fn, EXC_VALUE, resp);
+		start = be16(req + 1);
+		if(start >= IL_IMAGE_BANK_SIZE) return exception(fn, EXC_ADDRESS, resp);
+		u->input_changes += (img->words[IL_BANK_HREG - 2][start] != be16(req + 3));
+		img->words[IL_BANK_HREG - 2][start] = be16(req + 3);
+		if(u->shm) il_shm_export_publish(u->shm, IL_SHM_BANK(IL_BANK_HREG), false);
+		memcpy(resp, req, 5);
+		return 5;
+
+	case 15:          // write multiple coils
+		if(len < 6) return exception(fn, EXC_VALUE, resp);
+		start = be16(req + 1);
+		qty = be16(req + 3);
+		if((exc = check_range(start, qty, 1968))) return exception(fn, exc, resp);
+		if(req[5] != (qty + 7) / 8 || len != 6u + req[5]) return exception(fn, EXC_VALUE, resp);
+		for(i = 0; i < qty; i++){
+			uint8_t v = (req[6 + i/8] >> (i % 8)) & 1;
+			u->input_changes += (img->bits[IL_BANK_COIL][start + i] != v);
+			img->bits[IL_BANK_COIL][start + i] = v;
+		}
+		if(u->shm) il_shm_export_publish(u->shm, IL_SHM_BANK(IL_BANK_COIL), false);
+		memcpy(resp, req, 5);
+		return 5;
+
+	case 16:          // write multiple registers
+		if(len < 6) return exception(fn, EXC_VALUE, resp);
+		start = be16(req + 1);
+		qty = be16(req + 3);
+		if((exc = check_range(start, qty, 123))) return exception(fn, exc, resp);
+		if(req[5] != 2 * qty || len != 6u + req[5]) return exception(fn, EXC_VALUE, resp);
+		for(i = 0; i < qty; i++){
+			uint16_t v = be16(req + 6 + 2*i);
+			u->input_changes += (img->words[IL_BANK_HREG - 2][start + i] != v);
+			img->words[IL_BANK_HREG - 2][start + i] = v;
+		}
+		if(u->shm) il_shm_export_publish(u->shm, IL_SHM_BANK(IL_BANK_HREG), false);
+		memcpy(resp, req, 5);
+		return 5;
+	}
+	return exception(fn, EXC_FUNCTION, resp);
+}
+
+/* A complete frame has been received - check it and queue the reply
+ *
+ * @return - 1 if a reply was queued, else 0
+ */
+static int handle_frame(rtu_line *l, uint64_t now){
+	size_t len = l->rxlen, plen;
+	uint16_t crc;
+	il_unit * u;
+
+	if(l->overflow || len < 4){
+		l->stats.short_frames++;
+		return 0;
+	}
+	crc = il_rtu_crc(l->rx, len - 2);
+	if(l->rx[len-2] != (uint8_t)crc || l->rx[len-1] != (uint8_t)(crc >> 8)){
+		l->stats.crc_errors++;
+		return 0;
+	}
+	if(l->rx[0] == 0){
+		/* broadcast - every unit on the line executes writes, no reply */
+		uint8_t scratch[RTU_MAX_ADU];
+		int a;
+		l->stats.broadcasts++;
+		if(l->rx[1] == 5 || l->rx[1] == 6 || l->rx[1] == 15 || l->rx[1] == 16){
+			for(a = 1; a < 248; a++){
+				if(l->slave[a]) process_pdu(l->slave[a], l->rx + 1, len - 3, scratch);
+			}
+		}
+		return 0;
+	}
+	u = (l->rx[0] < 248) ? l->slave[l->rx[0]] : NULL;
+	if(!u){
+		l->stats.ignored++;   // another device on the line
+		return 0;
+	}
+	l->stats.frames++;
+	l->tx[0] = l->rx[0];
+	plen = process_pdu(u, l->rx + 1, len - 3, l->tx + 1);
+	if(l->tx[1] & 0x80) l->stats.exceptions++;
+	crc = il_rtu_crc(l->tx, plen + 1);
+	l->tx[plen + 1] = (uint8_t)crc;
+	l->tx[plen + 2] = (uint8_t)(crc >> 8);
+	l->txlen = plen + 3;
+	/* t3.5 of silence has already passed since the request ended. The
+	 * reply starts now (or when the line is free) and is handed over
+	 * once its own time on the wire has passed, as it would arrive
+	 * complete at the master on a real line. */
+	l->tx_at = ((now > l->busy_until) ? now : l->busy_until) + l->txlen * l->char_ns;
+	return 1;
+}
+
+/* Send a pending reply whose time on the wire has passed, and keep
+ * the line quiet for t3.5 after it */
+static void transmit(rtu_line *l, uint64_t now){
+	size_t done = 0;
+	while(done < l->txlen){
+		ssize_t n = write(l->fd, l->tx + done, l->txlen - done);
+		if(n < 0){
+			if(errno == EINTR) continue;
+			break;   // master not reading - drop the reply
+		}
+		done += n;
+	}
+	l->stats.tx_bytes += done;
+	l->busy_until = now + l->t35_ns;
+	l->txlen = 0;
+}
+
+/* Handle frames whose silence time has passed and replies that are due */
+static int service(il_rtu *rtu, uint64_t now){
+	int i, answered = 0;
+	for(i = 0; i < rtu->nlines; i++){
+		rtu_line * l = rtu->line[i];
+		if(l->rxlen && now - l->last_rx >= l->t35_ns){
+			answered += handle_frame(l, now);
+			l->rxlen = 0;
+			l->overflow = false;
+		}
+		if(l->txlen && now >= l->tx_at) transmit(l, now);
+	}
+	return answered;
+}
+
+/******************************************
+ * Interface functions
+ ******************************************/
+
+/* Create an RTU server with no lines */
+il_rtu * il_rtu_create(void){
+	return calloc(1, sizeof(il_rtu));
+}
+
+/* Add a serial line - a new pseudo-terminal */
+int il_rtu_add_line(il_rtu *rtu, uint32_t baud, char *path, size_t len){
+	rtu_line * l;
+	struct termios tio;
+	const char * name;
+
+	if(rtu->nlines >= IL_RTU_MAX_LINES || baud == 0) return -1;
+	l = calloc(1, sizeof(*l));
+	if(!l) return -1;
+	l->fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if(l->fd < 0 || grantpt(l->fd) != 0 || unlockpt(l->fd) != 0 ||
+	   !(name = ptsname(l->fd)) || strlen(name) >= len){
+		if(l->fd >= 0) close(l->fd);
+		free(l);
+		return -1;
+	}
+	strcpy(path, name);
+	l->slave_fd = open(name, O_RDWR | O_NOCTTY);
+	if(l->slave_fd >= 0 && tcgetattr(l->slave_fd, &tio) == 0){
+		cfmakeraw(&tio);
+		tcsetattr(l->slave_fd, TCSANOW, &tio);
+	}
+
+	l->stats.baud = baud;
+	l->char_ns = (uint64_t)RTU_BITS_CHAR * 1000000000ULL / baud;
+	/* Modbus fixes t3.5 at 1.75 ms above 19200 baud */
+	l->t35_ns = (baud > 19200) ? 1750000ULL : l->char_ns * 7 / 2;
+	rtu->line[rtu->nlines] = l;
+	return rtu->nlines++;
+}
+
+/* Attach a unit to a line at a Modbus unit address */
+bool il_rtu_add_slave(il_rtu *rtu, int line, uint8_t address, il_unit *unit){
+	if(line < 0 || line >= rtu->nlines || address < 1 || address > 247) return false;
+	rtu->line[line]->slave[address] = unit;
+	return true;
+}
+
+/* Serve all lines until timeout_ms passes */
+int il_rtu_poll(il_rtu *rtu, int timeout_ms){
+	struct pollfd pfd[IL_RTU_MAX_LINES];
+	uint64_t end = now_ns() + (uint64_t)(timeout_ms > 0 ? timeout_ms : 0) * 1000000ULL;
+	int i, answered = 0;
+
+	for(i = 0; i < rtu->nlines; i++){
+		pfd[i].fd = rtu->line[i]->fd;
+		pfd[i].events = POLLIN;
+	}
+	for(;;){
+		uint64_t now = now_ns(), next = end;
+		struct timespec ts;
+
+		answered += service(rtu, now);
+
+		/* Sleep until the next frame end, reply or the timeout */
+		for(i = 0; i < rtu->nlines; i++){
+			rtu_line * l = rtu->line[i];
+			if(l->rxlen && l->last_rx + l->t35_ns < next) next = l->last_rx + l->t35_ns;
+			if(l->txlen && l->tx_at < next) next = l->tx_at;
+		}
+		next = (next > now) ? next - now : 0;
+		ts.tv_sec = next / 1000000000ULL;
+		ts.tv_nsec = next % 1000000000ULL;
+		if(ppoll(pfd, rtu->nlines, &ts, NULL) > 0){
+			for(i = 0; i < rtu->nlines; i++){
+				rtu_line * l = rtu->line[i];
+				ssize_t n;
+				if(!(pfd[i].revents & POLLIN)) continue;
+				if(l->rxlen == RTU_MAX_ADU){
+					l->overflow = true;
+					l->rxlen = 0;
+				}
+				n = read(l->fd, l->rx + l->rxlen, RTU_MAX_ADU - l->rxlen);
+				if(n > 0){
+					l->rxlen += n;
+					l->stats.rx_bytes += n;
+					l->last_rx = now_ns();
+				}
+			}
+		}
+		if(now_ns() >= end){
+			answered += service(rtu, now_ns());
+			break;
+		}
+	}
+	return answered;
+}
+
+/* Get the statistics of a line */
+void il_rtu_get_stats(const il_rtu *rtu, int line, il_rtu_stats *stats){
+	if(line < 0 || line >= rtu->nlines){
+		memset(stats, 0, sizeof(*stats));
+		return;
+	}
+	*stats = rtu->line[line]->stats;
+}
+
+/* Close all lines and release the server */
+void il_rtu_destroy(il_rtu *rtu){
+	int i;
+	if(!rtu) return;
+	for(i = 0; i < rtu->nlines; i++){
+		close(rtu->line[i]->fd);
+		if(rtu->line[i]->slave_fd >= 0) close(rtu->line[i]->slave_fd);
+		free(rtu->line[i]);
+	}
+	free(rtu);
+}
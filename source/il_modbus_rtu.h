@@ -0,0 +1,127 @@
+/*
+ * il_modbus_rtu.h
+ *
+ * Modbus RTU slave front-end serving simulated units over Linux
+ * pseudo-terminals, for soak testing SCADA masters against many
+ * units without hardware.
+ *
+ * Each serial line is one pseudo-terminal. The master opens the
+ * slave side (the path returned by il_rtu_add_line()) as if it were
+ * a serial port. Any number of units may share a line (multi-drop),
+ * each with its own Modbus unit address. Frames are delimited by
+ * 3.5 character times of silence. A reply is written to the
+ * pseudo-terminal in one piece once its own length has passed on the
+ * wire at the line's baud rate, so a master sees each reply complete
+ * at the time its last character would arrive on a real line, and
+ * consecutive replies are spaced by their wire time plus t3.5. The
+ * bytes within a reply are not spaced out. All lines are served from
+ * one thread by il_rtu_poll().
+ *
+ * Supported functions, with Modbus address n = register n+1:
+ *   01 read coils            0xxxx     05 write single coil      0xxxx
+ *   02 read discrete inputs  1xxxx     06 write single register  4xxxx
+ *   03 read holding regs     4xxxx     15 write multiple coils   0xxxx
+ *   04 read input regs       3xxxx     16 write multiple regs    4xxxx
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+
+#ifndef IL_MODBUS_RTU_H_
+#define IL_MODBUS_RTU_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "il_unit.h"
+
+#define IL_RTU_MAX_LINES 64
+
+/* Statistics of one line */
+typedef struct{
+	uint32_t baud;
+	uint64_t frames;         // frames addressed to one of our units
+	uint64_t broadcasts;     // frames to address 0
+	uint64_t ignored;        // frames for other addresses
+	uint64_t crc_errors;
+	uint64_t short_frames;   // too short to hold address, function and CRC
+	uint64_t exceptions;     // exception responses sent
+	uint64_t tx_bytes;
+	uint64_t rx_bytes;
+} il_rtu_stats;
+
+typedef struct il_rtu il_rtu;
+
+/* Create an RTU server with no lines
+ *
+ * @return - the server, or NULL if out of memory
+ */
+il_rtu * il_rtu_create(void);
+
+/* Add a serial line - a new pseudo-terminal
+ *
+ * @param rtu  - the server
+ * @param baud - the emulated baud rate (8 data bits, parity/stop = 11 bits per char)
+ * @param path - buffer for the slave device path the master should open
+ * @param len  - size of path
+ * @return - line number, or -1 on failure
+ */
+int il_rtu_add_line(il_rtu *rtu, uint32_t baud, char *path, size_t len);
+
+/* Attach a unit to a line at a Modbus unit address
+ *
+ * @param rtu     - the server
+ * @param line    - line number from il_rtu_add_line()
+ * @param address - unit address 1 .. 247
+ * @param unit    - the unit to serve
+ * @return - true if attached
+ */
+bool il_rtu_add_slave(il_rtu *rtu, int line, uint8_t address, il_unit *unit);
+
+/* Serve all lines until timeout_ms passes. Units are accessed from
+ * the calling thread, so call this between scans.
+ *
+ * @param rtu        - the server
+ * @param timeout_ms - how long to serve (0 = just what is pending)
+ * @return - number of frames answered
+ */
+int il_rtu_poll(il_rtu *rtu, int timeout_ms);
+
+/* Get the statistics of a line */
+void il_rtu_get_stats(const il_rtu *rtu, int line, il_rtu_stats *stats);
+
+/* Close all lines and release the server */
+void il_rtu_destroy(il_rtu *rtu);
+
+/* Modbus CRC-16 of a buffer (table driven)
+ *
+ * @param data - the bytes
+ * @param len  - number of bytes
+ * @return - the CRC, low byte is sent first
+ */
+uint16_t il_rtu_crc(const uint8_t *data, size_t len);
+
+#endif /* IL_MODBUS_RTU_H_ */
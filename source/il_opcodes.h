@@ -0,0 +1,88 @@
+/*
+ * il_opcodes.h
+ *
+ * Internal encoding of the 16-bit command codes returned by
+ * il_interp_parse(). Shared by the interpreter and the compiler
+ * only - hosts treat command codes as opaque.
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+
+#ifndef IL_OPCODES_H_
+#define IL_OPCODES_H_
+
+#include "il_interpreter.h"
+
+/* Command is represented as a 16-bit value 
+ * bits 0-7 contain the command code. 
+ * bits 8-15 contain flag bits (currently 10-15 used).
+ */
+#define CMD_LOAD 1
+#define CMD_STOR 2
+#define CMD_SET  3
+#define CMD_RST  4
+#define CMD_AND  5
+#define CMD_OR   6
+#define CMD_XOR  7
+#define CMD_ADD  8
+#define CMD_SUB  9
+#define CMD_MUL  10
+#define CMD_DIV  11
+#define CMD_GT   12
+#define CMD_GE   13
+#define CMD_EQ   14
+#define CMD_NE   15
+#define CMD_LE   16
+#define CMD_LT   17
+#define CMD_JMP  18
+#define CMD_CAL  19
+#define CMD_RET  20
+#define CMD_PAR  21   // '}' - Closing Parenthesis for sub-calculation
+#define CMD_SEQ  22   // step sequencer
+#define CMD_ALM  23   // alarm evaluation
+#define CMD_ALB  24   // block alarm evaluation
+#define CMD_PSH  25   // ring buffer push
+#define CMD_POP  26   // ring buffer pop
+#define CMD_PEK  27   // ring buffer peek
+#define CMD_SUM  28   // block sum
+#define CMD_MIN  29   // block minimum
+#define CMD_MAX  30   // block maximum
+#define CMD_AVG  31   // block mean
+#define CMD_ITF  32   // integer accumulator to float
+#define CMD_FTI  33   // float accumulator to integer
+#define CMD_TRP  IL_INTERP_CMD_TRAP  // debugger breakpoint
+#define CMD_NOP  0
+#define CMD_MASK 0x00FF
+
+#define FLG_FLT 0x0400  // 'F' - Float register pair / float accumulator
+#define FLG_SWP 0x0800  // 'W' - Float pair with the low word first
+#define FLG_IMM 0x1000  // 'I' - Immediate value flag
+#define FLG_NEG 0x2000  // 'N' - Negate
+#define FLG_CND 0x4000  // 'C' - Conditional for branch and call
+#define FLG_PAR 0x8000  // '{' - Begin sub-calculation 
+
+#endif /* IL_OPCODES_H_ */
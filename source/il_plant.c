@@ -0,0 +1,360 @@
+/*
+ * il_plant.c
+ *
+ * Batched process models stepped between scans.
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "il_plant.h"
+#include "il_image.h"
+
+#define PUMP_RUNNING 0.1f   // fraction of rated flow that counts as running
+
+/* Each kind is a set of parallel arrays, one element per model.
+ * The float arrays are what the step loops work on. */
+typedef struct{
+	uint32_t count;
+	il_unit ** unit;
+	uint16_t * run_addr;
+	uint16_t * flow_addr;
+	uint16_t * running_addr;
+	float * rated;
+	float * ramp;
+	float * run;         // gathered command, 0 or 1
+	float * flow;        // state
+} pump_set;
+
+typedef struct{
+	uint32_t count;
+	il_unit ** unit;
+	uint16_t * command_addr;
+	uint16_t * position_addr;
+	uint16_t * open_addr;
+	uint16_t * closed_addr;
+	uint16_t * flow_addr;
+	float * command_full;
+	float * rate;        // travel per second, 1 / stroke
+	float * position_full;
+	float * max_flow;
+	float * command;     // gathered command, raw counts
+	float * position;    // state, 0 .. 1
+} valve_set;
+
+typedef struct{
+	uint32_t count;
+	il_unit ** unit;
+	uint16_t * port_addr[2 * IL_PLANT_TANK_PORTS];   // inflows, then outflows
+	uint16_t * output_addr;
+	uint16_t * high_addr;
+	uint16_t * low_addr;
+	float * gain;
+	float * max_level;
+	float * high_level;
+	float * low_level;
+	float * net;         // gathered inflow less outflow
+	float * level;       // state
+} tank_set;
+
+typedef struct{
+	uint32_t count;
+	il_unit ** unit;
+	uint16_t * input_addr;
+	uint16_t * output_addr;
+	float * gain;
+	float * bias;
+	float * tau;
+	float * input;       // gathered input
+	float * output;      // state
+} lag_set;
+
+struct il_plant{
+	uint32_t capacity;
+	pump_set pump;
+	valve_set valve;
+	tank_set tank;
+	lag_set lag;
+	void ** arrays[64];  // every array allocated, for il_plant_destroy()
+	int narrays;
+};
+
+/* Allocate one array of a set */
+static bool alloc_array(il_plant *p, void *array, size_t size){
+	void ** a = array;
+	*a = calloc(p->capacity, size);
+	if(!*a) return false;
+	p->arrays[p->narrays++] = a;
+	return true;
+}
+
+#define ALLOC(p, a) alloc_array(p, &(a), sizeof(*(a)))
+
+static bool alloc_sets(il_plant *p){
+	int i;
+	bool ok = ALLOC(p, p->pump.unit) && ALLOC(p, p->pump.run_addr) && ALLOC(p, p->pump.flow_addr)
+		&& ALLOC(p, p->pump.running_addr) && ALLOC(p, p->pump.rated) && ALLOC(p, p->pump.ramp)
+		&& ALLOC(p, p->pump.run) && ALLOC(p, p->pump.flow);
+	ok = ok && ALLOC(p, p->valve.unit) && ALLOC(p, p->valve.command_addr) && ALLOC(p, p->valve.position_addr)
+		&& ALLOC(p, p->valve.open_addr) && ALLOC(p, p->valve.closed_addr) && ALLOC(p, p->valve.flow_addr)
+		&& ALLOC(p, p->valve.command_full) && ALLOC(p, p->valve.rate) && ALLOC(p, p->valve.position_full)
+		&& ALLOC(p, p->valve.max_flow) && ALLOC(p, p->valve.command) && ALLOC(p, p->valve.position);
+	ok = ok && ALLOC(p, p->tank.unit) && ALLOC(p, p->tank.output_addr) && ALLOC(p, p->tank.high_addr)
+		&& ALLOC(p, p->tank.low_addr) && ALLOC(p, p->tank.gain) && ALLOC(p, p->tank.max_level)
+		&& ALLOC(p, p->tank.high_level) && ALLOC(p, p->tank.low_level) && ALLOC(p, p->tank.net)
+		&& ALLOC(p, p->tank.level);
+	for(i = 0; ok && i < 2 * IL_PLANT_TANK_PORTS; i++) ok = ALLOC(p, p->tank.port_addr[i]);
+	ok = ok && ALLOC(p, p->lag.unit) && ALLOC(p, p->lag.input_addr) && ALLOC(p, p->lag.output_addr)
+		&& ALLOC(p, p->lag.gain) && ALLOC(p, p->lag.bias) && ALLOC(p, p->lag.tau)
+		&& ALLOC(p, p->lag.input) && ALLOC(p, p->lag.output);
+	return ok;
+}
+
+/* Check a register address. 0 is allowed for optional registers. */
+static bool valid_addr(uint16_t addr, bool optional){
+	int bank, index;
+	if(addr == 0) return optional;
+	return il_image_decode(addr, &bank, &index);
+}
+
+static inline float clampf(float x, float lo, float hi){
+	return x < lo ? lo : (x > hi ? hi : x);
+}
+
+/* Write a state to an input register, rounded and limited to 0..65535 */
+static inline void put(il_unit *u, uint16_t addr, float x){
+	if(addr) il_unit_input(u, addr, (uint16_t)(clampf(x, 0.0f, 65535.0f) + 0.5f));
+}
+
+static inline void put_bit(il_unit *u, uint16_t addr, bool on){
+	if(addr) il_unit_input(u, addr, on ? 1 : 0);
+}
+
+/******************************************
+ * Stepping - gather, update, scatter
+ ******************************************/
+
+static void gather(il_plant *p){
+	uint32_t i;
+	int k;
+	for(i = 0; i < p->pump.count; i++){
+		p->pump.run[i] = il_image_get(p->pump.unit[i]->ctx.image, p->pump.run_addr[i], false) ? 1.0f : 0.0f;
+	}
+	for(i = 0; i < p->valve.count; i++){
+		p->valve.command[i] = il_image_get(p->valve.unit[i]->ctx.image, p->valve.command_addr[i], false);
+	}
+	for(i = 0; i < p->tank.count; i++){
+		const il_memory_image * img = p->tank.unit[i]->ctx.image;
+		float net = 0.0f;
+		for(k = 0; k < 2 * IL_PLANT_TANK_PORTS; k++){
+			uint16_t addr = p->tank.port_addr[k][i];
+			if(!addr) continue;
+			if(k < IL_PLANT_TANK_PORTS) net += il_image_get(img, addr, false);
+			else                        net -= il_image_get(img, addr, false);
+		}
+		p->tank.net[i] = net;
+	}
+	for(i = 0; i < p->lag.count; i++){
+		p->lag.input[i] = il_image_get(p->lag.unit[i]->ctx.image, p->lag.input_addr[i], false);
+	}
+}
+
+/* State updates. Branch free loops over the float arrays only.
+ * Lags and ramps use the backward Euler factor dt / (tau + dt),
+ * which is stable for any step. */
+static void update(il_plant *p, float dt){
+	uint32_t i, n;
+
+	n = p->pump.count;
+	for(i = 0; i < n; i++){
+		float target = p->pump.run[i] * p->pump.rated[i];
+		p->pump.flow[i] += (target - p->pump.flow[i]) * (dt / (p->pump.ramp[i] + dt));
+	}
+
+	n = p->valve.count;
+	for(i = 0; i < n; i++){
+		float target = clampf(p->valve.command[i] / p->valve.command_full[i], 0.0f, 1.0f);
+		float travel = p->valve.rate[i] * dt;
+		p->valve.position[i] += clampf(target - p->valve.position[i], -travel, travel);
+	}
+
+	n = p->tank.count;
+	for(i = 0; i < n; i++){
+		float level = p->tank.level[i] + p->tank.gain[i] * p->tank.net[i] * dt;
+		p->tank.level[i] = clampf(level, 0.0f, p->tank.max_level[i]);
+	}
+
+	n = p->lag.count;
+	for(i = 0; i < n; i++){
+		float target = p->lag.gain[i] * p->lag.input[i] + p->lag.bias[i];
+		p->lag.output[i] += (target - p->lag.output[i]) * (dt / (p->lag.tau[i] + dt));
+	}
+}
+
+static void scatter(il_plant *p){
+	uint32_t i;
+	for(i = 0; i < p->pump.count; i++){
+		il_unit * u = p->pump.unit[i];
+		put(u, p->pump.flow_addr[i], p->pump.flow[i]);
+		put_bit(u, p->pump.running_addr[i], p->pump.flow[i] > PUMP_RUNNING * p->pump.rated[i]);
+	}
+	for(i = 0; i < p->valve.count; i++){
+		il_unit * u = p->valve.unit[i];
+		float pos = p->valve.position[i];
+		put(u, p->valve.position_addr[i], pos * p->valve.position_full[i]);
+		put_bit(u, p->valve.open_addr[i], pos >= 1.0f);
+		put_bit(u, p->valve.closed_addr[i], pos <= 0.0f);
+		put(u, p->valve.flow_addr[i], pos * p->valve.max_flow[i]);
+	}
+	for(i = 0; i < p->tank.count; i++){
+		il_unit * u = p->tank.unit[i];
+		float level = p->tank.level[i];
+		put(u, p->tank.output_addr[i], level);
+		put_bit(u, p->tank.high_addr[i], level >= p->tank.high_level[i]);
+		put_bit(u, p->tank.low_addr[i], level <= p->tank.low_level[i]);
+	}
+	for(i = 0; i < p->lag.count; i++){
+		put(p->lag.unit[i], p->lag.output_addr[i], p->lag.output[i]);
+	}
+}
+
+/******************************************
+ * Interface functions
+ ******************************************/
+
+/* Create an empty plant */
+il_plant * il_plant_create(uint32_t capacity){
+	il_plant * p = calloc(1, sizeof(il_plant));
+	if(!p) return NULL;
+	p->capacity = capacity ? capacity : 1;
+	if(!alloc_sets(p)){
+		il_plant_destroy(p);
+		return NULL;
+	}
+	return p;
+}
+
+/* Add a pump */
+int32_t il_plant_add_pump(il_plant *p, il_unit *unit, const il_pump *m){
+	uint32_t i = p->pump.count;
+	if(i >= p->capacity || !valid_addr(m->run, false) || !valid_addr(m->flow, false)
+			|| !valid_addr(m->running, true) || m->ramp < 0.0f) return -1;
+	p->pump.unit[i] = unit;
+	p->pump.run_addr[i] = m->run;
+	p->pump.flow_addr[i] = m->flow;
+	p->pump.running_addr[i] = m->running;
+	p->pump.rated[i] = m->rated;
+	p->pump.ramp[i] = m->ramp;
+	p->pump.flow[i] = 0.0f;
+	return p->pump.count++;
+}
+
+/* Add a valve */
+int32_t il_plant_add_valve(il_plant *p, il_unit *unit, const il_valve *m){
+	uint32_t i = p->valve.count;
+	if(i >= p->capacity || !valid_addr(m->command, false) || !valid_addr(m->position, true)
+			|| !valid_addr(m->open, true) || !valid_addr(m->closed, true) || !valid_addr(m->flow, true)
+			|| m->command_full <= 0.0f || m->stroke < 0.0f) return -1;
+	p->valve.unit[i] = unit;
+	p->valve.command_addr[i] = m->command;
+	p->valve.position_addr[i] = m->position;
+	p->valve.open_addr[i] = m->open;
+	p->valve.closed_addr[i] = m->closed;
+	p->valve.flow_addr[i] = m->flow;
+	p->valve.command_full[i] = m->command_full;
+	p->valve.rate[i] = m->stroke > 0.0f ? 1.0f / m->stroke : 1e30f;
+	p->valve.position_full[i] = m->position_full;
+	p->valve.max_flow[i] = m->max_flow;
+	p->valve.position[i] = 0.0f;
+	return p->valve.count++;
+}
+
+/* Add a tank */
+int32_t il_plant_add_tank(il_plant *p, il_unit *unit, const il_tank *m){
+	uint32_t i = p->tank.count;
+	int k;
+	if(i >= p->capacity || !valid_addr(m->output, false) || !valid_addr(m->high, true)
+			|| !valid_addr(m->low, true) || m->max_level < 0.0f) return -1;
+	for(k = 0; k < IL_PLANT_TANK_PORTS; k++){
+		if(!valid_addr(m->inflow[k], true) || !valid_addr(m->outflow[k], true)) return -1;
+	}
+	p->tank.unit[i] = unit;
+	for(k = 0; k < IL_PLANT_TANK_PORTS; k++){
+		p->tank.port_addr[k][i] = m->inflow[k];
+		p->tank.port_addr[IL_PLANT_TANK_PORTS + k][i] = m->outflow[k];
+	}
+	p->tank.output_addr[i] = m->output;
+	p->tank.high_addr[i] = m->high;
+	p->tank.low_addr[i] = m->low;
+	p->tank.gain[i] = m->gain;
+	p->tank.max_level[i] = m->max_level;
+	p->tank.high_level[i] = m->high_level;
+	p->tank.low_level[i] = m->low_level;
+	p->tank.level[i] = clampf(m->level, 0.0f, m->max_level);
+	return p->tank.count++;
+}
+
+/* Add a first-order lag */
+int32_t il_plant_add_lag(il_plant *p, il_unit *unit, const il_lag *m){
+	uint32_t i = p->lag.count;
+	if(i >= p->capacity || !valid_addr(m->input, false) || !valid_addr(m->output, false)
+			|| m->tau < 0.0f) return -1;
+	p->lag.unit[i] = unit;
+	p->lag.input_addr[i] = m->input;
+	p->lag.output_addr[i] = m->output;
+	p->lag.gain[i] = m->gain;
+	p->lag.bias[i] = m->bias;
+	p->lag.tau[i] = m->tau;
+	p->lag.output[i] = m->initial;
+	return p->lag.count++;
+}
+
+/* Step every model */
+void il_plant_step(il_plant *p, float dt){
+	if(dt <= 0.0f) return;
+	gather(p);
+	update(p, dt);
+	scatter(p);
+}
+
+/* Get the state of a model */
+float il_plant_state(const il_plant *p, int kind, uint32_t index){
+	switch(kind){
+	case IL_PLANT_PUMP:  return index < p->pump.count ? p->pump.flow[index] : 0.0f;
+	case IL_PLANT_VALVE: return index < p->valve.count ? p->valve.position[index] : 0.0f;
+	case IL_PLANT_TANK:  return index < p->tank.count ? p->tank.level[index] : 0.0f;
+	case IL_PLANT_LAG:   return index < p->lag.count ? p->lag.output[index] : 0.0f;
+	default: return 0.0f;
+	}
+}
+
+/* Release a plant */
+void il_plant_destroy(il_plant *p){
+	int i;
+	if(!p) return;
+	for(i = 0; i < p->narrays; i++) free(*p->arrays[i]);
+	free(p);
+}
@@ -0,0 +1,150 @@
+/*
+ * il_plant.h
+ *
+ * Process models for closed-loop testing of IL programs. Pumps,
+ * valves, tanks and first-order lags are stepped in batch between
+ * scans. They read the unit's outputs (coils and holding registers,
+ * or any other register) and write its inputs (1xxxx and 3xxxx)
+ * with il_unit_input(), so changes count for the adaptive scan rate.
+ *
+ * Models are kept as structure-of-arrays, one set of arrays per kind.
+ * A step gathers every model's inputs from the images, updates all
+ * states in plain float loops the compiler can vectorise, then writes
+ * the results back. Models that feed each other through registers
+ * (a pump's flow register as a tank's inflow) see each other's
+ * output with one step of delay.
+ *
+ * All register values are raw counts. Address 0 means "not used"
+ * for optional registers.
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+
+#ifndef IL_PLANT_H_
+#define IL_PLANT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "il_unit.h"
+
+/* Model kinds */
+#define IL_PLANT_PUMP  0
+#define IL_PLANT_VALVE 1
+#define IL_PLANT_TANK  2
+#define IL_PLANT_LAG   3
+
+#define IL_PLANT_TANK_PORTS 2
+
+/* Pump - flow ramps towards rated while the run command is non-zero */
+typedef struct{
+	uint16_t run;        // run command (e.g. a coil)
+	uint16_t flow;       // flow output register (3xxxx)
+	uint16_t running;    // running feedback (1xxxx), set above 10% flow. 0 = none
+	float rated;         // flow at full speed, in counts
+	float ramp;          // ramp time constant, seconds
+} il_pump;
+
+/* Valve - position travels towards the command at a fixed rate */
+typedef struct{
+	uint16_t command;    // position command (e.g. 4xxxx, or a coil)
+	float command_full;  // command value meaning fully open (1 for a coil)
+	float stroke;        // full travel time, seconds (0 = instant)
+	uint16_t position;   // position output register (3xxxx). 0 = none
+	float position_full; // position register value when fully open
+	uint16_t open;       // open limit switch (1xxxx). 0 = none
+	uint16_t closed;     // closed limit switch (1xxxx). 0 = none
+	uint16_t flow;       // flow through the valve (3xxxx). 0 = none
+	float max_flow;      // flow when fully open, in counts
+} il_valve;
+
+/* Tank - level integrates inflows less outflows */
+typedef struct{
+	uint16_t inflow[IL_PLANT_TANK_PORTS];   // flow registers in. 0 = none
+	uint16_t outflow[IL_PLANT_TANK_PORTS];  // flow registers out. 0 = none
+	float gain;          // level counts per flow count per second (1 / area)
+	float level;         // initial level, counts
+	float max_level;     // level when full, counts
+	uint16_t output;     // level output register (3xxxx)
+	uint16_t high;       // high level switch (1xxxx). 0 = none
+	float high_level;    // level at or above which high is set
+	uint16_t low;        // low level switch (1xxxx). 0 = none
+	float low_level;     // level at or below which low is set
+} il_tank;
+
+/* First-order lag - output follows gain * input + bias */
+typedef struct{
+	uint16_t input;      // input register (any bank)
+	uint16_t output;     // output register (3xxxx)
+	float gain;
+	float bias;
+	float tau;           // time constant, seconds (0 = no lag)
+	float initial;       // initial output, counts
+} il_lag;
+
+typedef struct il_plant il_plant;
+
+/* Create an empty plant
+ *
+ * @param capacity - most models of each kind
+ * @return - the plant, or NULL if out of memory
+ */
+il_plant * il_plant_create(uint32_t capacity);
+
+/* Add a model. The unit must outlive the plant.
+ *
+ * @param plant - the plant
+ * @param unit  - the unit the model's registers belong to
+ * @param model - the model settings
+ * @return - index of the model within its kind, or -1 if the plant is
+ *           full or a register address is invalid
+ */
+int32_t il_plant_add_pump(il_plant *plant, il_unit *unit, const il_pump *model);
+int32_t il_plant_add_valve(il_plant *plant, il_unit *unit, const il_valve *model);
+int32_t il_plant_add_tank(il_plant *plant, il_unit *unit, const il_tank *model);
+int32_t il_plant_add_lag(il_plant *plant, il_unit *unit, const il_lag *model);
+
+/* Step every model. Call between scans, never during one.
+ *
+ * @param plant - the plant
+ * @param dt    - time step, seconds
+ */
+void il_plant_step(il_plant *plant, float dt);
+
+/* Get the state of a model - pump flow, valve position (0..1),
+ * tank level or lag output
+ *
+ * @param plant - the plant
+ * @param kind  - IL_PLANT_xxx
+ * @param index - index returned when the model was added
+ * @return - the state, 0 if there is no such model
+ */
+float il_plant_state(const il_plant *plant, int kind, uint32_t index);
+
+/* Release a plant */
+void il_plant_destroy(il_plant *plant);
+
+#endif /* IL_PLANT_H_ */
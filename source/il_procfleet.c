@@ -0,0 +1,506 @@
+/*
+ * il_procfleet.c
+ *
+ * Multi-process fleet simulation over local shared memory.
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "il_procfleet.h"
+
+/* How often the coordinator checks for dead workers while waiting */
+#define PF_POLL_MS 100
+
+/* Commands from the coordinator to a worker */
+enum{
+	PF_CMD_TICK,     // run ticks, publish peer values
+	PF_CMD_APPLY,    // receive peer values and write destinations
+	PF_CMD_GET,      // mailbox read
+	PF_CMD_SET,      // mailbox write
+	PF_CMD_QUIT
+};
+
+/******************************************
+ * Shared memory layout
+ *   pf_slot  slot[processes]
+ *   pf_ring  ring[processes * processes]   ring[src * P + dst]
+ *   uint16_t value[nmaps]                  ring storage
+ ******************************************/
+
+/* Per-worker control block */
+typedef struct{
+	sem_t go;                 // posted by coordinator
+	sem_t done;               // posted by worker
+	int command;
+	uint32_t ticks;
+	uint32_t unit;            // mailbox - local unit number
+	uint16_t addr;
+	uint16_t value;
+	bool ok;
+	il_procfleet_worker_stats stats;
+} pf_slot;
+
+/* Single producer, single consumer ring of peer values. Its
+ * capacity is the number of values sent per tick between the
+ * two processes, so it can never fill within a tick. */
+typedef struct{
+	atomic_uint head;         // written by the producer
+	atomic_uint tail;         // written by the consumer
+	uint32_t size;
+	uint32_t data;            // first entry in the shared value area
+} pf_ring;
+
+struct il_procfleet{
+	il_procfleet_config cfg;
+	int nproc;
+	uint32_t * first;         // first unit of each process, nproc+1 entries
+	pid_t * pid;
+
+	void * shm;
+	size_t shm_size;
+	pf_slot * slot;
+	pf_ring * ring;
+	uint16_t * value;
+
+	/* Peer routing, computed before fork. route[] holds map indices
+	 * grouped by (source process, destination process) in the caller's
+	 * order. route_seg[s*P+d] is the start of a group - which is also
+	 * the start of that pair's ring storage. */
+	il_peer_map * maps;
+	uint32_t * route;
+	uint32_t * route_seg;
+	bool cross;               // some mappings cross processes
+	bool dead;
+
+	/* Worker process only */
+	int self;
+	il_fleet * fleet;
+	uint16_t * staging;       // value of each mapping for this tick
+	uint32_t * scatter;       // mappings written by this process, in order
+	uint32_t nscatter;
+};
+
+/* Process owning a unit */
+static int unit_proc(const il_procfleet *pf, uint32_t unit){
+	int lo = 0, hi = pf->nproc - 1;
+	while(lo < hi){
+		int mid = (lo + hi + 1) / 2;
+		if(unit >= pf->first[mid]) lo = mid; else hi = mid - 1;
+	}
+	return lo;
+}
+
+/******************************************
+ * Worker process
+ ******************************************/
+
+static void setup_unit(il_unit *unit, uint32_t index, void *user){
+	il_procfleet * pf = user;
+	pf->cfg.setup(unit, pf->first[pf->self] + index, pf->cfg.user);
+}
+
+/* Read this process's mapping sources. Local ones go straight to
+ * staging, the rest are pushed to the destination process's ring */
+static void publish(il_procfleet *pf){
+	int d;
+	uint32_t i;
+	for(d = 0; d < pf->nproc; d++){
+		pf_ring * r = &pf->ring[pf->self * pf->nproc + d];
+		uint32_t start = pf->route_seg[pf->self * pf->nproc + d];
+		uint32_t end   = pf->route_seg[pf->self * pf->nproc + d + 1];
+		unsigned head = atomic_load_explicit(&r->head, memory_order_relaxed);
+
+		for(i = start; i < end; i++){
+			const il_peer_map * m = &pf->maps[pf->route[i]];
+			il_unit * u = il_fleet_unit(pf->fleet, m->src_unit - pf->first[pf->self]);
+			uint16_t v = il_image_get(u->ctx.image, m->src_addr, false);
+			if(d == pf->self){
+				pf->staging[pf->route[i]] = v;
+			} else {
+				pf->value[r->data + head % r->size] = v;
+				head++;
+			}
+		}
+		if(d != pf->self && end > start){
+			atomic_store_explicit(&r->head, head, memory_order_release);
+			pf->slot[pf->self].stats.peer_sent += end - start;
+		}
+	}
+}
+
+/* Receive peer values from the other processes, then write every
+ * mapping destination of this process in the caller's order */
+static void apply(il_procfleet *pf){
+	int s;
+	uint32_t i;
+	for(s = 0; s < pf->nproc; s++){
+		pf_ring * r;
+		uint32_t start, end;
+		unsigned tail;
+		if(s == pf->self) continue;
+		r = &pf->ring[s * pf->nproc + pf->self];
+		start = pf->route_seg[s * pf->nproc + pf->self];
+		end   = pf->route_seg[s * pf->nproc + pf->self + 1];
+		tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+		(void)atomic_load_explicit(&r->head, memory_order_acquire);
+		for(i = start; i < end; i++){
+			pf->staging[pf->route[i]] = pf->value[r->data + tail % r->size];
+			tail++;
+		}
+		atomic_store_explicit(&r->tail, tail, memory_order_release);
+		pf->slot[pf->self].stats.peer_received += end - start;
+	}
+	for(i = 0; i < pf->nscatter; i++){
+		const il_peer_map * m = &pf->maps[pf->scatter[i]];
+		il_unit * u = il_fleet_unit(pf->fleet, m->dst_unit - pf->first[pf->self]);
+		il_unit_input(u, m->dst_addr, pf->staging[pf->scatter[i]]);
+	}
+}
+
+static void update_stats(il_procfleet *pf){
+	il_fleet_stats fs;
+	pf_slot * s = &pf->slot[pf->self];
+	il_fleet_get_stats(pf->fleet, &fs);
+	s->stats.ticks = fs.ticks;
+	s->stats.scans = fs.scans;
+	s->stats.overruns = fs.overruns;
+}
+
+static void sem_wait_intr(sem_t *sem){
+	while(sem_wait(sem) != 0 && errno == EINTR);
+}
+
+/* Body of a worker process. Never returns */
+static void worker_main(il_procfleet *pf){
+	pf_slot * s = &pf->slot[pf->self];
+	il_fleet_config fc;
+	uint32_t i, t;
+
+	memset(&fc, 0, sizeof(fc));
+	fc.units = pf->first[pf->self + 1] - pf->first[pf->self];
+	fc.threads = pf->cfg.threads > 0 ? pf->cfg.threads : 1;
+	// No NUMA pinning - with one node per fleet every process would bind
+	// to the first node. The OS spreads the processes instead.
+	fc.numa = false;
+	fc.program = pf->cfg.program;
+	fc.lines = pf->cfg.lines;
+	if(pf->cfg.setup){
+		fc.setup = setup_unit;
+		fc.user = pf;
+	}
+	pf->fleet = il_fleet_create(&fc);
+	pf->staging = calloc(pf->cfg.nmaps ? pf->cfg.nmaps : 1, sizeof(uint16_t));
+	pf->scatter = malloc((pf->cfg.nmaps ? pf->cfg.nmaps : 1) * sizeof(uint32_t));
+	s->ok = pf->fleet && pf->staging && pf->scatter;
+	sem_post(&s->done);
+	if(!s->ok) _exit(EXIT_FAILURE);
+
+	for(i = 0; i < pf->cfg.nmaps; i++){
+		if(unit_proc(pf, pf->maps[i].dst_unit) == pf->self) pf->scatter[pf->nscatter++] = i;
+	}
+
+	for(;;){
+		sem_wait_intr(&s->go);
+		switch(s->command){
+		case PF_CMD_TICK:
+			for(t = 0; t < s->ticks; t++){
+				il_fleet_run(pf->fleet, 1);
+				publish(pf);
+				if(!pf->cross) apply(pf);
+			}
+			update_stats(pf);
+			break;
+		case PF_CMD_APPLY:
+			apply(pf);
+			break;
+		case PF_CMD_GET:
+			s->value = il_image_get(il_fleet_unit(pf->fleet, s->unit)->ctx.image, s->addr, false);
+			break;
+		case PF_CMD_SET:
+			il_unit_input(il_fleet_unit(pf->fleet, s->unit), s->addr, s->value);
+			break;
+		case PF_CMD_QUIT:
+			il_fleet_destroy(pf->fleet);
+			sem_post(&s->done);
+			_exit(EXIT_SUCCESS);
+		}
+		sem_post(&s->done);
+	}
+}
+
+/******************************************
+ * Coordinator
+ ******************************************/
+
+/* Kill and reap every worker after one has died */
+static void kill_workers(il_procfleet *pf){
+	int i;
+	pf->dead = true;
+	for(i = 0; i < pf->nproc; i++){
+		if(pf->pid[i] > 0){
+			kill(pf->pid[i], SIGKILL);
+			waitpid(pf->pid[i], NULL, 0);
+			pf->pid[i] = 0;
+		}
+	}
+}
+
+/* Wait for a worker to finish its command, checking that it
+ * is still alive every PF_POLL_MS */
+static bool wait_done(il_procfleet *pf, int i){
+	struct timespec ts;
+	for(;;){
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_nsec += PF_POLL_MS * 1000000L;
+		if(ts.tv_nsec >= 1000000000L){
+			ts.tv_sec++;
+			ts.tv_nsec -= 1000000000L;
+		}
+		if(sem_timedwait(&pf->slot[i].done, &ts) == 0) return true;
+		if(errno == EINTR) continue;
+		if(waitpid(pf->pid[i], NULL, WNOHANG) == pf->pid[i]){
+			pf->pid[i] = 0;
+			kill_workers(pf);
+			return false;
+		}
+	}
+}
+
+/* Send a command to every worker and wait until all are done */
+static bool command_all(il_procfleet *pf, int command, uint32_t ticks){
+	int i;
+	for(i = 0; i < pf->nproc; i++){
+		pf->slot[i].command = command;
+		pf->slot[i].ticks = ticks;
+		sem_post(&pf->slot[i].go);
+	}
+	for(i = 0; i < pf->nproc; i++){
+		if(!wait_done(pf, i)) return false;
+	}
+	return true;
+}
+
+/* Compute the peer routing groups and the shared memory size */
+static bool build_routes(il_procfleet *pf){
+	uint32_t i, pairs = pf->nproc * pf->nproc;
+	uint32_t * fill;
+
+	pf->route = malloc((pf->cfg.nmaps ? pf->cfg.nmaps : 1) * sizeof(uint32_t));
+	pf->route_seg = calloc(pairs + 1, sizeof(uint32_t));
+	fill = calloc(pairs, sizeof(uint32_t));
+	if(!pf->route || !pf->route_seg || !fill){
+		free(fill);
+		return false;
+	}
+	for(i = 0; i < pf->cfg.nmaps; i++){
+		int s = unit_proc(pf, pf->maps[i].src_unit);
+		int d = unit_proc(pf, pf->maps[i].dst_unit);
+		pf->route_seg[s * pf->nproc + d + 1]++;
+		if(s != d) pf->cross = true;
+	}
+	for(i = 1; i <= pairs; i++) pf->route_seg[i] += pf->route_seg[i-1];
+	for(i = 0; i < pf->cfg.nmaps; i++){
+		int p = unit_proc(pf, pf->maps[i].src_unit) * pf->nproc +
+		        unit_proc(pf, pf->maps[i].dst_unit);
+		pf->route[pf->route_seg[p] + fill[p]++] = i;
+	}
+	free(fill);
+	return true;
+}
+
+/* Create the shared memory and fork the worker processes */
+il_procfleet * il_procfleet_create(const il_procfleet_config *cfg){
+	il_procfleet * pf;
+	uint32_t i;
+	int p, started = 0;
+	bool ok = true;
+
+	if(cfg->processes <= 0 || cfg->units < (uint32_t)cfg->processes) return NULL;
+	for(i = 0; i < cfg->nmaps; i++){
+		if(cfg->maps[i].src_unit >= cfg->units || cfg->maps[i].dst_unit >= cfg->units) return NULL;
+	}
+
+	pf = calloc(1, sizeof(*pf));
+	if(!pf) return NULL;
+	pf->cfg = *cfg;
+	pf->nproc = cfg->processes;
+	pf->first = calloc(pf->nproc + 1, sizeof(uint32_t));
+	pf->pid = calloc(pf->nproc, sizeof(pid_t));
+	pf->maps = malloc((cfg->nmaps ? cfg->nmaps : 1) * sizeof(il_peer_map));
+	if(!pf->first || !pf->pid || !pf->maps){
+		il_procfleet_destroy(pf);
+		return NULL;
+	}
+	memcpy(pf->maps, cfg->maps, cfg->nmaps * sizeof(il_peer_map));
+	pf->cfg.maps = pf->maps;
+	for(p = 0; p <= pf->nproc; p++){
+		pf->first[p] = (uint32_t)((uint64_t)cfg->units * p / pf->nproc);
+	}
+	if(!build_routes(pf)){
+		il_procfleet_destroy(pf);
+		return NULL;
+	}
+
+	pf->shm_size = pf->nproc * sizeof(pf_slot) +
+	               pf->nproc * pf->nproc * sizeof(pf_ring) +
+	               cfg->nmaps * sizeof(uint16_t);
+	pf->shm = mmap(NULL, pf->shm_size, PROT_READ | PROT_WRITE,
+	               MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if(pf->shm == MAP_FAILED){
+		pf->shm = NULL;
+		il_procfleet_destroy(pf);
+		return NULL;
+	}
+	pf->slot  = pf->shm;
+	pf->ring  = (pf_ring *)(pf->slot + pf->nproc);
+	pf->value = (uint16_t *)(pf->ring + pf->nproc * pf->nproc);
+	for(p = 0; p < pf->nproc * pf->nproc; p++){
+		pf->ring[p].size = pf->route_seg[p + 1] - pf->route_seg[p];
+		pf->ring[p].data = pf->route_seg[p];
+		atomic_init(&pf->ring[p].head, 0);
+		atomic_init(&pf->ring[p].tail, 0);
+	}
+	for(p = 0; p < pf->nproc; p++){
+		sem_init(&pf->slot[p].go, 1, 0);
+		sem_init(&pf->slot[p].done, 1, 0);
+		pf->slot[p].stats.first_unit = pf->first[p];
+		pf->slot[p].stats.units = pf->first[p + 1] - pf->first[p];
+	}
+
+	for(p = 0; p < pf->nproc; p++){
+		pid_t pid = fork();
+		if(pid == 0){
+			pf->self = p;
+			worker_main(pf);
+		}
+		if(pid < 0) break;
+		pf->pid[p] = pid;
+		pf->slot[p].stats.pid = pid;
+		started++;
+	}
+	for(p = 0; p < started && ok; p++){
+		ok = wait_done(pf, p) && pf->slot[p].ok;
+	}
+	if(!ok || started < pf->nproc){
+		kill_workers(pf);
+		il_procfleet_destroy(pf);
+		return NULL;
+	}
+	return pf;
+}
+
+/* Stop the workers and release the fleet */
+void il_procfleet_destroy(il_procfleet *pf){
+	int p;
+	if(!pf) return;
+	if(pf->shm){
+		if(!pf->dead) command_all(pf, PF_CMD_QUIT, 0);
+		for(p = 0; p < pf->nproc; p++){
+			if(pf->pid[p] > 0) waitpid(pf->pid[p], NULL, 0);
+			sem_destroy(&pf->slot[p].go);
+			sem_destroy(&pf->slot[p].done);
+		}
+		munmap(pf->shm, pf->shm_size);
+	}
+	free(pf->first);
+	free(pf->pid);
+	free(pf->maps);
+	free(pf->route);
+	free(pf->route_seg);
+	free(pf);
+}
+
+/* Run the fleet for a number of virtual ticks. With no peer I/O
+ * between processes the workers run all ticks without stopping,
+ * otherwise every tick is split at the peer exchange. */
+bool il_procfleet_run(il_procfleet *pf, uint32_t ticks){
+	uint32_t t;
+	if(pf->dead) return false;
+	if(!pf->cross) return command_all(pf, PF_CMD_TICK, ticks);
+	for(t = 0; t < ticks; t++){
+		if(!command_all(pf, PF_CMD_TICK, 1)) return false;
+		if(!command_all(pf, PF_CMD_APPLY, 0)) return false;
+	}
+	return true;
+}
+
+/* Post a mailbox command to the worker owning a unit */
+static bool mailbox(il_procfleet *pf, int command, uint32_t unit, uint16_t addr, uint16_t *value){
+	int p;
+	pf_slot * s;
+	if(pf->dead || unit >= pf->cfg.units) return false;
+	p = unit_proc(pf, unit);
+	s = &pf->slot[p];
+	s->command = command;
+	s->unit = unit - pf->first[p];
+	s->addr = addr;
+	s->value = *value;
+	sem_post(&s->go);
+	if(!wait_done(pf, p)) return false;
+	*value = s->value;
+	return true;
+}
+
+/* Read a register of a unit */
+bool il_procfleet_get(il_procfleet *pf, uint32_t unit, uint16_t addr, uint16_t *value){
+	*value = 0;
+	return mailbox(pf, PF_CMD_GET, unit, addr, value);
+}
+
+/* Write a register of a unit */
+bool il_procfleet_set(il_procfleet *pf, uint32_t unit, uint16_t addr, uint16_t value){
+	return mailbox(pf, PF_CMD_SET, unit, addr, &value);
+}
+
+/* Get the statistics of each worker and the fleet totals */
+void il_procfleet_get_stats(const il_procfleet *pf,
+                            il_procfleet_worker_stats *worker,
+                            il_procfleet_worker_stats *total){
+	int p;
+	if(total) memset(total, 0, sizeof(*total));
+	for(p = 0; p < pf->nproc; p++){
+		const il_procfleet_worker_stats * s = &pf->slot[p].stats;
+		if(worker) worker[p] = *s;
+		if(total){
+			total->units += s->units;
+			total->ticks = s->ticks;
+			total->scans += s->scans;
+			total->overruns += s->overruns;
+			total->peer_sent += s->peer_sent;
+			total->peer_received += s->peer_received;
+		}
+	}
+}
@@ -0,0 +1,127 @@
+/*
+ * il_procfleet.h
+ *
+ * Multi-process fleet simulation. Splits the units of a fleet over
+ * several worker processes on the same host, so a crash or heap
+ * fragmentation in one process cannot take down the others.
+ *
+ * A coordinator (the calling process) steps every worker through
+ * each virtual tick. Peer I/O between processes goes through
+ * single-producer single-consumer ring buffers in shared memory,
+ * and is applied in the same order as il_fleet applies it, so the
+ * result of every tick is the same for any number of processes.
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+
+#ifndef IL_PROCFLEET_H_
+#define IL_PROCFLEET_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "il_fleet.h"
+
+/* Multi-process fleet creation parameters */
+typedef struct{
+	uint32_t units;          // total number of units
+	int processes;           // worker processes
+	int threads;             // il_fleet worker threads in each process (0 = 1)
+	const il_line *program;  // program loaded into every unit (may be NULL)
+	uint16_t lines;
+	const il_peer_map *maps; // peer I/O mappings, fixed for the fleet's life
+	uint32_t nmaps;
+
+	/* Optional per-unit setup, called in the worker process that owns
+	 * the unit. index is the fleet-wide unit number. */
+	void (*setup)(il_unit *unit, uint32_t index, void *user);
+	void *user;
+} il_procfleet_config;
+
+/* Statistics of one worker process */
+typedef struct{
+	int pid;
+	uint32_t first_unit;     // first unit of this process
+	uint32_t units;          // number of units
+	uint64_t ticks;
+	uint64_t scans;
+	uint64_t overruns;
+	uint64_t peer_sent;      // peer values sent to other processes
+	uint64_t peer_received;  // peer values received from other processes
+} il_procfleet_worker_stats;
+
+typedef struct il_procfleet il_procfleet;
+
+/* Create the shared memory and fork the worker processes. Must be
+ * called before the calling process starts any threads.
+ *
+ * @param cfg - the fleet parameters
+ * @return - the fleet, or NULL on failure
+ */
+il_procfleet * il_procfleet_create(const il_procfleet_config *cfg);
+
+/* Stop the workers and release the fleet.
+ *
+ * @param pf - the fleet
+ */
+void il_procfleet_destroy(il_procfleet *pf);
+
+/* Run the fleet for a number of virtual ticks.
+ *
+ * @param pf    - the fleet
+ * @param ticks - number of ticks
+ * @return - true if done. false if a worker process has died, in
+ *           which case the fleet can only be destroyed.
+ */
+bool il_procfleet_run(il_procfleet *pf, uint32_t ticks);
+
+/* Read a register of a unit (between runs)
+ *
+ * @param pf    - the fleet
+ * @param unit  - fleet-wide unit number
+ * @param addr  - modbus style address
+ * @param value - pointer to store the value
+ * @return - true if read. false if unit invalid or worker dead.
+ */
+bool il_procfleet_get(il_procfleet *pf, uint32_t unit, uint16_t addr, uint16_t *value);
+
+/* Write a register of a unit (between runs)
+ *
+ * @return - true if written. false if unit invalid or worker dead.
+ */
+bool il_procfleet_set(il_procfleet *pf, uint32_t unit, uint16_t addr, uint16_t value);
+
+/* Get the statistics of each worker and the fleet totals.
+ *
+ * @param pf     - the fleet
+ * @param worker - array of cfg.processes entries to fill (may be NULL)
+ * @param total  - totals over all workers (may be NULL). pid is 0.
+ */
+void il_procfleet_get_stats(const il_procfleet *pf,
+                            il_procfleet_worker_stats *worker,
+                            il_procfleet_worker_stats *total);
+
+#endif /* IL_PROCFLEET_H_ */
@@ -0,0 +1,66 @@
+/*
+ * il_profile.c
+ *
+ * Per-line execution profile.
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "il_profile.h"
+
+/* Allocate a cleared profile */
+bool il_profile_init(il_profile *prof, uint16_t lines){
+	prof->lines = lines;
+	prof->exec = calloc(lines ? lines : 1, sizeof(uint32_t));
+	prof->taken = calloc(lines ? lines : 1, sizeof(uint32_t));
+	if(!prof->exec || !prof->taken){
+		il_profile_free(prof);
+		return false;
+	}
+	return true;
+}
+
+/* Release a profile */
+void il_profile_free(il_profile *prof){
+	free(prof->exec);
+	free(prof->taken);
+	prof->exec = prof->taken = NULL;
+	prof->lines = 0;
+}
+
+/* Zero all counters */
+void il_profile_clear(il_profile *prof){
+	memset(prof->exec, 0, prof->lines * sizeof(uint32_t));
+	memset(prof->taken, 0, prof->lines * sizeof(uint32_t));
+}
+
+/* Copy the counters for display */
+void il_profile_snapshot(const il_profile *prof, il_profile *dst){
+	uint16_t n = (prof->lines < dst->lines) ? prof->lines : dst->lines;
+	memcpy(dst->exec, prof->exec, n * sizeof(uint32_t));
+	memcpy(dst->taken, prof->taken, n * sizeof(uint32_t));
+}
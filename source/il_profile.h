@@ -0,0 +1,80 @@
+/*
+ * il_profile.h
+ *
+ * Per-line execution profile. The execution loop counts each line
+ * executed, and each time it did not continue to the following line
+ * (a jump, call or return taken). Displays read a snapshot rather
+ * than the live counters.
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+
+#ifndef IL_PROFILE_H_
+#define IL_PROFILE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct{
+	uint16_t lines;
+	uint32_t *exec;    // times each line was executed
+	uint32_t *taken;   // times execution then went elsewhere than the next line
+} il_profile;
+
+/* Allocate a cleared profile
+ *
+ * @param prof  - the profile
+ * @param lines - number of program lines
+ * @return - true if allocated. false if out of memory.
+ */
+bool il_profile_init(il_profile *prof, uint16_t lines);
+
+/* Release a profile */
+void il_profile_free(il_profile *prof);
+
+/* Zero all counters */
+void il_profile_clear(il_profile *prof);
+
+/* Count one executed line (called by the execution loop)
+ *
+ * @param prof - the profile
+ * @param line - the line executed
+ * @param next - the next line to execute
+ */
+static inline void il_profile_count(il_profile *prof, uint16_t line, uint16_t next){
+	prof->exec[line]++;
+	if(next != line + 1) prof->taken[line]++;
+}
+
+/* Copy the counters for display
+ *
+ * @param prof - the live profile
+ * @param dst  - a profile initialised with the same number of lines
+ */
+void il_profile_snapshot(const il_profile *prof, il_profile *dst);
+
+#endif /* IL_PROFILE_H_ */
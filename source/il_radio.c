@@ -0,0 +1,302 @@
+/*
+ * il_radio.c
+ *
+ * Event driven radio channel model with listen-before-talk
+ * backoff and repeater hops.
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "il_radio.h"
+
+/* Event types - each node has at most one event pending */
+#define EV_ATTEMPT 0   // sense the channel
+#define EV_START   1   // listen time over - transmit if still idle
+#define EV_END     2   // transmission complete
+
+typedef struct{
+	uint64_t offered;    // time the originating node offered it
+	uint32_t bytes;
+} radio_msg;
+
+typedef struct{
+	int32_t route;       // repeater, or IL_RADIO_BASE
+	uint32_t head;       // queue ring in msg[node * queue_len ...]
+	uint32_t count;
+	uint8_t retries;     // backoffs for the head message
+	bool pending;        // has an event in the heap
+} radio_node;
+
+typedef struct{
+	uint64_t time;
+	uint64_t seq;        // orders events at the same time
+	uint32_t node;
+	uint8_t type;
+} radio_event;
+
+struct il_radio{
+	il_radio_config cfg;
+	radio_node * node;
+	radio_msg * msg;
+	radio_event * heap;   // min-heap on (time, seq), one slot per node
+	uint32_t nheap;
+	uint64_t seq;
+	uint64_t now;
+	uint64_t busy_until;  // end of the current transmission
+	uint32_t rng;
+	il_radio_stats st;
+};
+
+/******************************************
+ * Event heap
+ ******************************************/
+static bool before(const radio_event *a, const radio_event *b){
+	return a->time < b->time || (a->time == b->time && a->seq < b->seq);
+}
+
+static void schedule(il_radio *r, uint32_t node, uint8_t type, uint64_t time){
+	uint32_t i = r->nheap++;
+	radio_event e = { time, r->seq++, node, type };
+	while(i > 0){
+		uint32_t parent = (i - 1) / 2;
+		if(!before(&e, &r->heap[parent])) break;
+		r->heap[i] = r->heap[parent];
+		i = parent;
+	}
+	r->heap[i] = e;
+	r->node[node].pending = true;
+}
+
+static radio_event pop(il_radio *r){
+	radio_event top = r->heap[0], last = r->heap[--r->nheap];
+	uint32_t i = 0;
+	for(;;){
+		uint32_t c = 2 * i + 1;
+		if(c >= r->nheap) break;
+		if(c + 1 < r->nheap && before(&r->heap[c + 1], &r->heap[c])) c++;
+		if(!before(&r->heap[c], &last)) break;
+		r->heap[i] = r->heap[c];
+		i = c;
+	}
+	if(r->nheap) r->heap[i] = last;
+	r->node[top.node].pending = false;
+	return top;
+}
+
+/******************************************
+ * Node queues
+ ******************************************/
+static radio_msg * head_msg(il_radio *r, uint32_t node){
+	return &r->msg[(size_t)node * r->cfg.queue_len + r->node[node].head];
+}
+
+/* Queue a message at a node, starting it sending at time t if idle */
+static bool enqueue(il_radio *r, uint32_t node, radio_msg m, uint64_t t){
+	radio_node * n = &r->node[node];
+	if(n->count == r->cfg.queue_len){
+		r->st.dropped_queue++;
+		return false;
+	}
+	r->msg[(size_t)node * r->cfg.queue_len + (n->head + n->count) % r->cfg.queue_len] = m;
+	n->count++;
+	if(!n->pending) schedule(r, node, EV_ATTEMPT, t);
+	return true;
+}
+
+static void dequeue(il_radio *r, uint32_t node){
+	radio_node * n = &r->node[node];
+	n->head = (n->head + 1) % r->cfg.queue_len;
+	n->count--;
+	n->retries = 0;
+}
+
+/* Start on the next queued message, if any */
+static void next_msg(il_radio *r, uint32_t node, uint64_t t){
+	if(r->node[node].count) schedule(r, node, EV_ATTEMPT, t);
+}
+
+/* xorshift32 - for the backoff slots */
+static uint32_t rnd(il_radio *r){
+	uint32_t x = r->rng;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return r->rng = x;
+}
+
+/* Channel busy - wait for it to clear plus a random backoff */
+static void backoff(il_radio *r, uint32_t node, uint64_t t){
+	radio_node * n = &r->node[node];
+	uint32_t e;
+
+	r->st.backoffs++;
+	if(++n->retries > r->cfg.max_retries){
+		r->st.dropped_retry++;
+		dequeue(r, node);
+		next_msg(r, node, t);
+		return;
+	}
+	e = r->cfg.min_exponent + n->retries - 1;
+	if(e > r->cfg.max_exponent) e = r->cfg.max_exponent;
+	if(t < r->busy_until) t = r->busy_until;
+	schedule(r, node, EV_ATTEMPT, t + (uint64_t)(rnd(r) & ((1U << e) - 1)) * r->cfg.slot_us);
+}
+
+/* Time on air of a message */
+static uint64_t airtime(const il_radio *r, uint32_t bytes){
+	uint64_t bits = (uint64_t)(bytes + r->cfg.overhead) * 8;
+	return (bits * 1000000ULL + r->cfg.bit_rate - 1) / r->cfg.bit_rate;
+}
+
+static void handle(il_radio *r, const radio_event *e){
+	radio_node * n = &r->node[e->node];
+	radio_msg m;
+
+	switch(e->type){
+	case EV_ATTEMPT:
+		if(e->time < r->busy_until) backoff(r, e->node, e->time);
+		else schedule(r, e->node, EV_START, e->time + r->cfg.lbt_listen_us);
+		break;
+	case EV_START:
+		// Another node started while we listened - we heard it
+		if(e->time < r->busy_until){
+			backoff(r, e->node, e->time);
+			break;
+		}
+		r->busy_until = e->time + airtime(r, head_msg(r, e->node)->bytes);
+		r->st.busy_us += r->busy_until - e->time;
+		r->st.transmissions++;
+		schedule(r, e->node, EV_END, r->busy_until);
+		break;
+	case EV_END:
+		m = *head_msg(r, e->node);
+		dequeue(r, e->node);
+		if(n->route == IL_RADIO_BASE){
+			uint64_t delay = e->time - m.offered;
+			r->st.delivered++;
+			r->st.delay_sum_us += delay;
+			if(delay > r->st.delay_max_us) r->st.delay_max_us = delay;
+		} else {
+			enqueue(r, (uint32_t)n->route, m, e->time + r->cfg.turnaround_us);
+		}
+		next_msg(r, e->node, e->time);
+		break;
+	}
+}
+
+/******************************************
+ * Interface functions
+ ******************************************/
+
+/* Create a channel with every node reaching the base directly */
+il_radio * il_radio_create(const il_radio_config *cfg){
+	il_radio * r;
+	uint32_t i;
+
+	if(!cfg->nodes || !cfg->bit_rate || !cfg->queue_len || cfg->max_exponent > 30 ||
+	   cfg->min_exponent > cfg->max_exponent) return NULL;
+	r = calloc(1, sizeof(*r));
+	if(!r) return NULL;
+	r->cfg = *cfg;
+	r->node = calloc(cfg->nodes, sizeof(radio_node));
+	r->msg = malloc((size_t)cfg->nodes * cfg->queue_len * sizeof(radio_msg));
+	r->heap = malloc(cfg->nodes * sizeof(radio_event));
+	if(!r->node || !r->msg || !r->heap){
+		il_radio_destroy(r);
+		return NULL;
+	}
+	for(i = 0; i < cfg->nodes; i++) r->node[i].route = IL_RADIO_BASE;
+	r->rng = cfg->seed ? cfg->seed : 1;
+	return r;
+}
+
+/* Release a channel */
+void il_radio_destroy(il_radio *r){
+	if(!r) return;
+	free(r->node);
+	free(r->msg);
+	free(r->heap);
+	free(r);
+}
+
+/* Route a node through a repeater */
+bool il_radio_set_route(il_radio *r, uint32_t node, int32_t repeater){
+	int32_t hop = repeater;
+	uint32_t steps;
+
+	if(node >= r->cfg.nodes) return false;
+	if(repeater != IL_RADIO_BASE && (repeater < 0 || (uint32_t)repeater >= r->cfg.nodes)) return false;
+	for(steps = 0; hop != IL_RADIO_BASE && steps < r->cfg.nodes; steps++){
+		if((uint32_t)hop == node) return false;   // would loop
+		hop = r->node[hop].route;
+	}
+	r->node[node].route = repeater;
+	return true;
+}
+
+/* Offer a message from a node at the current time */
+bool il_radio_send(il_radio *r, uint32_t node, uint32_t bytes){
+	radio_msg m = { r->now, bytes };
+	if(node >= r->cfg.nodes) return false;
+	r->st.offered++;
+	r->st.offered_bytes += bytes;
+	return enqueue(r, node, m, r->now);
+}
+
+/* Process channel events up to a time */
+void il_radio_run(il_radio *r, uint64_t until){
+	while(r->nheap && r->heap[0].time <= until){
+		radio_event e = pop(r);
+		r->now = e.time;
+		handle(r, &e);
+	}
+	if(until > r->now) r->now = until;
+}
+
+/* Get the current time */
+uint64_t il_radio_now(const il_radio *r){
+	return r->now;
+}
+
+/* Get the number of nodes */
+uint32_t il_radio_nodes(const il_radio *r){
+	return r->cfg.nodes;
+}
+
+/* Get the channel statistics */
+void il_radio_get_stats(const il_radio *r, il_radio_stats *stats){
+	uint32_t i;
+
+	*stats = r->st;
+	stats->elapsed_us = r->now;
+	// Don't count the part of a transmission still to come
+	if(r->busy_until > r->now) stats->busy_us -= r->busy_until - r->now;
+	stats->utilisation = r->now ? (double)stats->busy_us / r->now : 0.0;
+	stats->delay_mean_us = stats->delivered ? (double)stats->delay_sum_us / stats->delivered : 0.0;
+	stats->queued = 0;
+	for(i = 0; i < r->cfg.nodes; i++) stats->queued += r->node[i].count;
+}
@@ -0,0 +1,133 @@
+/*
+ * il_radio.h
+ *
+ * Radio channel model for network simulations - whether one shared
+ * channel can carry the traffic the units' programs generate.
+ *
+ * Event driven: nodes offer messages (e.g. the size of each
+ * il_telemetry message) and il_radio_run() advances the channel to a
+ * given time. Each node sends its queued messages in order. Before
+ * every transmission it listens for lbt_listen_us and backs off a
+ * random number of slots while the channel is busy (binary
+ * exponential window). Carrier sense is assumed perfect, so there are
+ * no collisions, only contention delay. A message for a node behind
+ * a repeater is queued again at the repeater when it has been
+ * received there, until it reaches the base.
+ *
+ * All times are in microseconds of simulated time.
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+
+#ifndef IL_RADIO_H_
+#define IL_RADIO_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define IL_RADIO_BASE (-1)   // route of a node that reaches the base directly
+
+/* Channel parameters */
+typedef struct{
+	uint32_t nodes;
+	uint32_t bit_rate;        // bits per second on air
+	uint32_t overhead;        // bytes added to every message (preamble, address, CRC)
+	uint32_t lbt_listen_us;   // listen time before transmitting
+	uint32_t slot_us;         // backoff slot
+	uint8_t min_exponent;     // first backoff window is 2^min_exponent slots
+	uint8_t max_exponent;     // largest window
+	uint8_t max_retries;      // busy channel backoffs before a message is dropped
+	uint32_t turnaround_us;   // repeater receive to forward
+	uint32_t queue_len;       // messages queued per node
+	uint32_t seed;            // for the random backoff
+} il_radio_config;
+
+/* Channel statistics */
+typedef struct{
+	uint64_t elapsed_us;      // simulated time run
+	uint64_t busy_us;         // time the channel was carrying a transmission
+	double utilisation;       // busy_us / elapsed_us
+	uint64_t offered;         // messages offered by nodes
+	uint64_t offered_bytes;
+	uint64_t delivered;       // messages that reached the base
+	uint64_t transmissions;   // including repeater hops
+	uint64_t backoffs;
+	uint64_t dropped_queue;   // queue full
+	uint64_t dropped_retry;   // too many backoffs
+	uint64_t delay_sum_us;    // offer to delivery at the base
+	uint64_t delay_max_us;
+	double delay_mean_us;
+	uint32_t queued;          // messages still waiting
+} il_radio_stats;
+
+typedef struct il_radio il_radio;
+
+/* Create a channel with every node reaching the base directly
+ *
+ * @param cfg - the channel parameters
+ * @return - the channel, or NULL if invalid or out of memory
+ */
+il_radio * il_radio_create(const il_radio_config *cfg);
+
+/* Release a channel */
+void il_radio_destroy(il_radio *radio);
+
+/* Route a node through a repeater
+ *
+ * @param radio    - the channel
+ * @param node     - the node
+ * @param repeater - the node that relays its messages, or IL_RADIO_BASE
+ * @return - true if set. false if out of range or a loop.
+ */
+bool il_radio_set_route(il_radio *radio, uint32_t node, int32_t repeater);
+
+/* Offer a message from a node at the current time
+ *
+ * @param radio - the channel
+ * @param node  - the sending node
+ * @param bytes - payload size
+ * @return - true if queued. false if the node's queue is full.
+ */
+bool il_radio_send(il_radio *radio, uint32_t node, uint32_t bytes);
+
+/* Process channel events up to a time, which becomes the current time
+ *
+ * @param radio - the channel
+ * @param until - the time to run to
+ */
+void il_radio_run(il_radio *radio, uint64_t until);
+
+/* Get the current time */
+uint64_t il_radio_now(const il_radio *radio);
+
+/* Get the number of nodes on the channel */
+uint32_t il_radio_nodes(const il_radio *radio);
+
+/* Get the channel statistics */
+void il_radio_get_stats(const il_radio *radio, il_radio_stats *stats);
+
+#endif /* IL_RADIO_H_ */
@@ -0,0 +1,257 @@
+/*
+ * il_shm_export.c
+ *
+ * Shared memory export of a live memory image.
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "il_shm_export.h"
+
+/* Readers give up after this many attempts on a busy bank */
+#define SHM_READ_RETRIES 10000
+
+struct il_shm_export{
+	il_shm_header * hdr;
+	il_memory_image * image;   // the image inside the segment
+	size_t size;
+	bool writer;
+	char * name;
+	il_context * ctx;          // exporting context
+};
+
+/* Address of a bank inside the segment and its size in bytes */
+static const void * bank_ptr(const il_shm_export *exp, int bank, size_t *len){
+	*len = exp->hdr->bank_size * (bank < 2 ? sizeof(uint8_t) : sizeof(uint16_t));
+	return (const uint8_t *)exp->hdr + exp->hdr->bank_offset[bank];
+}
+
+/* Create a named segment holding a copy of the context's image */
+il_shm_export * il_shm_export_create(const char *name, il_context *ctx){
+	il_shm_export * exp;
+	il_shm_header * hdr;
+	size_t offset = (sizeof(il_shm_header) + 63) & ~(size_t)63;
+	int fd, b;
+
+	if(!ctx->image) return NULL;
+	exp = calloc(1, sizeof(*exp));
+	if(!exp) return NULL;
+	exp->name = strdup(name);
+	exp->size = offset + sizeof(il_memory_image);
+	fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);   // never take over a live segment
+	if(!exp->name || fd < 0){
+		if(fd >= 0) close(fd);
+		free(exp->name);
+		free(exp);
+		return NULL;
+	}
+	if(ftruncate(fd, exp->size) != 0 ||
+	   (hdr = mmap(NULL, exp->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED){
+		close(fd);
+		shm_unlink(name);
+		free(exp->name);
+		free(exp);
+		return NULL;
+	}
+	close(fd);
+
+	memset(hdr, 0, offset);
+	hdr->version = IL_SHM_VERSION;
+	hdr->banks = 4;
+	hdr->bank_size = IL_IMAGE_BANK_SIZE;
+	hdr->image_offset = offset;
+	hdr->image_size = sizeof(il_memory_image);
+	for(b = 0; b < 2; b++){
+		hdr->bank_offset[b]   = offset + offsetof(il_memory_image, bits) + b * sizeof(((il_memory_image *)0)->bits[0]);
+		hdr->bank_offset[b+2] = offset + offsetof(il_memory_image, words) + b * sizeof(((il_memory_image *)0)->words[0]);
+	}
+
+	exp->hdr = hdr;
+	exp->image = (il_memory_image *)((uint8_t *)hdr + offset);
+	exp->writer = true;
+	exp->ctx = ctx;
+	memcpy(exp->image, ctx->image, sizeof(il_memory_image));
+
+	/* Magic last - readers that find it see a complete header */
+	__atomic_store_n(&hdr->magic, IL_SHM_MAGIC, __ATOMIC_RELEASE);
+	return exp;
+}
+
+/* Mark banks as being written - seq becomes odd */
+void il_shm_export_begin(il_shm_export *exp, unsigned mask){
+	int b;
+	for(b = 0; b < 4; b++){
+		if(mask & IL_SHM_BANK(b)){
+			__atomic_store_n(&exp->hdr->seq[b], exp->hdr->seq[b] + 1, __ATOMIC_RELAXED);
+		}
+	}
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/* Mark banks as consistent again - seq becomes even */
+void il_shm_export_end(il_shm_export *exp, unsigned mask, bool scan){
+	int b;
+	if(scan) __atomic_store_n(&exp->hdr->scans, exp->hdr->scans + 1, __ATOMIC_RELAXED);
+	for(b = 0; b < 4; b++){
+		if(mask & IL_SHM_BANK(b)){
+			__atomic_store_n(&exp->hdr->seq[b], exp->hdr->seq[b] + 1, __ATOMIC_RELEASE);
+		}
+	}
+}
+
+/* Copy changed banks of the context's image into the segment. All
+ * changed banks are bracketed together so il_shm_read_image() never
+ * mixes banks from two scans */
+void il_shm_export_publish(il_shm_export *exp, unsigned mask, bool scan){
+	const il_memory_image * src = exp->ctx->image;
+	unsigned changed = 0;
+	int b;
+
+	for(b = 0; b < 2; b++){
+		if((mask & IL_SHM_BANK(b)) && memcmp(exp->image->bits[b], src->bits[b], sizeof(src->bits[b])))
+			changed |= IL_SHM_BANK(b);
+		if((mask & IL_SHM_BANK(b+2)) && memcmp(exp->image->words[b], src->words[b], sizeof(src->words[b])))
+			changed |= IL_SHM_BANK(b+2);
+	}
+	il_shm_export_begin(exp, changed);
+	for(b = 0; b < 2; b++){
+		if(changed & IL_SHM_BANK(b)) memcpy(exp->image->bits[b], src->bits[b], sizeof(src->bits[b]));
+		if(changed & IL_SHM_BANK(b+2)) memcpy(exp->image->words[b], src->words[b], sizeof(src->words[b]));
+	}
+	il_shm_export_end(exp, changed, scan);
+}
+
+/* Write one register of the segment */
+void il_shm_export_set(il_shm_export *exp, uint16_t addr, uint16_t value){
+	int bank, index;
+
+	if(!il_image_decode(addr, &bank, &index)) return;
+	il_shm_export_begin(exp, IL_SHM_BANK(bank));
+	il_image_set(exp->image, addr, value, false);
+	il_shm_export_end(exp, IL_SHM_BANK(bank), false);
+}
+
+/* Open an exported segment read-only */
+il_shm_export * il_shm_open(const char *name){
+	il_shm_export * exp;
+	il_shm_header * hdr;
+	struct stat st;
+	int fd;
+
+	fd = shm_open(name, O_RDONLY, 0);
+	if(fd < 0) return NULL;
+	if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(il_shm_header)){
+		close(fd);
+		return NULL;
+	}
+	hdr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if(hdr == MAP_FAILED) return NULL;
+	if(__atomic_load_n(&hdr->magic, __ATOMIC_ACQUIRE) != IL_SHM_MAGIC ||
+	   hdr->version != IL_SHM_VERSION ||
+	   hdr->image_offset + (size_t)hdr->image_size > (size_t)st.st_size){
+		munmap(hdr, st.st_size);
+		return NULL;
+	}
+	exp = calloc(1, sizeof(*exp));
+	if(!exp){
+		munmap(hdr, st.st_size);
+		return NULL;
+	}
+	exp->hdr = hdr;
+	exp->image = (il_memory_image *)((uint8_t *)hdr + hdr->image_offset);
+	exp->size = st.st_size;
+	return exp;
+}
+
+/* Copy one bank consistently */
+bool il_shm_read_bank(const il_shm_export *exp, int bank, void *dst){
+	const void * src;
+	size_t len;
+	uint32_t s1, s2;
+	int tries;
+
+	if(bank < 0 || bank > 3) return false;
+	src = bank_ptr(exp, bank, &len);
+	for(tries = 0; tries < SHM_READ_RETRIES; tries++){
+		s1 = __atomic_load_n(&exp->hdr->seq[bank], __ATOMIC_ACQUIRE);
+		if(!(s1 & 1)){
+			memcpy(dst, src, len);
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+			s2 = __atomic_load_n(&exp->hdr->seq[bank], __ATOMIC_RELAXED);
+			if(s1 == s2) return true;
+		}
+		sched_yield();   // let a preempted writer finish
+	}
+	return false;
+}
+
+/* Copy all four banks from the same moment */
+bool il_shm_read_image(const il_shm_export *exp, il_memory_image *dst){
+	uint32_t s1[4];
+	int tries, b;
+
+	if(exp->hdr->bank_size != IL_IMAGE_BANK_SIZE) return false;
+	for(tries = 0; tries < SHM_READ_RETRIES; tries++){
+		bool busy = false;
+		for(b = 0; b < 4; b++){
+			s1[b] = __atomic_load_n(&exp->hdr->seq[b], __ATOMIC_ACQUIRE);
+			busy |= (s1[b] & 1);
+		}
+		if(!busy){
+			memcpy(dst, exp->image, sizeof(il_memory_image));
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+			for(b = 0; b < 4; b++){
+				if(__atomic_load_n(&exp->hdr->seq[b], __ATOMIC_RELAXED) != s1[b]) break;
+			}
+			if(b == 4) return true;
+		}
+		sched_yield();
+	}
+	return false;
+}
+
+/* Get the segment header */
+const il_shm_header * il_shm_header_of(const il_shm_export *exp){
+	return exp->hdr;
+}
+
+/* Release an export or a read-only view */
+void il_shm_close(il_shm_export *exp){
+	if(!exp) return;
+	if(exp->writer) shm_unlink(exp->name);
+	munmap(exp->hdr, exp->size);
+	free(exp->name);
+	free(exp);
+}
@@ -0,0 +1,170 @@
+/*
+ * il_shm_export.h
+ *
+ * Export of a live memory image in a named POSIX shared memory
+ * segment, so external visualisation and test tools can map it
+ * read-only and read it without any help from the host.
+ *
+ * Segment layout (all offsets in bytes from the start, host byte order)
+ *
+ *   0   il_shm_header
+ *       magic        "ILMI" (IL_SHM_MAGIC)
+ *       version      IL_SHM_VERSION
+ *       banks        4
+ *       bank_size    registers per bank
+ *       image_offset offset of the image, image_size its size
+ *       bank_offset  offset of each bank:
+ *                      [0] 0xxxx  uint8_t  per bit (0 or 1)
+ *                      [1] 1xxxx  uint8_t  per bit
+ *                      [2] 3xxxx  uint16_t per register
+ *                      [3] 4xxxx  uint16_t per register
+ *                    register xNNNN is element NNNN-1 of its bank
+ *       seq          one seqlock counter per bank
+ *       scans        completed scans of the exporting unit
+ *   image_offset  il_memory_image
+ *
+ * Seqlock protocol - the writer makes seq[bank] odd before changing a
+ * bank and even again after. A reader reads seq[bank] (retry while it
+ * is odd), copies the bank, then reads seq[bank] again and retries if
+ * it changed. il_shm_read_bank() and il_shm_read_image() implement this.
+ *
+ * The segment holds a published copy, not the live image. The
+ * exporting unit scans its own image and il_unit_scan() publishes it
+ * at the end of each scan, so readers never wait for a scan to finish
+ * and always see whole scans. The cost is a compare of the whole
+ * image (4 * IL_IMAGE_BANK_SIZE registers) plus a copy of each changed
+ * bank on every scan of an exported unit. Units without an export pay
+ * nothing.
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+
+#ifndef IL_SHM_EXPORT_H_
+#define IL_SHM_EXPORT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "il_interpreter.h"
+
+#define IL_SHM_MAGIC   0x494C4D49UL  // "ILMI"
+#define IL_SHM_VERSION 1
+
+/* Bit masks of banks for il_shm_export_begin()/end() */
+#define IL_SHM_BANK(b)     (1U << (b))
+#define IL_SHM_ALL_BANKS   0x0FU
+
+/* Header at the start of every exported segment */
+typedef struct{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t banks;
+	uint32_t bank_size;
+	uint32_t image_offset;
+	uint32_t image_size;
+	uint32_t bank_offset[4];
+	uint32_t seq[4];
+	uint64_t scans;
+} il_shm_header;
+
+typedef struct il_shm_export il_shm_export;
+
+/* Create a named segment and copy the context's current memory image
+ * into it. The context keeps its own image - il_shm_export_publish()
+ * copies it into the segment. Fails if the name already exists, so a
+ * running export is never taken over; remove a stale segment left by
+ * a crashed host with shm_unlink() first.
+ *
+ * @param name - POSIX shared memory name, e.g. "/il_unit_0001"
+ * @param ctx  - a context initialised with il_interp_ctx_init_image()
+ * @return - the export, or NULL on failure or if name is in use
+ */
+il_shm_export * il_shm_export_create(const char *name, il_context *ctx);
+
+/* Mark banks as being written. Must be paired with il_shm_export_end()
+ * with the same mask. Only needed for writes made directly to the
+ * segment - il_shm_export_publish() and il_shm_export_set() bracket
+ * their own writes.
+ *
+ * @param exp  - the export
+ * @param mask - banks about to change (IL_SHM_BANK(IL_BANK_xxx))
+ */
+void il_shm_export_begin(il_shm_export *exp, unsigned mask);
+
+/* Mark banks as consistent again, and count a scan if scan is true */
+void il_shm_export_end(il_shm_export *exp, unsigned mask, bool scan);
+
+/* Copy banks of the context's image into the segment. Unchanged banks
+ * are skipped; the changed ones are bracketed together.
+ * il_unit_scan() publishes every bank at the end of each scan.
+ *
+ * @param exp  - the export
+ * @param mask - banks to copy (IL_SHM_BANK(IL_BANK_xxx))
+ * @param scan - count a completed scan
+ */
+void il_shm_export_publish(il_shm_export *exp, unsigned mask, bool scan);
+
+/* Write one register of the segment, bracketed. il_unit_input() uses
+ * this so inputs written between scans are visible straight away.
+ *
+ * @param exp   - the export
+ * @param addr  - the modbus style address
+ * @param value - the value
+ */
+void il_shm_export_set(il_shm_export *exp, uint16_t addr, uint16_t value);
+
+/* Open an exported segment read-only (external tools).
+ *
+ * @param name - POSIX shared memory name
+ * @return - the view, or NULL if missing or of an incompatible layout
+ */
+il_shm_export * il_shm_open(const char *name);
+
+/* Copy one bank consistently
+ *
+ * @param exp  - export or read-only view
+ * @param bank - IL_BANK_xxx
+ * @param dst  - destination, bank_size bytes (bit banks)
+ *               or bank_size words (word banks)
+ * @return - true if copied. false if still busy after many retries.
+ */
+bool il_shm_read_bank(const il_shm_export *exp, int bank, void *dst);
+
+/* Copy all four banks from the same moment between writes
+ *
+ * @return - true if copied. false if still busy after many retries.
+ */
+bool il_shm_read_image(const il_shm_export *exp, il_memory_image *dst);
+
+/* Get the segment header (layout information and scan count) */
+const il_shm_header * il_shm_header_of(const il_shm_export *exp);
+
+/* Release an export or a read-only view. For an export, the
+ * segment name is removed.
+ */
+void il_shm_close(il_shm_export *exp);
+
+#endif /* IL_SHM_EXPORT_H_ */
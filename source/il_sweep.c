@@ -0,0 +1,276 @@
+/*
+ * il_sweep.c
+ *
+ * Parallel parameter sweep runner.
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include "il_sweep.h"
+
+/* Running mean and variance (Welford) with min and max */
+typedef struct{
+	uint64_t n;
+	double mean;
+	double m2;
+	double min;
+	double max;
+} running;
+
+typedef struct{
+	const il_sweep_config * cfg;
+	uint32_t runs;
+	atomic_uint next_run;
+	pthread_mutex_t out_lock;
+} sweep;
+
+typedef struct{
+	sweep * s;
+	pthread_t thread;
+	il_unit unit;            // reused for every run of this worker
+	running agg[IL_SWEEP_MAX_METRICS];
+	uint64_t scans;
+	uint64_t overruns;
+} sweep_worker;
+
+static const char * const kind_name[] = { "final", "min", "max", "mean" };
+
+static void running_add(running *r, double x){
+	double d = x - r->mean;
+	if(!r->n || x < r->min) r->min = x;
+	if(!r->n || x > r->max) r->max = x;
+	r->n++;
+	r->mean += d / r->n;
+	r->m2 += d * (x - r->mean);
+}
+
+static void running_merge(running *a, const running *b){
+	double d, n;
+	if(!b->n) return;
+	if(!a->n){
+		*a = *b;
+		return;
+	}
+	n = (double)(a->n + b->n);
+	d = b->mean - a->mean;
+	a->mean += d * b->n / n;
+	a->m2 += b->m2 + d * d * a->n * b->n / n;
+	if(b->min < a->min) a->min = b->min;
+	if(b->max > a->max) a->max = b->max;
+	a->n += b->n;
+}
+
+/* splitmix64 - random parameter values */
+static uint64_t mix(uint64_t *state){
+	uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+/* Work out the parameter values of a run */
+static void param_values(const il_sweep_config *cfg, uint32_t run, uint16_t *value){
+	uint64_t state = ((uint64_t)cfg->seed << 32) | run;
+	uint32_t p, idx = run;
+
+	for(p = 0; p < cfg->nparams; p++){
+		const il_sweep_param * par = &cfg->params[p];
+		uint32_t range = (uint32_t)par->hi - par->lo;
+		if(cfg->random){
+			value[p] = (uint16_t)(par->lo + mix(&state) % (range + 1));
+		} else {
+			uint32_t steps = par->steps ? par->steps : 1;
+			uint32_t k = idx % steps;
+			idx /= steps;
+			value[p] = (steps == 1) ? par->lo : (uint16_t)(par->lo + (uint64_t)range * k / (steps - 1));
+		}
+	}
+}
+
+/* Execute one run and record its row */
+static void run_one(sweep_worker *w, uint32_t run){
+	const il_sweep_config * cfg = w->s->cfg;
+	il_unit * u = &w->unit;
+	uint16_t value[IL_SWEEP_MAX_PARAMS];
+	double result[IL_SWEEP_MAX_METRICS];
+	uint32_t lo[IL_SWEEP_MAX_METRICS], hi[IL_SWEEP_MAX_METRICS];
+	uint64_t sum[IL_SWEEP_MAX_METRICS];
+	uint32_t p, m, scan;
+
+	// Fresh state - copy the base image, reset the machine
+	if(cfg->base) u->image = *cfg->base;
+	else          memset(&u->image, 0, sizeof(u->image));
+	il_interp_ctx_init_image(&u->ctx, &u->image);
+	u->scans = 0;
+	u->overruns = 0;
+
+	param_values(cfg, run, value);
+	for(p = 0; p < cfg->nparams; p++){
+		il_image_set(&u->image, cfg->params[p].addr, value[p], false);
+	}
+	for(m = 0; m < cfg->nmetrics; m++){
+		lo[m] = 65535;
+		hi[m] = 0;
+		sum[m] = 0;
+	}
+
+	for(scan = 0; scan < cfg->scans; scan++){
+		if(cfg->before_scan) cfg->before_scan(u, run, scan, cfg->user);
+		il_unit_scan(u);
+		for(m = 0; m < cfg->nmetrics; m++){
+			uint16_t v = il_image_get(&u->image, cfg->metrics[m].addr, false);
+			if(v < lo[m]) lo[m] = v;
+			if(v > hi[m]) hi[m] = v;
+			sum[m] += v;
+		}
+	}
+
+	for(m = 0; m < cfg->nmetrics; m++){
+		switch(cfg->metrics[m].kind){
+		case IL_SWEEP_MIN:  result[m] = cfg->scans ? lo[m] : 0; break;
+		case IL_SWEEP_MAX:  result[m] = hi[m]; break;
+		case IL_SWEEP_MEAN: result[m] = cfg->scans ? (double)sum[m] / cfg->scans : 0; break;
+		default: result[m] = il_image_get(&u->image, cfg->metrics[m].addr, false);
+		}
+		running_add(&w->agg[m], result[m]);
+	}
+	w->scans += u->scans;
+	w->overruns += u->overruns;
+
+	if(cfg->csv){
+		char line[32 * (IL_SWEEP_MAX_PARAMS + IL_SWEEP_MAX_METRICS + 1)];
+		int n = sprintf(line, "%u", run);
+		for(p = 0; p < cfg->nparams; p++) n += sprintf(line + n, ",%u", value[p]);
+		for(m = 0; m < cfg->nmetrics; m++) n += sprintf(line + n, ",%.6g", result[m]);
+		line[n++] = '\n';
+		line[n] = 0;
+		pthread_mutex_lock(&w->s->out_lock);
+		fputs(line, cfg->csv);
+		pthread_mutex_unlock(&w->s->out_lock);
+	}
+}
+
+static void * worker_main(void *arg){
+	sweep_worker * w = arg;
+	unsigned run;
+	while((run = atomic_fetch_add(&w->s->next_run, 1)) < w->s->runs){
+		run_one(w, run);
+	}
+	return NULL;
+}
+
+/* Number of runs in the sweep, 0 if invalid */
+static uint32_t count_runs(const il_sweep_config *cfg){
+	uint64_t runs = 1;
+	uint32_t p;
+
+	if(cfg->nparams > IL_SWEEP_MAX_PARAMS || cfg->nmetrics > IL_SWEEP_MAX_METRICS) return 0;
+	for(p = 0; p < cfg->nparams; p++){
+		if(cfg->params[p].hi < cfg->params[p].lo) return 0;
+	}
+	if(cfg->random) return cfg->samples;
+	for(p = 0; p < cfg->nparams; p++){
+		runs *= cfg->params[p].steps ? cfg->params[p].steps : 1;
+		if(runs > UINT32_MAX) return 0;
+	}
+	return (uint32_t)runs;
+}
+
+/******************************************
+ * Interface functions
+ ******************************************/
+
+/* Run a sweep */
+bool il_sweep_run(const il_sweep_config *cfg, il_sweep_result *result){
+	sweep s;
+	sweep_worker * w;
+	running agg[IL_SWEEP_MAX_METRICS];
+	int nthreads = cfg->threads, started, i;
+	uint32_t m, p;
+
+	memset(result, 0, sizeof(*result));
+	s.runs = count_runs(cfg);
+	if(!s.runs) return false;
+	s.cfg = cfg;
+	atomic_init(&s.next_run, 0);
+	pthread_mutex_init(&s.out_lock, NULL);
+
+	if(nthreads <= 0) nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if(nthreads <= 0) nthreads = 1;
+	if((uint32_t)nthreads > s.runs) nthreads = (int)s.runs;
+	w = calloc(nthreads, sizeof(sweep_worker));
+	if(!w){
+		pthread_mutex_destroy(&s.out_lock);
+		return false;
+	}
+
+	if(cfg->csv){
+		fputs("run", cfg->csv);
+		for(p = 0; p < cfg->nparams; p++) fprintf(cfg->csv, ",p%05u", cfg->params[p].addr);
+		for(m = 0; m < cfg->nmetrics; m++){
+			fprintf(cfg->csv, ",%05u_%s", cfg->metrics[m].addr, kind_name[cfg->metrics[m].kind & 3]);
+		}
+		fputc('\n', cfg->csv);
+	}
+
+	for(started = 0; started < nthreads; started++){
+		w[started].s = &s;
+		il_unit_init(&w[started].unit);
+		w[started].unit.program = (il_line *)cfg->program;   // shared, never freed here
+		w[started].unit.lines = cfg->lines;
+		if(pthread_create(&w[started].thread, NULL, worker_main, &w[started])) break;
+	}
+	if(started == 0){
+		free(w);
+		pthread_mutex_destroy(&s.out_lock);
+		return false;
+	}
+	// If some threads failed to start the others do all the runs
+	memset(agg, 0, sizeof(agg));
+	for(i = 0; i < started; i++){
+		pthread_join(w[i].thread, NULL);
+		for(m = 0; m < cfg->nmetrics; m++) running_merge(&agg[m], &w[i].agg[m]);
+		result->scans += w[i].scans;
+		result->overruns += w[i].overruns;
+	}
+
+	result->runs = s.runs;
+	for(m = 0; m < cfg->nmetrics; m++){
+		result->metric[m].min = agg[m].min;
+		result->metric[m].max = agg[m].max;
+		result->metric[m].mean = agg[m].mean;
+		result->metric[m].stddev = agg[m].n > 1 ? sqrt(agg[m].m2 / (agg[m].n - 1)) : 0.0;
+	}
+	free(w);
+	pthread_mutex_destroy(&s.out_lock);
+	return true;
+}
@@ -0,0 +1,119 @@
+/*
+ * il_sweep.h
+ *
+ * Parameter sweep runner. Runs one program many times, each run from
+ * the same base memory image with a different set of parameter
+ * values written into it, in parallel on all cores and in simulated
+ * time (a fixed number of scans per run). Input schedules and fault
+ * injection hook in through a callback before every scan.
+ *
+ * Each run gives one row of metrics. Rows are streamed to a CSV file
+ * as runs finish (in completion order, with the run number) and folded
+ * into running aggregates, so memory use does not depend on the
+ * number of runs.
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+
+#ifndef IL_SWEEP_H_
+#define IL_SWEEP_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "il_unit.h"
+
+#define IL_SWEEP_MAX_PARAMS  16
+#define IL_SWEEP_MAX_METRICS 16
+
+/* A parameter - a register written before the first scan */
+typedef struct{
+	uint16_t addr;
+	uint16_t lo;        // range of values
+	uint16_t hi;
+	uint32_t steps;     // grid points from lo to hi (grid sweeps only)
+} il_sweep_param;
+
+/* Metric kinds - what is recorded of a register over a run */
+#define IL_SWEEP_FINAL 0   // value after the last scan
+#define IL_SWEEP_MIN   1   // minimum after any scan
+#define IL_SWEEP_MAX   2   // maximum after any scan
+#define IL_SWEEP_MEAN  3   // mean over the scans
+
+typedef struct{
+	uint16_t addr;
+	uint8_t kind;
+} il_sweep_metric;
+
+typedef struct{
+	const il_line *program;        // shared read-only by all runs
+	uint16_t lines;
+	const il_memory_image *base;   // starting image (NULL = all zero)
+
+	const il_sweep_param *params;
+	uint32_t nparams;
+	bool random;         // false: every grid point. true: random samples
+	uint32_t samples;    // number of random runs
+	uint32_t seed;       // random run n depends only on seed and n
+
+	uint32_t scans;      // scans per run
+	const il_sweep_metric *metrics;
+	uint32_t nmetrics;
+	int threads;         // 0 = one per available CPU
+
+	/* Optional - set inputs or inject faults before each scan */
+	void (*before_scan)(il_unit *unit, uint32_t run, uint32_t scan, void *user);
+	void *user;
+
+	FILE *csv;           // results table, or NULL for aggregates only
+} il_sweep_config;
+
+/* Aggregate of one metric over all runs */
+typedef struct{
+	double min;
+	double max;
+	double mean;
+	double stddev;
+} il_sweep_aggregate;
+
+typedef struct{
+	uint32_t runs;
+	uint64_t scans;
+	uint64_t overruns;   // scans stopped by IL_SCAN_STEP_LIMIT
+	il_sweep_aggregate metric[IL_SWEEP_MAX_METRICS];
+} il_sweep_result;
+
+/* Run a sweep. Returns when all runs are done.
+ *
+ * @param cfg    - the sweep
+ * @param result - aggregates over all runs
+ * @return - true if done. false if the configuration is invalid
+ *           or threads or memory could not be had.
+ */
+bool il_sweep_run(const il_sweep_config *cfg, il_sweep_result *result);
+
+#endif /* IL_SWEEP_H_ */
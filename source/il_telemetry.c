@@ -0,0 +1,229 @@
+/*
+ * il_telemetry.c
+ *
+ * Delta encoding of memory image changes for radio telemetry estimates.
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+#include <string.h>
+#include "il_telemetry.h"
+
+/* Unchanged registers worth carrying to join two changed ranges.
+ * An unchanged word costs one byte, an unchanged bit one eighth,
+ * and a new block header at least three bytes. */
+#define MERGE_GAP_WORDS 2
+#define MERGE_GAP_BITS  16
+
+#define N IL_IMAGE_BANK_SIZE
+
+/* Message writer. Keeps counting past the end of the buffer so
+ * the full size is known. */
+typedef struct{
+	uint8_t *buf;
+	size_t size;
+	size_t len;
+} writer;
+
+static void put(writer *w, uint8_t b){
+	if(w->buf && w->len < w->size) w->buf[w->len] = b;
+	w->len++;
+}
+
+static void put_varint(writer *w, uint32_t v){
+	while(v >= 0x80){
+		put(w, (uint8_t)(v | 0x80));
+		v >>= 7;
+	}
+	put(w, (uint8_t)v);
+}
+
+/* Find the next differing byte from i. Compares 8 bytes at a
+ * time, which the compiler can widen further. */
+static size_t next_diff8(const uint8_t *a, const uint8_t *b, size_t i, size_t n){
+	while(i + 8 <= n){
+		uint64_t x, y;
+		memcpy(&x, a + i, 8);
+		memcpy(&y, b + i, 8);
+		if(x != y) break;
+		i += 8;
+	}
+	while(i < n && a[i] == b[i]) i++;
+	return i;
+}
+
+/* Find the next differing word from i, 4 words at a time */
+static size_t next_diff16(const uint16_t *a, const uint16_t *b, size_t i, size_t n){
+	while(i + 4 <= n){
+		uint64_t x, y;
+		memcpy(&x, a + i, 8);
+		memcpy(&y, b + i, 8);
+		if(x != y) break;
+		i += 4;
+	}
+	while(i < n && a[i] == b[i]) i++;
+	return i;
+}
+
+/* Encode the changed ranges of a bit bank */
+static void encode_bits(writer *w, int bank, const uint8_t *cur, const uint8_t *ref){
+	size_t i = next_diff8(cur, ref, 0, N), prev_end = 0;
+
+	while(i < N){
+		size_t start = i, end = i + 1, k;
+		// Extend while the next change is close
+		while((i = next_diff8(cur, ref, end, N)) < N && i - end <= MERGE_GAP_BITS) end = i + 1;
+
+		put(w, (uint8_t)bank);
+		put_varint(w, (uint32_t)(start - prev_end));
+		put_varint(w, (uint32_t)(end - start));
+		for(k = start; k < end; k += 8){
+			uint8_t byte = 0;
+			size_t b;
+			for(b = 0; b < 8 && k + b < end; b++) byte |= (uint8_t)((cur[k + b] & 1) << b);
+			put(w, byte);
+		}
+		prev_end = end;
+	}
+}
+
+/* Encode the changed ranges of a word bank as deltas */
+static void encode_words(writer *w, int bank, const uint16_t *cur, const uint16_t *ref){
+	size_t i = next_diff16(cur, ref, 0, N), prev_end = 0;
+
+	while(i < N){
+		size_t start = i, end = i + 1, k;
+		while((i = next_diff16(cur, ref, end, N)) < N && i - end <= MERGE_GAP_WORDS) end = i + 1;
+
+		put(w, (uint8_t)bank);
+		put_varint(w, (uint32_t)(start - prev_end));
+		put_varint(w, (uint32_t)(end - start));
+		for(k = start; k < end; k++){
+			// Zigzag, in unsigned arithmetic: 0, -1, 1, -2 .. -> 0, 1, 2, 3 ..
+			uint16_t d = (uint16_t)(cur[k] - ref[k]);
+			put_varint(w, (uint16_t)(((uint32_t)d << 1) ^ (0u - (d >> 15))));
+		}
+		prev_end = end;
+	}
+}
+
+/* Message reader */
+typedef struct{
+	const uint8_t *p;
+	const uint8_t *end;
+	bool bad;
+} reader;
+
+static uint8_t get(reader *r){
+	if(r->p >= r->end){
+		r->bad = true;
+		return IL_TELEMETRY_END;
+	}
+	return *r->p++;
+}
+
+static uint32_t get_varint(reader *r){
+	uint32_t v = 0;
+	int shift;
+	for(shift = 0; shift < 35; shift += 7){
+		uint8_t b = get(r);
+		v |= (uint32_t)(b & 0x7F) << shift;
+		if(!(b & 0x80)) return v;
+	}
+	r->bad = true;
+	return 0;
+}
+
+/********************************************
+ * Interface functions
+ ********************************************/
+
+/* Start an encoder */
+void il_telemetry_init(il_telemetry_tx *tx, const il_memory_image *image){
+	if(image) tx->ref = *image;
+	else      memset(&tx->ref, 0, sizeof(tx->ref));
+	tx->messages = 0;
+	tx->bytes = 0;
+	tx->last_bytes = 0;
+}
+
+/* Encode the changes since the last message */
+size_t il_telemetry_encode(il_telemetry_tx *tx, const il_memory_image *image, uint8_t *buf, size_t size){
+	writer w = { buf, size, 0 };
+	int b;
+
+	for(b = 0; b < 2; b++){
+		encode_bits(&w, b, image->bits[b], tx->ref.bits[b]);
+	}
+	for(b = 0; b < 2; b++){
+		encode_words(&w, IL_BANK_IREG + b, image->words[b], tx->ref.words[b]);
+	}
+	if(w.len == 0){
+		if(buf) tx->last_bytes = 0;
+		return 0;
+	}
+	put(&w, IL_TELEMETRY_END);
+
+	if(buf && w.len <= size){
+		tx->ref = *image;
+		tx->messages++;
+		tx->bytes += w.len;
+		tx->last_bytes = (uint32_t)w.len;
+	}
+	return w.len;
+}
+
+/* Apply a message to a receiver's image */
+bool il_telemetry_decode(const uint8_t *buf, size_t len, il_memory_image *image){
+	reader r = { buf, buf + len, false };
+	size_t pos[4] = { 0, 0, 0, 0 };
+	uint8_t bank;
+
+	while((bank = get(&r)) != IL_TELEMETRY_END){
+		uint32_t start, count, k;
+		if(bank > IL_BANK_HREG) return false;
+		start = (uint32_t)pos[bank] + get_varint(&r);
+		count = get_varint(&r);
+		if(r.bad || start + (uint64_t)count > N) return false;
+
+		if(bank < IL_BANK_IREG){
+			for(k = 0; k < count; k += 8){
+				uint8_t byte = get(&r), b;
+				for(b = 0; b < 8 && k + b < count; b++){
+					image->bits[bank][start + k + b] = (byte >> b) & 1;
+				}
+			}
+		} else {
+			uint16_t * words = image->words[bank - IL_BANK_IREG];
+			for(k = 0; k < count; k++){
+				uint16_t z = (uint16_t)get_varint(&r);
+				words[start + k] += (uint16_t)((z >> 1) ^ -(z & 1));
+			}
+		}
+		if(r.bad) return false;
+		pos[bank] = start + count;
+	}
+	return !r.bad && r.p == r.end;
+}
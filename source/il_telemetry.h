@@ -0,0 +1,103 @@
+/*
+ * il_telemetry.h
+ *
+ * Delta encoding of memory image changes, to estimate what a change
+ * of state on a unit would cost on the radio channel.
+ *
+ * The encoder keeps the image as last sent and encodes the registers
+ * that differ from it. The decoder applies a message to the
+ * receiver's copy, which then equals the sender's image.
+ *
+ * Message format
+ *
+ *   blocks, in order of bank and address:
+ *     u8      bank (IL_BANK_xxx)
+ *     varint  first register - end of the previous block in the same
+ *             bank (or the register index for the first block of a bank)
+ *     varint  number of registers
+ *     bit banks:  the new bits, packed 8 per byte, first register in bit 0
+ *     word banks: per register the zigzag varint of (new - old) as int16
+ *   u8      IL_TELEMETRY_END
+ *
+ *   varint - 7 bits per byte, low group first, bit 7 set if more follow
+ *
+ * Nearby changes are merged into one block when the unchanged
+ * registers between them cost less than a new block header.
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+
+#ifndef IL_TELEMETRY_H_
+#define IL_TELEMETRY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "il_image.h"
+
+#define IL_TELEMETRY_END 0xFF
+
+/* Bound on the message size, for any pattern of changes */
+#define IL_TELEMETRY_MAX_MESSAGE (12UL * IL_IMAGE_BANK_SIZE + 64)
+
+/* Encoder state of one unit */
+typedef struct{
+	il_memory_image ref;     // image as last sent
+	uint64_t messages;       // messages encoded
+	uint64_t bytes;          // total bytes encoded
+	uint32_t last_bytes;     // size of the last message (0 = no change)
+} il_telemetry_tx;
+
+/* Start an encoder. The receiver is assumed to start from the same image.
+ *
+ * @param tx    - encoder state
+ * @param image - the image the receiver has (NULL = all zero)
+ */
+void il_telemetry_init(il_telemetry_tx *tx, const il_memory_image *image);
+
+/* Encode the changes since the last message
+ *
+ * @param tx    - encoder state
+ * @param image - the unit's current image
+ * @param buf   - buffer for the message (NULL to only measure)
+ * @param size  - size of buf, IL_TELEMETRY_MAX_MESSAGE is always enough
+ * @return - message length, 0 if nothing changed. When only measuring,
+ *           or if buf is too small, the reference is not updated.
+ */
+size_t il_telemetry_encode(il_telemetry_tx *tx, const il_memory_image *image, uint8_t *buf, size_t size);
+
+/* Apply a message to a receiver's image
+ *
+ * @param buf   - the message
+ * @param len   - message length
+ * @param image - the receiver's image
+ * @return - true if applied. false if the message is malformed (the
+ *           image may then be partly updated).
+ */
+bool il_telemetry_decode(const uint8_t *buf, size_t len, il_memory_image *image);
+
+#endif /* IL_TELEMETRY_H_ */
@@ -0,0 +1,459 @@
+/*
+ * il_tier.c
+ *
+ * Tiered execution manager.
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "il_tier.h"
+#include "il_compile.h"
+
+#define TIER_EVENTS     4096   // event ring size
+#define TIER_HOT_SCANS  100    // default hot_scans
+
+/* A preparation request. The program is copied, so the unit may
+ * load a new one while the request is in progress. */
+typedef struct tier_job{
+	struct il_tier_slot * slot;
+	uint32_t generation;
+	il_line * program;
+	uint16_t lines;
+	il_compiled code;
+	bool ok;
+	uint64_t ns;
+	struct tier_job * next;
+} tier_job;
+
+/* Per unit state. Only the thread scanning the unit touches it,
+ * except done, which a preparation thread sets. */
+struct il_tier_slot{
+	il_tier * tier;
+	il_unit * unit;
+	int state;                     // IL_TIER_xxx
+	uint32_t generation;           // counts program changes
+	bool inflight;                 // a job is queued or being prepared
+	_Atomic(tier_job *) done;      // finished job, waiting for a scan boundary
+	uint64_t ref_scans;            // since the program was loaded
+	uint64_t ref_lines;
+	il_compiled code;              // the compiled form on IL_TIER_COMPILED
+	il_memory_image * shadow;      // reference copy for verification
+	uint32_t verify_left;
+	uint32_t verify_count;
+
+	uint64_t reference_scans;      // statistics, for the life of the slot
+	uint64_t compiled_scans;
+	uint64_t verified_scans;
+	uint64_t promotions;
+	uint64_t demotions;
+	uint64_t prep_ns;
+	uint64_t prep_max_ns;
+};
+
+struct il_tier{
+	il_tier_config cfg;
+	pthread_mutex_t lock;          // slots, queue and events
+	pthread_cond_t cond;
+	bool quit;
+	tier_job * head;               // queue of jobs
+	tier_job * tail;
+	pthread_t * thread;
+	int nthreads;
+
+	struct il_tier_slot ** slot;
+	uint32_t nslots;
+	uint32_t slot_capacity;
+
+	il_tier_event event[TIER_EVENTS];
+	uint32_t ev_head;
+	uint32_t ev_count;
+	uint64_t lost_events;
+};
+
+static uint64_t now_ns(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void post_event(struct il_tier_slot *s, int event, uint64_t prep_ns, uint16_t generic){
+	il_tier * t = s->tier;
+	il_tier_event * e;
+
+	pthread_mutex_lock(&t->lock);
+	if(t->ev_count == TIER_EVENTS){
+		t->ev_head = (t->ev_head + 1) % TIER_EVENTS;   // drop the oldest
+		t->ev_count--;
+		t->lost_events++;
+	}
+	e = &t->event[(t->ev_head + t->ev_count) % TIER_EVENTS];
+	t->ev_count++;
+	e->unit = s->unit;
+	e->event = event;
+	e->scans = s->ref_scans;
+	e->lines = s->ref_lines;
+	e->prep_ns = prep_ns;
+	e->generic = generic;
+	pthread_mutex_unlock(&t->lock);
+}
+
+/* Reference interpreter scan - as il_unit_scan() without a tier */
+static uint32_t reference_scan(il_context *ctx, const il_line *p, uint16_t lines, bool *overrun){
+	uint16_t line = 0;
+	uint32_t steps = 0;
+
+	*overrun = false;
+	while(line < lines){
+		if(++steps > IL_SCAN_STEP_LIMIT){
+			*overrun = true;
+			return IL_SCAN_STEP_LIMIT;
+		}
+		line = il_interp_ctx_execute(ctx, p[line].cmd, p[line].value, line);
+	}
+	return steps;
+}
+
+/* Compare the machine state left by the two tiers */
+static bool same_state(const il_context *a, const il_context *b){
+	int i;
+	// Floats compared bit for bit, so NaN results match
+	if(a->accum != b->accum || memcmp(&a->faccum, &b->faccum, sizeof(float))
+			|| a->eval_stack_top != b->eval_stack_top
+			|| a->call_stack_top != b->call_stack_top) return false;
+	for(i = 0; i < a->eval_stack_top && i < IL_EVAL_STACK_MAX_DEPTH; i++){
+		if(a->eval_stack[i].accum != b->eval_stack[i].accum
+				|| memcmp(&a->eval_stack[i].faccum, &b->eval_stack[i].faccum, sizeof(float))
+				|| a->eval_stack[i].command != b->eval_stack[i].command) return false;
+	}
+	for(i = 0; i < a->call_stack_top && i < IL_CALL_STACK_MAX_DEPTH; i++){
+		if(a->call_stack[i] != b->call_stack[i]) return false;
+	}
+	return memcmp(a->image, b->image, sizeof(il_memory_image)) == 0;
+}
+
+/******************************************
+ * Preparation threads
+ ******************************************/
+
+static void * prep_main(void *arg){
+	il_tier * t = arg;
+	tier_job * j;
+
+	for(;;){
+		pthread_mutex_lock(&t->lock);
+		while(!t->quit && !t->head) pthread_cond_wait(&t->cond, &t->lock);
+		if(t->quit){
+			pthread_mutex_unlock(&t->lock);
+			return NULL;
+		}
+		j = t->head;
+		t->head = j->next;
+		if(!t->head) t->tail = NULL;
+		pthread_mutex_unlock(&t->lock);
+
+		j->ns = now_ns();
+		j->ok = il_compile(j->program, j->lines, &j->code);
+		j->ns = now_ns() - j->ns;
+		atomic_store(&j->slot->done, j);
+	}
+}
+
+static void free_job(tier_job *j){
+	if(j->ok) il_compiled_free(&j->code);
+	free(j->program);
+	free(j);
+}
+
+/* Queue the unit's program for preparation */
+static void queue_job(struct il_tier_slot *s){
+	il_tier * t = s->tier;
+	il_unit * u = s->unit;
+	tier_job * j = calloc(1, sizeof(tier_job));
+
+	if(j) j->program = malloc((u->lines ? u->lines : 1) * sizeof(il_line));
+	if(!j || !j->program){
+		free(j);
+		return;    // try again after the next scan
+	}
+	memcpy(j->program, u->program, u->lines * sizeof(il_line));
+	j->lines = u->lines;
+	j->slot = s;
+	j->generation = s->generation;
+
+	pthread_mutex_lock(&t->lock);
+	if(t->tail) t->tail->next = j;
+	else        t->head = j;
+	t->tail = j;
+	pthread_cond_signal(&t->cond);
+	pthread_mutex_unlock(&t->lock);
+
+	s->inflight = true;
+	s->state = IL_TIER_PREPARING;
+	post_event(s, IL_TIER_EV_QUEUED, 0, 0);
+}
+
+/* Take a finished job at a scan boundary */
+static void collect_job(struct il_tier_slot *s){
+	tier_job * j = atomic_exchange(&s->done, NULL);
+
+	if(!j) return;
+	s->inflight = false;
+	if(j->generation != s->generation){
+		free_job(j);    // prepared for a program that has since been replaced
+		return;
+	}
+	s->prep_ns += j->ns;
+	if(j->ns > s->prep_max_ns) s->prep_max_ns = j->ns;
+	if(!j->ok || (!s->shadow && !(s->shadow = malloc(sizeof(il_memory_image))))){
+		s->state = IL_TIER_DEMOTED;
+		post_event(s, IL_TIER_EV_FAILED, j->ns, 0);
+		free_job(j);
+		return;
+	}
+	s->code = j->code;
+	j->ok = false;      // the slot owns the code now
+	s->state = IL_TIER_COMPILED;
+	s->verify_left = s->tier->cfg.verify_scans;
+	s->verify_count = 0;
+	s->promotions++;
+	post_event(s, IL_TIER_EV_PROMOTED, j->ns, s->code.generic);
+	free_job(j);
+}
+
+/* Scan on the compiled tier, checking against the reference if due */
+static void compiled_scan(struct il_tier_slot *s){
+	il_unit * u = s->unit;
+	il_context * ctx = &u->ctx;
+	il_context ref;
+	bool overrun, ref_overrun, verify = false;
+
+	if(s->verify_left){
+		s->verify_left--;
+		verify = true;
+	} else if(s->tier->cfg.verify_interval && ++s->verify_count >= s->tier->cfg.verify_interval){
+		s->verify_count = 0;
+		verify = true;
+	}
+
+	if(!verify){
+		il_compiled_scan(&s->code, ctx, IL_SCAN_STEP_LIMIT, &overrun);
+		if(overrun) u->overruns++;
+		s->compiled_scans++;
+		return;
+	}
+
+	// Reference scan on a copy, then the compiled scan for real
+	ref = *ctx;
+	*s->shadow = *ctx->image;
+	ref.image = s->shadow;
+	reference_scan(&ref, u->program, u->lines, &ref_overrun);
+	il_compiled_scan(&s->code, ctx, IL_SCAN_STEP_LIMIT, &overrun);
+	s->compiled_scans++;
+	s->verified_scans++;
+
+	if(overrun != ref_overrun || !same_state(ctx, &ref)){
+		// Keep the reference result
+		il_memory_image * image = ctx->image;
+		*image = *s->shadow;
+		*ctx = ref;
+		ctx->image = image;
+		il_compiled_free(&s->code);
+		s->state = IL_TIER_DEMOTED;
+		s->demotions++;
+		post_event(s, IL_TIER_EV_DEMOTED, 0, 0);
+	}
+	if(ref_overrun) u->overruns++;
+}
+
+/******************************************
+ * Interface functions
+ ******************************************/
+
+/* Create a tier manager */
+il_tier * il_tier_create(const il_tier_config *cfg){
+	il_tier * t = calloc(1, sizeof(il_tier));
+	int n;
+
+	if(!t) return NULL;
+	if(cfg) t->cfg = *cfg;
+	if(!t->cfg.hot_scans) t->cfg.hot_scans = TIER_HOT_SCANS;
+	n = t->cfg.threads > 0 ? t->cfg.threads : 1;
+	pthread_mutex_init(&t->lock, NULL);
+	pthread_cond_init(&t->cond, NULL);
+	t->thread = calloc(n, sizeof(pthread_t));
+	if(!t->thread){
+		il_tier_destroy(t);
+		return NULL;
+	}
+	for(t->nthreads = 0; t->nthreads < n; t->nthreads++){
+		if(pthread_create(&t->thread[t->nthreads], NULL, prep_main, t)){
+			il_tier_destroy(t);
+			return NULL;
+		}
+	}
+	return t;
+}
+
+/* Attach a unit */
+bool il_tier_attach(il_tier *t, il_unit *unit){
+	struct il_tier_slot * s;
+
+	if(unit->tier) return false;
+	s = calloc(1, sizeof(struct il_tier_slot));
+	if(!s) return false;
+	s->tier = t;
+	s->unit = unit;
+	s->state = IL_TIER_REFERENCE;
+	atomic_init(&s->done, NULL);
+
+	pthread_mutex_lock(&t->lock);
+	if(t->nslots == t->slot_capacity){
+		uint32_t cap = t->slot_capacity ? 2 * t->slot_capacity : 64;
+		struct il_tier_slot ** a = realloc(t->slot, cap * sizeof(*a));
+		if(!a){
+			pthread_mutex_unlock(&t->lock);
+			free(s);
+			return false;
+		}
+		t->slot = a;
+		t->slot_capacity = cap;
+	}
+	t->slot[t->nslots++] = s;
+	pthread_mutex_unlock(&t->lock);
+
+	unit->tier = s;
+	return true;
+}
+
+/* Scan an attached unit on its current tier */
+void il_tier_scan(il_unit *unit){
+	struct il_tier_slot * s = unit->tier;
+	bool overrun;
+
+	if(s->inflight) collect_job(s);
+
+	// The compiled form needs a flat image, and no debugger watching writes
+	if(s->state == IL_TIER_COMPILED && unit->ctx.image && !unit->ctx.watch_map){
+		compiled_scan(s);
+		return;
+	}
+
+	s->ref_lines += reference_scan(&unit->ctx, unit->program, unit->lines, &overrun);
+	s->ref_scans++;
+	s->reference_scans++;
+	if(overrun) unit->overruns++;
+
+	if(s->state == IL_TIER_REFERENCE && !s->inflight && unit->lines
+			&& (s->ref_scans >= s->tier->cfg.hot_scans
+			|| (s->tier->cfg.hot_lines && s->ref_lines >= s->tier->cfg.hot_lines))){
+		queue_job(s);
+	}
+}
+
+/* Return an attached unit to the reference tier */
+void il_tier_reset(il_unit *unit){
+	struct il_tier_slot * s = unit->tier;
+
+	if(s->state == IL_TIER_COMPILED) il_compiled_free(&s->code);
+	s->generation++;     // any job in flight is discarded when it finishes
+	s->state = IL_TIER_REFERENCE;
+	s->ref_scans = 0;
+	s->ref_lines = 0;
+	post_event(s, IL_TIER_EV_RESET, 0, 0);
+}
+
+/* Read and remove the oldest tier decisions */
+uint32_t il_tier_events(il_tier *t, il_tier_event *events, uint32_t max){
+	uint32_t n = 0;
+
+	pthread_mutex_lock(&t->lock);
+	while(n < max && t->ev_count){
+		events[n++] = t->event[t->ev_head];
+		t->ev_head = (t->ev_head + 1) % TIER_EVENTS;
+		t->ev_count--;
+	}
+	pthread_mutex_unlock(&t->lock);
+	return n;
+}
+
+/* Get the manager statistics */
+void il_tier_get_stats(il_tier *t, il_tier_stats *stats){
+	uint32_t i;
+
+	memset(stats, 0, sizeof(*stats));
+	pthread_mutex_lock(&t->lock);
+	stats->units = t->nslots;
+	for(i = 0; i < t->nslots; i++){
+		const struct il_tier_slot * s = t->slot[i];
+		stats->tier[s->state]++;
+		stats->promotions += s->promotions;
+		stats->demotions += s->demotions;
+		stats->reference_scans += s->reference_scans;
+		stats->compiled_scans += s->compiled_scans;
+		stats->verified_scans += s->verified_scans;
+		stats->prep_ns += s->prep_ns;
+		if(s->prep_max_ns > stats->prep_max_ns) stats->prep_max_ns = s->prep_max_ns;
+	}
+	stats->lost_events = t->lost_events;
+	pthread_mutex_unlock(&t->lock);
+}
+
+/* Stop the preparation threads and release the manager */
+void il_tier_destroy(il_tier *t){
+	tier_job * j;
+	uint32_t i;
+	int k;
+
+	if(!t) return;
+	pthread_mutex_lock(&t->lock);
+	t->quit = true;
+	pthread_cond_broadcast(&t->cond);
+	pthread_mutex_unlock(&t->lock);
+	for(k = 0; k < t->nthreads; k++) pthread_join(t->thread[k], NULL);
+
+	while((j = t->head)){
+		t->head = j->next;
+		free_job(j);
+	}
+	for(i = 0; i < t->nslots; i++){
+		struct il_tier_slot * s = t->slot[i];
+		if((j = atomic_load(&s->done))) free_job(j);
+		if(s->state == IL_TIER_COMPILED) il_compiled_free(&s->code);
+		free(s->shadow);
+		s->unit->tier = NULL;
+		free(s);
+	}
+	free(t->slot);
+	free(t->thread);
+	pthread_mutex_destroy(&t->lock);
+	pthread_cond_destroy(&t->cond);
+	free(t);
+}
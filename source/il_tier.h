@@ -0,0 +1,138 @@
+/*
+ * il_tier.h
+ *
+ * Tiered execution of unit programs. Every attached unit starts on
+ * the reference interpreter (il_interp_ctx_execute() per line) while
+ * its scans and executed lines are counted. Once a program is hot it
+ * is compiled (il_compile.h) on a background thread, and the unit
+ * changes to the compiled form at the start of its next scan. The
+ * first compiled scans, and then one scan in every verify_interval,
+ * are also run on the reference interpreter against a copy of the
+ * memory image. If the results differ the reference result is kept
+ * and the unit is demoted to the reference interpreter for good
+ * (until a new program is loaded).
+ *
+ * Promotions, demotions and preparation times are reported through
+ * il_tier_events() and il_tier_get_stats().
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+
+#ifndef IL_TIER_H_
+#define IL_TIER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "il_unit.h"
+
+/* Tiers */
+#define IL_TIER_REFERENCE 0   // reference interpreter
+#define IL_TIER_PREPARING 1   // reference, compiled form being prepared
+#define IL_TIER_COMPILED  2   // compiled form
+#define IL_TIER_DEMOTED   3   // reference - compiled form failed or misbehaved
+
+/* Events */
+#define IL_TIER_EV_QUEUED   0   // hot program queued for preparation
+#define IL_TIER_EV_PROMOTED 1   // changed to the compiled form
+#define IL_TIER_EV_DEMOTED  2   // compiled result differed from the reference
+#define IL_TIER_EV_FAILED   3   // preparation failed (out of memory)
+#define IL_TIER_EV_RESET    4   // new program, back to the reference tier
+
+typedef struct{
+	uint32_t hot_scans;        // reference scans before preparation (0 = 100)
+	uint64_t hot_lines;        // or lines executed on the reference tier (0 = no limit)
+	uint32_t verify_scans;     // compiled scans checked straight after promotion
+	uint32_t verify_interval;  // then one scan in every verify_interval (0 = never)
+	int threads;               // preparation threads (0 = 1)
+} il_tier_config;
+
+/* A tier decision */
+typedef struct{
+	il_unit * unit;
+	uint8_t event;           // IL_TIER_EV_xxx
+	uint64_t scans;          // reference scans since the program was loaded
+	uint64_t lines;          // lines executed on the reference tier since then
+	uint64_t prep_ns;        // PROMOTED, FAILED: preparation time
+	uint16_t generic;        // PROMOTED: lines left to the generic op
+} il_tier_event;
+
+typedef struct{
+	uint32_t units;            // attached units
+	uint32_t tier[4];          // units on each tier
+	uint64_t promotions;
+	uint64_t demotions;
+	uint64_t reference_scans;
+	uint64_t compiled_scans;
+	uint64_t verified_scans;   // compiled scans checked against the reference
+	uint64_t prep_ns;          // total preparation time
+	uint64_t prep_max_ns;      // longest preparation
+	uint64_t lost_events;      // events dropped because nobody read them
+} il_tier_stats;
+
+typedef struct il_tier il_tier;
+
+/* Create a tier manager and start its preparation threads
+ *
+ * @param cfg - the settings, or NULL for the defaults
+ * @return - the manager, or NULL on failure
+ */
+il_tier * il_tier_create(const il_tier_config *cfg);
+
+/* Attach a unit. From now on il_unit_scan() of the unit goes through
+ * the manager. Must not be called while the unit is being scanned.
+ *
+ * @param tier - the manager
+ * @param unit - the unit (must stay attached until il_tier_destroy())
+ * @return - true if attached. false if out of memory or already attached.
+ */
+bool il_tier_attach(il_tier *tier, il_unit *unit);
+
+/* Scan an attached unit on its current tier (called by il_unit_scan()) */
+void il_tier_scan(il_unit *unit);
+
+/* Return an attached unit to the reference tier after its program
+ * has changed (called by il_unit_load() and il_unit_free()) */
+void il_tier_reset(il_unit *unit);
+
+/* Read and remove the oldest tier decisions
+ *
+ * @param tier   - the manager
+ * @param events - array to fill
+ * @param max    - size of events
+ * @return - number of events copied
+ */
+uint32_t il_tier_events(il_tier *tier, il_tier_event *events, uint32_t max);
+
+/* Get the manager statistics. Call between scans. */
+void il_tier_get_stats(il_tier *tier, il_tier_stats *stats);
+
+/* Stop the preparation threads, return every attached unit to the
+ * reference interpreter and release the manager. Call between scans.
+ */
+void il_tier_destroy(il_tier *tier);
+
+#endif /* IL_TIER_H_ */
@@ -0,0 +1,179 @@
+/*
+ * il_trend.c
+ *
+ * Register trend capture with min/max decimation for display.
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "il_trend.h"
+
+/* Record one sample in a trace */
+static void record(il_trend *trend, il_trace *tr, uint16_t val){
+	uint32_t i = (uint32_t)(tr->count & (tr->size - 1));
+	uint32_t b = i / IL_TREND_BLOCK;
+	tr->time[i] = trend->clock;
+	tr->value[i] = val;
+	if((i & (IL_TREND_BLOCK - 1)) == 0){  // a new block replaces an old one
+		tr->block_min[b] = tr->block_max[b] = val;
+	} else {
+		if(val < tr->block_min[b]) tr->block_min[b] = val;
+		if(val > tr->block_max[b]) tr->block_max[b] = val;
+	}
+	tr->count++;
+}
+
+/* Find the oldest sample kept at or after a time (binary search).
+ *
+ * @return - sample number (count based), count if none
+ */
+static uint64_t find(const il_trace *tr, uint64_t t){
+	uint64_t lo = tr->count > tr->size ? tr->count - tr->size : 0;
+	uint64_t hi = tr->count;
+	while(lo < hi){
+		uint64_t mid = lo + (hi - lo) / 2;
+		if(tr->time[mid & (tr->size - 1)] < t) lo = mid + 1;
+		else hi = mid;
+	}
+	return lo;
+}
+
+/* Widen min/max over samples a .. e-1. Whole blocks come from their
+ * summaries - every block between kept samples is complete and has
+ * not been overwritten. */
+static void extend(const il_trace *tr, uint64_t a, uint64_t e, uint16_t *min, uint16_t *max){
+	while(a < e){
+		uint32_t i = (uint32_t)(a & (tr->size - 1));
+		uint16_t lo, hi;
+		if((a & (IL_TREND_BLOCK - 1)) == 0 && e - a >= IL_TREND_BLOCK){
+			lo = tr->block_min[i / IL_TREND_BLOCK];
+			hi = tr->block_max[i / IL_TREND_BLOCK];
+			a += IL_TREND_BLOCK;
+		} else {
+			lo = hi = tr->value[i];
+			a++;
+		}
+		if(lo < *min) *min = lo;
+		if(hi > *max) *max = hi;
+	}
+}
+
+/********************************************
+ * Interface functions
+ ********************************************/
+
+/* Initialise a trend with no traces */
+void il_trend_init(il_trend *trend){
+	memset(trend, 0, sizeof(*trend));
+}
+
+/* Release all traces */
+void il_trend_free(il_trend *trend){
+	int i;
+	for(i = 0; i < trend->traces; i++){
+		free(trend->trace[i].time);
+		free(trend->trace[i].value);
+		free(trend->trace[i].block_min);
+		free(trend->trace[i].block_max);
+	}
+	il_trend_init(trend);
+}
+
+/* Add a trace */
+int il_trend_add(il_trend *trend, uint16_t addr, uint32_t samples, uint16_t initial){
+	il_trace * tr;
+	uint32_t size = IL_TREND_BLOCK;
+
+	if(trend->traces >= IL_TREND_MAX_TRACES) return -1;
+	while(size < samples && size < 0x80000000UL) size <<= 1;
+
+	tr = &trend->trace[trend->traces];
+	tr->addr = addr;
+	tr->size = size;
+	tr->count = 0;
+	tr->time = malloc(size * sizeof(uint64_t));
+	tr->value = malloc(size * sizeof(uint16_t));
+	tr->block_min = malloc(size / IL_TREND_BLOCK * sizeof(uint16_t));
+	tr->block_max = malloc(size / IL_TREND_BLOCK * sizeof(uint16_t));
+	if(!tr->time || !tr->value || !tr->block_min || !tr->block_max){
+		free(tr->time);
+		free(tr->value);
+		free(tr->block_min);
+		free(tr->block_max);
+		return -1;
+	}
+	record(trend, tr, initial);
+	trend->map[addr >> 3] |= (uint8_t)(1 << (addr & 7));
+	return trend->traces++;
+}
+
+/* Set the time stamp for the following samples */
+void il_trend_clock(il_trend *trend, uint64_t now){
+	trend->clock = now;
+}
+
+/* Write observer recording a sample */
+void il_trend_observer(void *user, uint16_t addr, uint16_t old, uint16_t val){
+	il_trend * trend = user;
+	int i;
+	(void)old;
+	for(i = 0; i < trend->traces; i++){
+		if(trend->trace[i].addr == addr) record(trend, &trend->trace[i], val);
+	}
+}
+
+/* Decimate a time window of a trace to min/max per column */
+void il_trend_decimate(const il_trace *tr, uint64_t t0, uint64_t t1,
+		int columns, il_trend_column *out){
+	uint64_t n = find(tr, t0), span = (t1 > t0) ? t1 - t0 : 1;
+	bool have = false;
+	uint16_t last = 0;
+	int c;
+
+	// Value held from before the window
+	if(n > 0 && n + tr->size > tr->count){
+		last = tr->value[(n - 1) & (tr->size - 1)];
+		have = true;
+	}
+	for(c = 0; c < columns; c++){
+		uint64_t end = t0 + span * (uint64_t)(c + 1) / columns;
+		uint64_t e = find(tr, (end < t1) ? end : t1);
+		out[c].min = out[c].max = last;
+		out[c].valid = have;
+		// All samples falling in this column, n .. e-1
+		if(e > n){
+			if(!out[c].valid){
+				out[c].min = out[c].max = tr->value[n & (tr->size - 1)];
+				out[c].valid = true;
+			}
+			extend(tr, n, e, &out[c].min, &out[c].max);
+			last = tr->value[(e - 1) & (tr->size - 1)];
+			have = true;
+			n = e;
+		}
+	}
+}
@@ -0,0 +1,114 @@
+/*
+ * il_trend.h
+ *
+ * Register trend capture. Selected registers are sampled on every
+ * write by the simulation (a context write observer), not by the
+ * display, into one ring buffer per trace. For display, a time
+ * window is decimated to one min/max pair per pixel column. Every
+ * IL_TREND_BLOCK samples also keep their min/max, so a column is built
+ * from these summaries plus the samples at its two edges, and drawing
+ * takes time proportional to the columns rather than the samples.
+ *
+ * Timestamps come from a clock the host advances with il_trend_clock()
+ * - any monotonic unit, e.g. microseconds or lines executed.
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+
+#ifndef IL_TREND_H_
+#define IL_TREND_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "il_interpreter.h"
+
+#define IL_TREND_MAX_TRACES 8
+#define IL_TREND_BLOCK      64   // samples per min/max summary
+
+/* One trace - the ring of samples of one register */
+typedef struct{
+	uint16_t addr;
+	uint32_t size;       // ring size, a power of 2
+	uint64_t count;      // samples recorded (ring index = count & (size-1))
+	uint64_t *time;
+	uint16_t *value;
+	uint16_t *block_min; // min/max of each IL_TREND_BLOCK samples of the ring
+	uint16_t *block_max;
+} il_trace;
+
+typedef struct{
+	uint64_t clock;                        // current time for new samples
+	int traces;
+	il_trace trace[IL_TREND_MAX_TRACES];
+	uint8_t map[8192];                     // traced addresses, for il_interp_ctx_watch()
+} il_trend;
+
+/* One pixel column of a decimated trace */
+typedef struct{
+	uint16_t min;
+	uint16_t max;
+	bool valid;          // false before the first sample
+} il_trend_column;
+
+/* Initialise a trend with no traces */
+void il_trend_init(il_trend *trend);
+
+/* Release all traces */
+void il_trend_free(il_trend *trend);
+
+/* Add a trace
+ *
+ * @param trend   - the trend
+ * @param addr    - the register to trace
+ * @param samples - ring size, rounded up to a power of 2 of at least IL_TREND_BLOCK
+ * @param initial - the register's current value, recorded as the first sample
+ * @return - trace number, or -1 if full or out of memory
+ */
+int il_trend_add(il_trend *trend, uint16_t addr, uint32_t samples, uint16_t initial);
+
+/* Set the time stamp for the following samples */
+void il_trend_clock(il_trend *trend, uint64_t now);
+
+/* Write observer recording a sample. Install with
+ * il_interp_ctx_watch(ctx, trend->map, il_trend_observer, trend)
+ * or through the debugger.
+ */
+void il_trend_observer(void *trend, uint16_t addr, uint16_t old, uint16_t val);
+
+/* Decimate a time window of a trace to min/max per column. Columns
+ * without samples hold the value of the previous sample.
+ *
+ * @param trace   - the trace
+ * @param t0      - start of the window
+ * @param t1      - end of the window (exclusive)
+ * @param columns - number of columns
+ * @param out     - columns entries
+ */
+void il_trend_decimate(const il_trace *trace, uint64_t t0, uint64_t t1,
+		int columns, il_trend_column *out);
+
+#endif /* IL_TREND_H_ */
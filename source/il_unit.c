@@ -0,0 +1,190 @@
+/*
+ * il_unit.c
+ *
+ * A simulated unit - interpreter context, memory image and program.
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "il_unit.h"
+#include "il_shm_export.h"
+#include "il_tier.h"
+
+/* Initialise a unit with a cleared memory image and no program */
+void il_unit_init(il_unit *unit){
+	memset(&unit->image, 0, sizeof(unit->image));
+	il_interp_ctx_init_image(&unit->ctx, &unit->image);
+	unit->shm = NULL;
+	unit->program = NULL;
+	unit->lines = 0;
+	unit->scans = 0;
+	unit->overruns = 0;
+	unit->tier = NULL;
+	unit->adaptive = false;
+	unit->input_changes = 0;
+}
+
+/* Copy a program into the unit */
+bool il_unit_load(il_unit *unit, const il_line *program, uint16_t lines){
+	il_line * copy = NULL;
+
+	if(lines){
+		copy = malloc(lines * sizeof(il_line));
+		if(!copy) return false;
+		memcpy(copy, program, lines * sizeof(il_line));
+	}
+	free(unit->program);
+	unit->program = copy;
+	unit->lines = lines;
+	if(unit->tier) il_tier_reset(unit);
+	return true;
+}
+
+/* Release the unit's program copy */
+void il_unit_free(il_unit *unit){
+	free(unit->program);
+	unit->program = NULL;
+	unit->lines = 0;
+	if(unit->tier) il_tier_reset(unit);
+}
+
+/* Execute one complete scan of the program */
+void il_unit_scan(il_unit *unit){
+	const il_line * p = unit->program;
+	uint16_t line = 0;
+	uint32_t steps = 0;
+
+	if(unit->tier){
+		il_tier_scan(unit);
+	} else {
+		while(line < unit->lines){
+			if(++steps > IL_SCAN_STEP_LIMIT){
+				unit->overruns++;
+				break;
+			}
+			line = il_interp_ctx_execute(&unit->ctx, p[line].cmd, p[line].value, line);
+		}
+	}
+	unit->scans++;
+	if(unit->shm) il_shm_export_publish(unit->shm, IL_SHM_ALL_BANKS, true);
+}
+
+/* Execute a single line of the program */
+uint16_t il_unit_step(il_unit *unit, uint16_t line){
+	if(line < unit->lines){
+		line = il_interp_ctx_execute(&unit->ctx, unit->program[line].cmd, unit->program[line].value, line);
+		if(unit->shm) il_shm_export_publish(unit->shm, IL_SHM_ALL_BANKS, line >= unit->lines);
+	}
+	if(line >= unit->lines){
+		unit->scans++;
+		line = 0;
+	}
+	return line;
+}
+
+/* Write an input register, tracking changes */
+bool il_unit_input(il_unit *unit, uint16_t addr, uint16_t value){
+	if(il_image_get(unit->ctx.image, addr, false) == value) return false;
+	il_image_set(unit->ctx.image, addr, value, false);
+	if(unit->shm) il_shm_export_set(unit->shm, addr, value);
+	unit->input_changes++;
+	return true;
+}
+
+/* Export the unit's memory image in shared memory */
+bool il_unit_shm_attach(il_unit *unit, const char *name){
+	if(unit->shm) return false;
+	unit->shm = il_shm_export_create(name, &unit->ctx);
+	return unit->shm != NULL;
+}
+
+/* Stop exporting the unit's memory image */
+void il_unit_shm_detach(il_unit *unit){
+	il_shm_close(unit->shm);
+	unit->shm = NULL;
+}
+
+/* Set the adaptive scan rate of a unit */
+bool il_unit_set_scan_rate(il_unit *unit, const il_scan_rate *rate){
+	if(!rate){
+		unit->adaptive = false;
+		return true;
+	}
+	if(rate->min_period == 0 || rate->max_period < rate->min_period) return false;
+	unit->rate = *rate;
+	unit->adaptive = true;
+	unit->period = rate->min_period;   // start responsive
+	unit->next_scan = 0;
+	unit->last_scan = UINT64_MAX;      // not scanned yet
+	unit->quiet = 0;
+	unit->interval16 = 0;
+	unit->input_changes = 0;
+	return true;
+}
+
+/* Adjust the scan period from the input changes since the last scan */
+static void adapt_period(il_unit *unit){
+	const il_scan_rate * r = &unit->rate;
+	uint32_t changes = unit->input_changes;
+
+	unit->input_changes = 0;
+	if(changes){
+		unit->quiet = 0;
+		if(changes >= r->busy_changes) unit->period = r->min_period;
+		else                           unit->period /= 2;
+		if(unit->period < r->min_period) unit->period = r->min_period;
+	} else if(++unit->quiet >= r->quiet_scans){
+		unit->quiet = 0;
+		unit->period = (unit->period > r->max_period / 2) ? r->max_period : unit->period * 2;
+	}
+}
+
+/* Scan the unit if a scan is due */
+bool il_unit_poll(il_unit *unit, uint64_t now){
+	if(!unit->adaptive){
+		il_unit_scan(unit);
+		return true;
+	}
+	if(now < unit->next_scan) return false;
+
+	if(unit->last_scan != UINT64_MAX && now > unit->last_scan){
+		int64_t i16 = (int64_t)(now - unit->last_scan) * 16;
+		if(!unit->interval16) unit->interval16 = (uint32_t)i16;
+		else unit->interval16 = (uint32_t)(unit->interval16 + (i16 - unit->interval16) / 8);
+	}
+	adapt_period(unit);
+	il_unit_scan(unit);
+	unit->last_scan = now;
+	unit->next_scan = now + unit->period;
+	return true;
+}
+
+/* Get the effective scan rate of an adaptive unit */
+double il_unit_effective_rate(const il_unit *unit){
+	if(!unit->adaptive || !unit->interval16) return 0.0;
+	return 16000.0 / unit->interval16;
+}
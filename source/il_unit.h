@@ -0,0 +1,182 @@
+/*
+ * il_unit.h
+ *
+ * A simulated unit - an interpreter context, its flat memory image
+ * and its own copy of the program - kept together so a multi-unit
+ * host can allocate everything a unit touches in one place.
+ *
+ * Created on: 18 Oct 2026
+ *     Author: ELPRO Technologies
+ */
+
+/**********************************************************************
+Copyright 2026 ELPRO Technologies 29 Lathe St, Virginia, QLD, Australia
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+************************************************************************/
+
+
+#ifndef IL_UNIT_H_
+#define IL_UNIT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "il_interpreter.h"
+
+struct il_shm_export;
+struct il_tier_slot;
+
+/* Maximum number of lines executed in one scan. Stops a program
+ * that jumps backwards forever from hanging the host. The hardware
+ * watchdog does the same job in the RTU.
+ */
+#define IL_SCAN_STEP_LIMIT 65536UL
+
+/* One pre-parsed line of an IL program */
+typedef struct{
+	uint16_t cmd;    // command code from il_interp_parse()
+	uint16_t value;  // the associated value
+} il_line;
+
+/* Adaptive scan rate settings. Times are in ms of simulated time.
+ * The period halves when tracked inputs changed since the last scan
+ * (or drops to min_period when there were at least busy_changes),
+ * and doubles after quiet_scans scans in a row without changes.
+ */
+typedef struct{
+	uint32_t min_period;    // shortest period, while inputs are changing
+	uint32_t max_period;    // longest period, while inputs are idle
+	uint32_t quiet_scans;   // idle scans before the period doubles (hysteresis)
+	uint32_t busy_changes;  // changes in one period that go straight to min_period
+} il_scan_rate;
+
+/* A simulated unit. Always access memory through ctx.image - it
+ * points at image unless the image has been moved elsewhere. */
+typedef struct{
+	il_context ctx;
+	il_memory_image image;
+	struct il_shm_export * shm;  // shared memory export (il_unit_shm_attach), or NULL
+	il_line * program;   // unit's own copy of the program
+	uint16_t lines;      // number of lines in program
+	uint32_t scans;      // completed scans
+	uint32_t overruns;   // scans stopped by IL_SCAN_STEP_LIMIT
+	struct il_tier_slot * tier;  // tiered execution (il_tier.h), or NULL
+
+	/* Adaptive scan rate (see il_unit_poll()) */
+	bool adaptive;
+	il_scan_rate rate;
+	uint32_t period;         // current scan period
+	uint64_t next_scan;      // time the next scan is due
+	uint64_t last_scan;      // time of the last scan
+	uint32_t input_changes;  // tracked input changes since the last scan
+	uint32_t quiet;          // scans in a row without input changes
+	uint32_t interval16;     // smoothed interval between scans, ms * 16
+} il_unit;
+
+/* Initialise a unit with a cleared memory image and no program.
+ *
+ * @param unit - the unit to initialise
+ */
+void il_unit_init(il_unit *unit);
+
+/* Copy a program into the unit, replacing any previous program.
+ * The copy is allocated by the calling thread.
+ *
+ * @param unit    - the unit
+ * @param program - the program lines to copy
+ * @param lines   - number of lines
+ * @return - true if loaded. false if out of memory.
+ */
+bool il_unit_load(il_unit *unit, const il_line *program, uint16_t lines);
+
+/* Release the unit's program copy.
+ *
+ * @param unit - the unit
+ */
+void il_unit_free(il_unit *unit);
+
+/* Execute one complete scan of the unit's program, from line 0
+ * until execution runs off the end of the program. Units attached
+ * to a tier manager run on their current tier.
+ *
+ * @param unit - the unit
+ */
+void il_unit_scan(il_unit *unit);
+
+/* Execute a single line of the unit's program. When execution runs
+ * off the end of the program the scan is counted and the next scan
+ * starts at line 0.
+ *
+ * @param unit - the unit
+ * @param line - the line to execute
+ * @return - the next line to execute
+ */
+uint16_t il_unit_step(il_unit *unit, uint16_t line);
+
+/* Write an input register, counting it as an input change for the
+ * adaptive scan rate if the value is different.
+ *
+ * @param unit  - the unit
+ * @param addr  - the modbus style address
+ * @param value - the value
+ * @return - true if the value changed
+ */
+bool il_unit_input(il_unit *unit, uint16_t addr, uint16_t value);
+
+/* Export the unit's memory image in a named shared memory segment
+ * (il_shm_export.h). The image is published at the end of every scan.
+ *
+ * @param unit - the unit, not already exported
+ * @param name - POSIX shared memory name, e.g. "/il_unit_0001"
+ * @return - true if exported. false if the name is in use or on failure.
+ */
+bool il_unit_shm_attach(il_unit *unit, const char *name);
+
+/* Stop exporting the unit's memory image and remove the segment name.
+ *
+ * @param unit - the unit
+ */
+void il_unit_shm_detach(il_unit *unit);
+
+/* Set the adaptive scan rate of a unit
+ *
+ * @param unit - the unit
+ * @param rate - the settings, or NULL to scan at every il_unit_poll()
+ * @return - true if set. false if the settings are invalid.
+ */
+bool il_unit_set_scan_rate(il_unit *unit, const il_scan_rate *rate);
+
+/* Scan the unit if a scan is due. Without an adaptive scan rate
+ * every call scans.
+ *
+ * @param unit - the unit
+ * @param now  - the current simulated time in ms
+ * @return - true if the unit was scanned
+ */
+bool il_unit_poll(il_unit *unit, uint64_t now);
+
+/* Get the effective scan rate of an adaptive unit
+ *
+ * @param unit - the unit
+ * @return - smoothed scans per second of simulated time, 0 before the
+ *           second scan or without an adaptive scan rate
+ */
+double il_unit_effective_rate(const il_unit *unit);
+
+#endif /* IL_UNIT_H_ */